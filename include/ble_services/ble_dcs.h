@@ -22,16 +22,13 @@
 #define BLE_UUID_DCS_ADV_PARAMS_CHAR    0x0102                      /**< The UUID of the advertising parameters Characteristic. */
 #define BLE_UUID_DCS_CONN_PARAM_CHAR    0x0103                      /**< The UUID of the connection parameters Characteristic. */
 #define BLE_UUID_DCS_FW_VERSION_CHAR    0x0104                      /**< The UUID of the FW version Characteristic. */
+#define BLE_UUID_DCS_LOG_FILTER_CHAR    0x0105                      /**< The UUID of the log filter Characteristic. */
 
 #define BLE_TCS_DEVICE_NAME_LEN_MAX 10
+#define BLE_DCS_LOG_FILTER_LEN_MAX  8                           /**< Most modules in the log filter. */
 
 #define BLE_UUID_DCS_SERVICE 0x0100                      /**< The UUID of the Detect Configuration Service. */
 
-/* File ID and Key used for the configuration record. */
-
-#define CONFIG_FILE     (0xF010)
-#define CONFIG_REC_KEY  (0x7010)
-
 /* Colors used to print on the console. */
 
 #define COLOR_GREEN     "\033[1;32m"
@@ -124,7 +121,8 @@ typedef enum
 {
     BLE_DCS_EVT_DEV_NAME,
     BLE_DCS_EVT_ADV_PARAM,
-    BLE_DCS_EVT_CONN_PARAM
+    BLE_DCS_EVT_CONN_PARAM,
+    BLE_DCS_EVT_LOG_FILTER
 }ble_dcs_evt_type_t;
 
 /* Forward declaration of the ble_tcs_t type. */
@@ -156,7 +154,9 @@ struct ble_dcs_s
     ble_gatts_char_handles_t adv_param_handles;            /**< Handles related to the pressure characteristic (as provided by the S132 SoftDevice). */
     ble_gatts_char_handles_t conn_param_handles;           /**< Handles related to the config characteristic (as provided by the S132 SoftDevice). */
     ble_gatts_char_handles_t fwv_handles;
-    uint16_t                 conn_handle;                  /**< Handle of the current connection (as provided by the S110 SoftDevice). BLE_CONN_HANDLE_INVALID if not in a connection. */
+    ble_gatts_char_handles_t log_filter_handles;           /**< Handles related to the log filter characteristic. */
+    uint8_t                  log_filter_len;               /**< Number of modules in the log filter, one byte each. */
+    uint16_t                 conn_handle;                  /**< Handle of the connection that wrote last, or else connected last. BLE_CONN_HANDLE_INVALID if not in a connection. */
     ble_dcs_evt_handler_t    evt_handler;                  /**< Event handler to be called for handling received data. */
 };
 
@@ -168,6 +168,8 @@ struct ble_dcs_s
 typedef struct
 {
     ble_dcs_params_t      * p_init_vals;
+    uint8_t const         * p_init_log_filter; /**< Log filter of each module, not kept in flash. */
+    uint8_t                 log_filter_len;    /**< Number of modules in the log filter, up to BLE_DCS_LOG_FILTER_LEN_MAX. */
     ble_dcs_evt_handler_t   evt_handler; /**< Event handler to be called for handling received data. */
 } ble_dcs_init_t;
 
@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include "app_util_platform.h"
+#include "sdk_config.h"
 
 // EE84xxxx-43B7-4F65-9FB9-D7B92D683E36
 #define DDS_BASE_UUID                  {{0x36, 0x3E, 0x68, 0x2D, 0xB9, 0xD7, 0xB9, 0x9F, 0x65, 0x4F, 0xB7, 0x43, 0x00, 0x00, 0x84, 0xEE}}
@@ -14,12 +15,28 @@
 #define BLE_UUID_DDS_PRESENCE_CHAR      0x0201                      /**< The UUID of the temperature Characteristic. */
 #define BLE_UUID_DDS_RANGE_CHAR         0x0202                      /**< The UUID of the pressure Characteristic. */
 #define BLE_UUID_DDS_CONFIG_CHAR        0x0203                      /**< The UUID of the config Characteristic. */
+#define BLE_UUID_DDS_PRESENCE_STREAM_CHAR 0x0204                    /**< The UUID of the compressed presence stream Characteristic. */
+#define BLE_UUID_DDS_COUNT_CHAR         0x0205                      /**< The UUID of the people count Characteristic. */
+#define BLE_UUID_DDS_AGGREGATE_WINDOW_CHAR 0x0206                   /**< The UUID of the aggregation window Characteristic. */
+#define BLE_UUID_DDS_AGGREGATE_CHAR     0x0207                      /**< The UUID of the aggregate statistics Characteristic. */
+#define BLE_UUID_DDS_RANGE_BG_CHAR      0x0208                      /**< The UUID of the range background Characteristic. */
+#define BLE_UUID_DDS_BROADCAST_CHAR     0x0209                      /**< The UUID of the occupancy broadcast Characteristic. */
+#define BLE_UUID_DDS_TIME_CHAR          0x020A                      /**< The UUID of the time sync Characteristic. */
 
 #define BLE_DDS_MAX_RX_CHAR_LEN        BLE_DDS_MAX_DATA_LEN        /**< Maximum length of the RX Characteristic (in bytes). */
 #define BLE_DDS_MAX_TX_CHAR_LEN        BLE_DDS_MAX_DATA_LEN        /**< Maximum length of the TX Characteristic (in bytes). */
 
 #define BLE_DDS_MAX_DATA_LEN (BLE_GATT_ATT_MTU_DEFAULT - 3) /**< Maximum length of data (in bytes) that can be transmitted to the peer by the Thingy Environment service module. */
 
+#define BLE_DDS_LINK_COUNT              NRF_SDH_BLE_PERIPHERAL_LINK_COUNT   /**< Centrals served at the same time. */
+#define BLE_DDS_LINK_TX_QUEUE_SIZE      BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT /**< Notifications the SoftDevice queues per connection. */
+
+#define BLE_DDS_NOTIF_PRESENCE          (1 << 0)                    /**< The central enabled presence notifications. */
+#define BLE_DDS_NOTIF_RANGE             (1 << 1)                    /**< The central enabled range notifications. */
+#define BLE_DDS_NOTIF_PRESENCE_STREAM   (1 << 2)                    /**< The central enabled presence stream notifications. */
+#define BLE_DDS_NOTIF_COUNT             (1 << 3)                    /**< The central enabled people count notifications. */
+#define BLE_DDS_NOTIF_AGGREGATE         (1 << 4)                    /**< The central enabled aggregate statistics notifications. */
+
 #ifdef __GNUC__
     #ifdef PACKED
         #undef PACKED
@@ -45,10 +62,69 @@ typedef PACKED( struct
     uint16_t range;
 }) ble_dds_range_t;
 
+/**@brief Occupancy broadcast settings. */
+typedef PACKED( struct
+{
+    uint8_t  mode;              ///< BLE_DDS_BROADCAST_ mode.
+    uint16_t interval_ms;       ///< Advertising interval while broadcasting.
+}) ble_dds_broadcast_t;
+
+/**@brief People count, updated at the end of every motion session. */
+typedef PACKED( struct
+{
+    uint32_t timestamp;         ///< End of the last session, ms since notification was enabled.
+    uint8_t  direction;         ///< Last session: 0 not classified, 1 enter, 2 exit, 3 passer-by.
+    uint16_t enter;             ///< Sessions classified as entering since boot.
+    uint16_t exit;              ///< Sessions classified as exiting since boot.
+}) ble_dds_count_t;
+
+/**@brief Absolute time of the relative timestamps, read from the time sync characteristic. */
+typedef PACKED( struct
+{
+    uint64_t presence_epoch_ms; ///< Time at presence timestamp 0, ms since 1970-01-01 UTC, 0 before the time is set or sampling starts.
+    uint64_t range_epoch_ms;    ///< Time at range timestamp 0, as for presence.
+    int16_t  drift_ppm;         ///< RTC drift corrected for between time writes.
+}) ble_dds_time_t;
+
+#define BLE_DDS_AGGREGATE_CHANNELS             5    ///< IR1 - IR4, then range.
+
+/**@brief Statistics of one channel over an aggregation window, in the unit of its samples. */
+typedef PACKED( struct
+{
+    int16_t  min;
+    int16_t  max;
+    int16_t  mean;
+    uint16_t stddev;
+}) ble_dds_aggregate_summary_t;
+
+/**@brief One channel of an aggregation window. */
+typedef PACKED( struct
+{
+    uint32_t                    timestamp;  ///< End of the window, s since 1970-01-01 UTC once the time is set, otherwise s since aggregation started.
+    uint8_t                     channel;    ///< 0 - 3 for IR1 - IR4, 4 for range.
+    uint32_t                    count;      ///< Samples in the window.
+    ble_dds_aggregate_summary_t summary;
+}) ble_dds_aggregate_t;
+
+#define BLE_DDS_RANGE_BG_FOREGROUND_ONLY    0x01    ///< Only notify range readings in front of the background.
+#define BLE_DDS_RANGE_BG_GATE_MOTION        0x02    ///< Only start a motion session once the range sees something in front of the background.
+#define BLE_DDS_RANGE_BG_RELEARN            0x04    ///< Write only, forget the background and learn it again.
+
+/**@brief Range background model. */
+typedef PACKED( struct
+{
+    uint8_t  flags;             ///< BLE_DDS_RANGE_BG_ flags.
+    uint16_t margin_mm;         ///< Readings nearer than the background by at least this, and 3 standard deviations, are foreground.
+    uint16_t background_mm;     ///< Learned background, 0 while learning. Ignored on write.
+    uint16_t stddev_mm;         ///< Learned background standard deviation. Ignored on write.
+}) ble_dds_range_bg_t;
+
 typedef enum
 {
     SAMPLE_MODE_CONTINUOUS,
     SAMPLE_MODE_MOTION,
+    SAMPLE_MODE_CALIBRATE,
+    SAMPLE_MODE_AGGREGATE,
 } ble_dds_sample_mode_t;
 
 typedef PACKED( struct
@@ -59,26 +135,73 @@ typedef PACKED( struct
     int16_t  eth24l;
 }) ble_dds_threshold_config_t;
 
+typedef PACKED( struct
+{
+    uint8_t   window_s;
+    uint8_t   false_wakes_per_day;
+}) ble_dds_calibration_config_t;
+
+/**@brief Motion session timing, in units of 100 ms. */
+typedef PACKED( struct
+{
+    uint8_t   timeout;
+    uint8_t   min_length;
+    uint8_t   holdoff;
+}) ble_dds_session_config_t;
+
+/**@brief Change driven range reporting. */
+typedef PACKED( struct
+{
+    uint8_t   deadband_mm;      ///< Notify when the range moved more than this since the last notification, 0 notifies every reading.
+    uint8_t   heartbeat_s;      ///< Notify at least this often while the range stays in the deadband, 0 for never.
+}) ble_dds_range_report_config_t;
+
 typedef PACKED( struct
 {
     uint16_t                   range_interval_ms;
     uint16_t                presence_interval_ms;
     ble_dds_threshold_config_t  threshold_config;
     ble_dds_sample_mode_t            sample_mode;
+    ble_dds_calibration_config_t     calibration;
+    ble_dds_session_config_t         session;
+    ble_dds_range_report_config_t    range_report;
 }) ble_dds_config_t;
 
+#define BLE_DDS_MARKER_PREROLL                 2    ///< Presence sample taken before the motion trigger.
+#define BLE_DDS_MARKER_HEARTBEAT               3    ///< Range reading sent because the heartbeat was due, unchanged within the deadband.
+
 #define BLE_DDS_CONFIG_PRESENCE_INT_MIN       20
 #define BLE_DDS_CONFIG_PRESENCE_INT_MAX      200
 #define BLE_DDS_CONFIG_RANGE_INT_MIN          20
 #define BLE_DDS_CONFIG_RANGE_INT_MAX         200
 #define BLE_DDS_CONFIG_THRESHOLD_MIN       -2048
 #define BLE_DDS_CONFIG_THRESHOLD_MAX        2047
+#define BLE_DDS_CONFIG_CALIB_WINDOW_MIN        5
+#define BLE_DDS_CONFIG_CALIB_WAKES_MIN         1
+#define BLE_DDS_CONFIG_SESSION_TIMEOUT_MIN     5
+#define BLE_DDS_AGGREGATE_WINDOW_MIN           1
+#define BLE_DDS_AGGREGATE_WINDOW_MAX        3600
+#define BLE_DDS_RANGE_BG_MARGIN_MIN           20
+#define BLE_DDS_RANGE_BG_MARGIN_MAX         2000
+#define BLE_DDS_BROADCAST_OFF                  0    ///< Detection follows the notifications, advertising carries no occupancy.
+#define BLE_DDS_BROADCAST_LEGACY               1    ///< Motion detection runs without a peer and occupancy is advertised.
+#define BLE_DDS_BROADCAST_EXTENDED             2    ///< As legacy, in BLE 5 extended advertising with the last sessions.
+#define BLE_DDS_BROADCAST_INTERVAL_MIN       100
+#define BLE_DDS_BROADCAST_INTERVAL_MAX     10240
+#define BLE_DDS_TIME_MIN_MS       1500000000000ULL    ///< Earlier times are not a clock that was set.
 
 typedef enum
 {
     BLE_DDS_EVT_NOTIF_PRESENCE,
     BLE_DDS_EVT_NOTIF_RANGE,
-    BLE_DDS_EVT_CONFIG_RECEIVED
+    BLE_DDS_EVT_NOTIF_PRESENCE_STREAM,
+    BLE_DDS_EVT_NOTIF_COUNT,
+    BLE_DDS_EVT_CONFIG_RECEIVED,
+    BLE_DDS_EVT_NOTIF_AGGREGATE,
+    BLE_DDS_EVT_AGGREGATE_WINDOW_RECEIVED,
+    BLE_DDS_EVT_RANGE_BG_RECEIVED,
+    BLE_DDS_EVT_BROADCAST_RECEIVED,
+    BLE_DDS_EVT_TIME_RECEIVED
 }ble_dds_evt_type_t;
 
 /* Forward declaration of the ble_tes_t type. */
@@ -100,12 +223,27 @@ typedef struct
     ble_dds_presence_t * p_init_presence;
     ble_dds_range_t    * p_init_range;
     ble_dds_config_t      * p_init_config;
+    uint16_t                init_aggregate_window_s;
+    ble_dds_range_bg_t    * p_init_range_bg;
+    ble_dds_broadcast_t   * p_init_broadcast;
+    ble_dds_time_t        * p_init_time;
     ble_dds_evt_handler_t     evt_handler; /**< Event handler to be called for handling received data. */
 } ble_dds_init_t;
 
+/**@brief State of one connected central.
+ */
+typedef struct
+{
+    uint16_t                 conn_handle;                  /**< BLE_CONN_HANDLE_INVALID if the slot is free. */
+    uint8_t                  notif;                        /**< BLE_DDS_NOTIF_ bits the central enabled. */
+    uint8_t                  tx_pending;                   /**< Notifications queued on the link and not sent yet. */
+} ble_dds_link_t;
+
 /**@brief Detect Detection Service structure.
  *
- * @details This structure contains status information related to the service.
+ * @details This structure contains status information related to the service. The
+ *          is_*_notif_enabled flags are set while any connected central has enabled the
+ *          notification.
  */
 struct ble_dds_s
 {
@@ -114,18 +252,96 @@ struct ble_dds_s
     ble_gatts_char_handles_t presence_handles;          /**< Handles related to the presence characteristic (as provided by the S132 SoftDevice). */
     ble_gatts_char_handles_t range_handles;             /**< Handles related to the range characteristic (as provided by the S132 SoftDevice). */
     ble_gatts_char_handles_t config_handles;               /**< Handles related to the config characteristic (as provided by the S132 SoftDevice). */
-    uint16_t                 conn_handle;                  /**< Handle of the current connection (as provided by the S110 SoftDevice). BLE_CONN_HANDLE_INVALID if not in a connection. */
+    ble_gatts_char_handles_t presence_stream_handles;      /**< Handles related to the presence stream characteristic (as provided by the S132 SoftDevice). */
+    ble_gatts_char_handles_t count_handles;                /**< Handles related to the people count characteristic (as provided by the S132 SoftDevice). */
+    ble_gatts_char_handles_t aggregate_window_handles;     /**< Handles related to the aggregation window characteristic (as provided by the S132 SoftDevice). */
+    ble_gatts_char_handles_t aggregate_handles;            /**< Handles related to the aggregate statistics characteristic (as provided by the S132 SoftDevice). */
+    ble_gatts_char_handles_t range_bg_handles;             /**< Handles related to the range background characteristic (as provided by the S132 SoftDevice). */
+    ble_gatts_char_handles_t broadcast_handles;            /**< Handles related to the occupancy broadcast characteristic (as provided by the S132 SoftDevice). */
+    ble_gatts_char_handles_t time_handles;                 /**< Handles related to the time sync characteristic (as provided by the S132 SoftDevice). */
+    ble_dds_link_t           links[BLE_DDS_LINK_COUNT];    /**< Connected centrals. */
     bool                     is_presence_notif_enabled; /**< Variable to indicate if the peer has enabled notification of the characteristic.*/
     bool                     is_range_notif_enabled;    /**< Variable to indicate if the peer has enabled notification of the characteristic.*/
+    bool                     is_presence_stream_notif_enabled; /**< Variable to indicate if the peer has enabled notification of the characteristic.*/
+    bool                     is_count_notif_enabled;    /**< Variable to indicate if the peer has enabled notification of the characteristic.*/
+    bool                     is_aggregate_notif_enabled; /**< Variable to indicate if the peer has enabled notification of the characteristic.*/
     ble_dds_evt_handler_t    evt_handler;                  /**< Event handler to be called for handling received data. */
 };
 
 void ble_dds_on_ble_evt(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt);
 
+/**@brief Function for checking if any central is connected.
+ *
+ * @param[in] p_dds     Detect Detection Service structure.
+ */
+bool ble_dds_connected(ble_dds_t const * p_dds);
+
 uint32_t ble_dds_presence_set(ble_dds_t * p_tes, ble_dds_presence_t * p_data);
 
 uint32_t ble_dds_range_set(ble_dds_t * p_tes, ble_dds_range_t * p_data);
 
+/**@brief Function for notifying a packet of compressed presence samples.
+ *
+ * @details Like every notification of the service, the packet is passed to each central that
+ *          enabled it, or to none while one of them has no free TX buffer.
+ *
+ * @param[in] p_dds     Detect Detection Service structure.
+ * @param[in] p_data    Packet, see @ref ir_codec_t.
+ * @param[in] length    Packet length, at most BLE_DDS_MAX_DATA_LEN.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_dds_presence_stream_set(ble_dds_t * p_dds, uint8_t const * p_data, uint16_t length);
+
+/**@brief Function for updating the people count, notified if the peer enabled it.
+ *
+ * @param[in] p_dds      Detect Detection Service structure.
+ * @param[in] p_count    People count.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_dds_count_set(ble_dds_t * p_dds, ble_dds_count_t * p_count);
+
+/**@brief Function for notifying one channel of an aggregation window.
+ *
+ * @param[in] p_dds          Detect Detection Service structure.
+ * @param[in] p_aggregate    Channel statistics.
+ *
+ * @return NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if the peer did not enable it,
+ *         otherwise an error code.
+ */
+uint32_t ble_dds_aggregate_set(ble_dds_t * p_dds, ble_dds_aggregate_t * p_aggregate);
+
+/**@brief Function for updating the stored value of the range background characteristic.
+ *
+ * @param[in] p_dds         Detect Detection Service structure.
+ * @param[in] p_range_bg    Range background model to expose to the peer.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_dds_range_bg_set(ble_dds_t * p_dds, ble_dds_range_bg_t * p_range_bg);
+
+/**@brief Function for updating the stored value of the time sync characteristic.
+ *
+ * @details A central writes the time as a uint64_t, ms since 1970-01-01 UTC, and reads back
+ *          where the relative timestamps of the samples start.
+ *
+ * @param[in] p_dds     Detect Detection Service structure.
+ * @param[in] p_time    Absolute time of the timestamps to expose to the peer.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_dds_time_set(ble_dds_t * p_dds, ble_dds_time_t * p_time);
+
+/**@brief Function for updating the stored value of the configuration characteristic.
+ *
+ * @param[in] p_dds       Detect Detection Service structure.
+ * @param[in] p_config    Configuration to expose to the peer.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_dds_config_set(ble_dds_t * p_dds, ble_dds_config_t * p_config);
+
 uint32_t ble_dds_init(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init);
 
 #endif
\ No newline at end of file
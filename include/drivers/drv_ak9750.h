@@ -11,6 +11,21 @@
 #define DEVICE_ID                            0x01
 #define DEVICE_ID_VALUE                      0x13
 
+/**@brief Internal temperature conversion, degC = (OFFSET + raw * LSB) / 1000. */
+#define AK9750_TMP_OFFSET_MDEG               26750
+#define AK9750_TMP_LSB_MDEG                  125
+
+/**@brief Autonomous acquisition limits. */
+#define DRV_AK9750_AUTO_RECORD_LEN           11      ///< IR1L..ST2, one record per sample.
+#define DRV_AK9750_AUTO_BATCH_MAX            16      ///< Maximum records per batch.
+
+/**@brief Autonomous acquisition batch handler, called in main context.
+ *
+ * @param[in] p_records    Records of DRV_AK9750_AUTO_RECORD_LEN bytes, oldest first.
+ * @param[in] count        Number of records.
+ */
+typedef void (*drv_ak9750_batch_handler_t)(uint8_t const * p_records, uint8_t count);
+
 /**@brief Configuration struct for the AK9750 presence sensor.
  */
 typedef struct
@@ -44,7 +59,50 @@ uint32_t drv_ak9750_read_int(uint8_t * status);
 
 uint32_t drv_ak9750_cfg_set(ble_dds_config_t * config);
 
-uint32_t drv_ak9750_get_irs(ble_dds_presence_t * presence);
+/**@brief Function for reading the IR channels and the internal temperature in one burst.
+ *
+ * @param[out] presence            IR1..IR4 are filled in, timestamp and marker are left untouched.
+ * @param[out] p_temperature       Internal temperature in units of AK9750_TMP_LSB_MDEG above
+ *                                 AK9750_TMP_OFFSET_MDEG. May be NULL.
+ *
+ * @retval NRF_SUCCESS             If operation was successful.
+ * @retval NRF_ERROR_BUSY          If the TWI drivers are busy.
+ */
+uint32_t drv_ak9750_get_irs(ble_dds_presence_t * presence, int16_t * p_temperature);
+
+/**@brief Function for decoding one autonomous acquisition record.
+ *
+ * @param[in]  p_record            Record of DRV_AK9750_AUTO_RECORD_LEN bytes.
+ * @param[out] presence            IR1..IR4 are filled in, timestamp and marker are left untouched.
+ * @param[out] p_temperature       Internal temperature, see @ref drv_ak9750_get_irs. May be NULL.
+ */
+void drv_ak9750_record_decode(uint8_t const * p_record, ble_dds_presence_t * presence, int16_t * p_temperature);
+
+/**@brief Function for starting autonomous acquisition.
+ *
+ * @details An RTC2 compare starts a TWIM read of the IR block through PPI, EasyDMA moves the
+ *          RX pointer on by one record per read, and TIMER2 counts the reads. The CPU only
+ *          runs once per batch. The sensor must already be in continuous mode. The TWI bus is
+ *          held until @ref drv_ak9750_auto_stop, no other driver can use it in between.
+ *
+ * @param[in] p_cfg                TWI configuration.
+ * @param[in] interval_ms          Time between reads.
+ * @param[in] batch_len            Reads per batch, 1 to DRV_AK9750_AUTO_BATCH_MAX.
+ * @param[in] handler              Called with every full batch.
+ *
+ * @retval NRF_SUCCESS             If acquisition was started.
+ * @retval NRF_ERROR_INVALID_PARAM If batch_len is out of range.
+ */
+uint32_t drv_ak9750_auto_start(drv_ak9750_twi_cfg_t const * const p_cfg,
+                               uint16_t                           interval_ms,
+                               uint8_t                            batch_len,
+                               drv_ak9750_batch_handler_t         handler);
+
+/**@brief Function for stopping autonomous acquisition and releasing the TWI bus.
+ *
+ * @details A partly filled batch is dropped.
+ */
+uint32_t drv_ak9750_auto_stop(void);
 
 uint32_t drv_ak9750_one_shot(void);
 
@@ -12,6 +12,7 @@ typedef enum
 {
     DRV_PRESENCE_EVT_DATA,    /**<Converted value ready to be read.*/
     DRV_PRESENCE_EVT_MOTION_STOP,
+    DRV_PRESENCE_EVT_BATCH,   /**<Batch of samples from autonomous acquisition.*/
     DRV_PRESENCE_EVT_ERROR    /**<HW error on the communication bus.*/
 }drv_presence_evt_type_t;
 
@@ -29,6 +30,9 @@ typedef struct
 {
     drv_presence_evt_type_t type;
     ble_dds_sample_mode_t     mode;
+    uint32_t                  tick;   ///< Timestamp of the interrupt edge behind the event, see hw_timestamp.h.
+    ble_dds_presence_t const * p_batch;   ///< DRV_PRESENCE_EVT_BATCH samples, oldest first, IR values only.
+    uint8_t                   batch_len;  ///< Number of samples in p_batch.
 }drv_presence_evt_t;
 
 /**@brief Pressure driver event handler callback type.
@@ -80,6 +84,23 @@ uint32_t drv_presence_enable(ble_dds_config_t * config);
  */
 uint32_t drv_presence_disable(void);
 
+/**@brief Function for sampling without the CPU, see @ref drv_ak9750_auto_start.
+ *
+ * @details The driver must be enabled in continuous mode. Samples are delivered in
+ *          DRV_PRESENCE_EVT_BATCH events. The TWI bus is held until @ref drv_presence_auto_stop.
+ *
+ * @param[in] interval_ms          Time between samples.
+ * @param[in] batch_len            Samples per event.
+ *
+ * @retval NRF_SUCCESS             If acquisition was started.
+ * @retval NRF_ERROR_INVALID_STATE If the driver is not enabled in continuous mode.
+ */
+uint32_t drv_presence_auto_start(uint16_t interval_ms, uint8_t batch_len);
+
+/**@brief Function for stopping autonomous sampling.
+ */
+uint32_t drv_presence_auto_stop(void);
+
 /**@brief Function for resetting the chip to all default register values.
 *
 * @retval NRF_SUCCESS             If operation was successful.
@@ -102,6 +123,15 @@ uint32_t drv_presence_mode_set(ble_dds_sample_mode_t mode);
  */
 uint32_t drv_presence_get(ble_dds_presence_t * presence);
 
+/**@brief Function for seeding the idle IR baseline, e.g. from a calibration run.
+ *
+ * @details The thresholds given to @ref drv_presence_enable are applied relative to the
+ *          IR1-IR3 and IR2-IR4 difference of this baseline.
+ *
+ * @param[in] p_baseline    Mean idle IR1..IR4 values.
+ */
+void drv_presence_baseline_seed(ble_dds_presence_t const * p_baseline);
+
 /**@brief Function for starting the sampling.
  *
  * @retval NRF_SUCCESS             If start sampling was successful.
@@ -27,6 +27,7 @@ typedef struct
 {
     drv_range_evt_type_t type;
     drv_range_mode_t     mode;
+    uint32_t             tick;   ///< Timestamp of the data ready edge, see hw_timestamp.h.
 }drv_range_evt_t;
 
 /**@brief range driver event handler callback type.
@@ -0,0 +1,52 @@
+#ifndef __M_AGG_LOG_H__
+#define __M_AGG_LOG_H__
+
+#include <stdint.h>
+#include "agg_stats.h"
+
+#define M_AGG_LOG_BATCH         4   ///< Aggregation windows per log record.
+#define M_AGG_LOG_FLASH_PAGES   48  ///< fds pages of the log, counted in FDS_VIRTUAL_PAGES. 56 h of 60 s windows.
+
+/**@brief Log ready handler, called from the fds event context once a write or read refused
+ *        with NRF_ERROR_BUSY or NRF_ERROR_NO_MEM can be tried again.
+ */
+typedef void (*m_agg_log_ready_handler_t)(void);
+
+/**@brief Function for initializing the aggregation log.
+ *
+ * @details The log is kept in flash as a ring of fds records, as many as fit in all but one of
+ *          M_AGG_LOG_FLASH_PAGES, the oldest record is dropped beyond that. The page left keeps
+ *          room to write while the pages of dropped records wait for garbage collection. The IDs
+ *          and flash locations of the records are kept in RAM, flash is searched on first use and
+ *          once after every garbage collection, not on every write and read. fds is initialized
+ *          later, see @ref m_config_store_init.
+ *
+ * @param[in] handler    Log ready handler.
+ *
+ * @retval NRF_SUCCESS If initialization was successful.
+ */
+uint32_t m_agg_log_init(m_agg_log_ready_handler_t handler);
+
+/**@brief Function for appending aggregation windows to the log, as one record.
+ *
+ * @param[in] p_windows    Windows, oldest first.
+ * @param[in] count        Number of windows, at most M_AGG_LOG_BATCH.
+ *
+ * @retval NRF_SUCCESS        If the write was queued.
+ * @retval NRF_ERROR_BUSY     If the previous write is still in progress or the fds queue is full.
+ * @retval NRF_ERROR_NO_MEM   If flash is full, garbage collection was asked for.
+ */
+uint32_t m_agg_log_write(agg_stats_window_t const * p_windows, uint8_t count);
+
+/**@brief Function for taking the oldest record out of the log.
+ *
+ * @param[out] p_windows    Windows, room for M_AGG_LOG_BATCH.
+ * @param[out] p_count      Number of windows read.
+ *
+ * @retval NRF_SUCCESS           If a record was read, it is deleted.
+ * @retval NRF_ERROR_BUSY        If a write is still in progress or the fds queue is full.
+ * @retval NRF_ERROR_NOT_FOUND   If the log is empty.
+ */
+uint32_t m_agg_log_read(agg_stats_window_t * p_windows, uint8_t * p_count);
+
+#endif
@@ -39,6 +39,7 @@
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 #include "nrf_bootloader_info.h"
+#include "ble_dds.h"
 
 /**@brief BLE event types.
  */
@@ -87,8 +88,59 @@ void m_ble_advertising_start(bool erase_bonds);
 
 uint32_t m_ble_advertising_restart_without_whitelist(void);
 
+/**@brief Function for advertising at the stored interval again, for a gateway to reconnect quickly.
+ *
+ * @details Advertising backs off from the stored interval to the slow and very slow intervals once
+ *          the stored timeout has passed. While backed off this restarts it from the stored
+ *          interval, otherwise nothing changes.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code from the SoftDevice.
+ */
+uint32_t m_ble_advertising_boost(void);
+
 uint32_t m_sd_ble_gap_disconnect(void);
 
+/**@brief Function for setting the occupancy broadcast in the advertising data.
+ *
+ * @details Broadcasting, the advertising packet holds manufacturer specific data with the
+ *          occupancy, last session, people count and battery level, and advertising does not time
+ *          out. In legacy mode the name stays in the advertising packet and the service UUID moves
+ *          to the scan response. In extended mode the BLE 5 extended advertising data holds the
+ *          last sessions instead of the name and UUID. Nothing is broadcast while connected,
+ *          advertising stops then.
+ *
+ * @param[in] p_config    Mode and advertising interval.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code from the SoftDevice.
+ */
+uint32_t m_ble_broadcast_config_set(ble_dds_broadcast_t const * p_config);
+
+/**@brief Function for updating the broadcast occupancy, in place if advertising.
+ *
+ * @param[in] occupied    A motion session is in progress.
+ * @param[in] p_count     People count.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code from the SoftDevice.
+ */
+uint32_t m_ble_broadcast_occupancy_set(bool occupied, ble_dds_count_t const * p_count);
+
+/**@brief Function for adding a motion session that just ended to the broadcast, it is not occupied anymore.
+ *
+ * @param[in] p_count        People count, with the direction of the session.
+ * @param[in] duration_ms    Session length.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code from the SoftDevice.
+ */
+uint32_t m_ble_broadcast_session_add(ble_dds_count_t const * p_count, uint32_t duration_ms);
+
+/**@brief Function for updating the broadcast battery level, in place if advertising.
+ *
+ * @param[in] level_percent    Battery level, %.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code from the SoftDevice.
+ */
+uint32_t m_ble_broadcast_battery_set(uint8_t level_percent);
+
 /**@brief Function for initializing the BLE handling module..
  *
  *
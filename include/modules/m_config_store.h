@@ -0,0 +1,79 @@
+#ifndef __M_CONFIG_STORE_H__
+#define __M_CONFIG_STORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define M_CONFIG_STORE_VERSION          1           ///< Layout of the record, a record of another version is not loaded.
+#define M_CONFIG_STORE_SIZE             256         ///< Room for all values with their tags, bytes.
+#define M_CONFIG_STORE_DEBOUNCE_MS      2000        ///< Values set within this time of each other are written together.
+#define M_CONFIG_STORE_GC_CONTIG_WORDS  256         ///< Garbage is collected once less than this is left in one piece, and some of it is garbage.
+
+/**@brief Tags of the stored values. A tag is never reused for another type. */
+typedef enum
+{
+    M_CONFIG_STORE_TAG_BLE = 1,                     ///< ble_dcs_params_t.
+    M_CONFIG_STORE_TAG_DETECTION,                   ///< ble_dds_config_t.
+    M_CONFIG_STORE_TAG_AGG_WINDOW,                  ///< uint16_t, aggregation window length in s.
+    M_CONFIG_STORE_TAG_BROADCAST,                   ///< ble_dds_broadcast_t.
+    M_CONFIG_STORE_TAG_RANGE_BG,                    ///< Range background settings and model.
+    M_CONFIG_STORE_TAG_AGG_BOOT,                    ///< uint8_t, resets on which aggregation ran, see AGG_STATS_TS_UNSET.
+} m_config_store_tag_t;
+
+/**@brief Function for initializing the flash data storage and loading the configuration.
+ *
+ * @details fds is initialized here, once for every module using it. All values are kept in one
+ *          record as tag, length and value, the record starts with M_CONFIG_STORE_VERSION.
+ *          Without such a record, the values of the separate configuration files used before are
+ *          imported and written at once. Those files are deleted after the write. The SoftDevice
+ *          must be enabled first.
+ *
+ * @retval NRF_SUCCESS If initialization was successful.
+ * @retval Other codes from the underlying drivers.
+ */
+uint32_t m_config_store_init(void);
+
+/**@brief Function for loading a value.
+ *
+ * @details A value stored shorter, by older firmware, reads with the rest zero.
+ *
+ * @param[in]  tag       Tag of the value.
+ * @param[out] p_value   Value.
+ * @param[in]  len       Length of the value.
+ *
+ * @retval NRF_SUCCESS           If the value was found.
+ * @retval NRF_ERROR_NOT_FOUND   If it was never stored, p_value is left as it is.
+ */
+uint32_t m_config_store_load(m_config_store_tag_t tag, void * p_value, uint8_t len);
+
+/**@brief Function for storing a value, from any context.
+ *
+ * @details The record is written M_CONFIG_STORE_DEBOUNCE_MS after the last change, once for
+ *          every value changed until then. Setting a value to what it is does not write.
+ *
+ * @param[in] tag       Tag of the value.
+ * @param[in] p_value   Value, copied.
+ * @param[in] len       Length of the value.
+ *
+ * @retval NRF_SUCCESS        If the value was taken.
+ * @retval NRF_ERROR_NO_MEM   If there is no room left for it in M_CONFIG_STORE_SIZE.
+ */
+uint32_t m_config_store_set(m_config_store_tag_t tag, void const * p_value, uint8_t len);
+
+/**@brief Function for holding garbage collection back, while sampling.
+ *
+ * @details Collecting garbage erases flash pages, which stalls the CPU. Writes go on.
+ *
+ * @param[in] hold   true to hold garbage collection until called with false.
+ */
+void m_config_store_gc_hold(bool hold);
+
+/**@brief Function for asking for garbage collection, when a write found flash full.
+ */
+void m_config_store_gc_request(void);
+
+/**@brief Function for collecting garbage when due and not held, called from the main loop.
+ */
+void m_config_store_process(void);
+
+#endif
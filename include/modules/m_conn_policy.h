@@ -0,0 +1,66 @@
+#ifndef __M_CONN_POLICY_H__
+#define __M_CONN_POLICY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+#define M_CONN_POLICY_FAST_MIN_INT_MS       7.5     ///< Connection interval while data flows.
+#define M_CONN_POLICY_FAST_MAX_INT_MS       15
+#define M_CONN_POLICY_FAST_LATENCY          0
+#define M_CONN_POLICY_FAST_SUP_TIMEOUT_MS   4000
+
+#define M_CONN_POLICY_IDLE_MIN_INT_MS       400     ///< Connection interval while nothing is streamed.
+#define M_CONN_POLICY_IDLE_MAX_INT_MS       500
+#define M_CONN_POLICY_IDLE_LATENCY          4       ///< Connection events the peripheral may skip when it has nothing to send.
+#define M_CONN_POLICY_IDLE_SUP_TIMEOUT_MS   6000    ///< Above (1 + latency) * max interval * 2.
+
+#define M_CONN_POLICY_IDLE_HOLDOFF_MS       5000    ///< Demand has to be gone this long before falling back to idle.
+
+/**@brief Reasons for the fast connection interval, each set and cleared by its owner.
+ */
+typedef enum
+{
+    M_CONN_POLICY_DEMAND_STREAM,        ///< Samples are notified as they are taken.
+    M_CONN_POLICY_DEMAND_BACKLOG,       ///< Notifications are waiting for a TX buffer.
+    M_CONN_POLICY_DEMAND_COUNT
+} m_conn_policy_demand_t;
+
+/**@brief Function for initializing the connection parameter policy.
+ *
+ * @details Requests the fast parameters as soon as there is demand, and the idle parameters once
+ *          there has been none for M_CONN_POLICY_IDLE_HOLDOFF_MS. The demand is shared, every
+ *          connected central gets the same profile. A request a central is busy with is retried
+ *          when its parameter update completes.
+ */
+uint32_t m_conn_policy_init(void);
+
+/**@brief Function for passing BLE events to the policy.
+ */
+void m_conn_policy_on_ble_evt(ble_evt_t const * p_ble_evt);
+
+/**@brief Function for setting or clearing a demand for the fast parameters.
+ */
+void m_conn_policy_demand_set(m_conn_policy_demand_t demand, bool active);
+
+/**@brief Function for handing the parameters of a connection to its peer.
+ *
+ * @details Called when the peer writes the connection parameters characteristic. The policy
+ *          leaves that connection alone until it is closed.
+ *
+ * @param[in] conn_handle    Connection of the peer.
+ */
+void m_conn_policy_override(uint16_t conn_handle);
+
+/**@brief Function for checking if a failed parameter negotiation was requested by the policy.
+ *
+ * @details The central may keep its own parameters, the policy then stays with them until the
+ *          demand changes instead of disconnecting.
+ *
+ * @param[in] conn_handle    Connection the negotiation failed on.
+ *
+ * @retval true if the policy requested the parameters that failed.
+ */
+bool m_conn_policy_negotiation_failed(uint16_t conn_handle);
+
+#endif
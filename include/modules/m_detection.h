@@ -26,7 +26,23 @@ typedef struct
         .eth24h            =  200,                     \
         .eth24l            = -200                      \
     },                                                 \
-    .sample_mode          = SAMPLE_MODE_MOTION         \
+    .sample_mode          = SAMPLE_MODE_MOTION,        \
+    .calibration          =                            \
+    {                                                  \
+        .window_s            = 60,                     \
+        .false_wakes_per_day = 4                       \
+    },                                                 \
+    .session              =                            \
+    {                                                  \
+        .timeout             = 30,                     \
+        .min_length          = 0,                      \
+        .holdoff             = 0                       \
+    },                                                 \
+    .range_report         =                            \
+    {                                                  \
+        .deadband_mm         = 0,                      \
+        .heartbeat_s         = 0                       \
+    }                                                  \
 }
 
 uint32_t m_detection_init(m_ble_service_handle_t * p_handle, m_detection_init_t * p_params);
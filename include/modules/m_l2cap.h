@@ -0,0 +1,76 @@
+#ifndef __M_L2CAP_H__
+#define __M_L2CAP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+#define M_L2CAP_PSM                 0x0081                  ///< LE PSM of the bulk channel, in the dynamic range.
+#define M_L2CAP_SDU_MAX             512                     ///< Largest SDU sent, also limited by the MTU of the peer.
+#define M_L2CAP_RX_MTU              BLE_L2CAP_MTU_MIN       ///< Largest SDU received, commands are short.
+#define M_L2CAP_TX_MPS              247                     ///< One PDU fills a 251 byte link layer packet.
+#define M_L2CAP_TX_QUEUE_SIZE       2                       ///< SDUs queued in the SoftDevice.
+
+/**@brief Bulk channel event types.
+ */
+typedef enum
+{
+    M_L2CAP_EVT_OPENED,         ///< A central opened the channel.
+    M_L2CAP_EVT_CLOSED,         ///< The channel was released or its connection closed.
+    M_L2CAP_EVT_RX,             ///< An SDU was received, p_data and length are valid.
+    M_L2CAP_EVT_TX_DONE,        ///< An SDU was sent, its buffer is free again.
+} m_l2cap_evt_type_t;
+
+/**@brief Bulk channel event.
+ */
+typedef struct
+{
+    m_l2cap_evt_type_t type;
+    uint8_t const    * p_data;
+    uint16_t           length;
+} m_l2cap_evt_t;
+
+/**@brief Bulk channel event handler type, called from the SoftDevice event interrupt.
+ */
+typedef void (*m_l2cap_evt_handler_t)(m_l2cap_evt_t const * p_evt);
+
+/**@brief Function for adding the L2CAP channel to the SoftDevice configuration.
+ *
+ * @details Called between nrf_sdh_ble_default_cfg_set and nrf_sdh_ble_enable.
+ *
+ * @param[in] conn_cfg_tag    Connection configuration tag used for advertising.
+ * @param[in] ram_start       Start of the application RAM.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t m_l2cap_cfg_set(uint8_t conn_cfg_tag, uint32_t ram_start);
+
+/**@brief Function for setting the handler of the bulk channel events.
+ */
+void m_l2cap_init(m_l2cap_evt_handler_t evt_handler);
+
+/**@brief Function for passing BLE events to the bulk channel.
+ */
+void m_l2cap_on_ble_evt(ble_evt_t const * p_ble_evt);
+
+/**@brief Function for checking if a central has the channel open.
+ */
+bool m_l2cap_is_open(void);
+
+/**@brief Function for getting the largest SDU the peer takes, at most M_L2CAP_SDU_MAX.
+ */
+uint16_t m_l2cap_sdu_max(void);
+
+/**@brief Function for sending an SDU.
+ *
+ * @details The data is copied, the caller may reuse its buffer.
+ *
+ * @param[in] p_data    SDU.
+ * @param[in] length    SDU length, at most @ref m_l2cap_sdu_max.
+ *
+ * @return NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if the channel is not open,
+ *         NRF_ERROR_RESOURCES if all TX buffers are in use, otherwise an error code.
+ */
+uint32_t m_l2cap_send(uint8_t const * p_data, uint16_t length);
+
+#endif
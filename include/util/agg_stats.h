@@ -0,0 +1,52 @@
+#ifndef __AGG_STATS_H__
+#define __AGG_STATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_dds.h"
+
+/**@brief Running statistics of one channel over an aggregation window (Welford).
+ */
+typedef struct
+{
+    uint32_t count;
+    float    mean;
+    float    m2;        ///< Sum of squared differences from the mean.
+    int16_t  min;
+    int16_t  max;
+} agg_stats_t;
+
+#define AGG_STATS_TS_UNSET          0x80000000UL    ///< Timestamp flag, taken before the time was set.
+#define AGG_STATS_TS_BOOT_POS       24              ///< Reset count of an unset timestamp, counting up modulo 128.
+#define AGG_STATS_TS_BOOT_MASK      0x7F
+#define AGG_STATS_TS_UPTIME_MASK    0x00FFFFFFUL    ///< s since that reset of an unset timestamp.
+
+/**@brief One aggregation window, kept until it is notified.
+ */
+typedef PACKED( struct
+{
+    uint32_t                    timestamp;          ///< End of the window, s since 1970-01-01 UTC, or AGG_STATS_TS_UNSET with the reset count and s since it.
+    uint32_t                    presence_count;     ///< Samples of IR1 - IR4.
+    uint32_t                    range_count;        ///< Samples of the range.
+    ble_dds_aggregate_summary_t summary[BLE_DDS_AGGREGATE_CHANNELS];
+}) agg_stats_window_t;
+
+/**@brief Function for starting a new window.
+ */
+void agg_stats_reset(agg_stats_t * p_stats);
+
+/**@brief Function for adding a sample to the window.
+ */
+void agg_stats_add(agg_stats_t * p_stats, int16_t value);
+
+/**@brief Function for summarizing the window.
+ *
+ * @details Mean and standard deviation are rounded to the unit of the samples. A window without
+ *          samples is summarized as all zero.
+ *
+ * @param[in]  p_stats      Window statistics.
+ * @param[out] p_summary    Summary.
+ */
+void agg_stats_summary_get(agg_stats_t const * p_stats, ble_dds_aggregate_summary_t * p_summary);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef __DET_CONFIG_H__
+#define __DET_CONFIG_H__
+
+#include <stdbool.h>
+#include "ble_dds.h"
+
+/**@brief Function for giving each detection setting out of range its default, the others are kept.
+ *
+ * @details A configuration stored by older firmware ends before the settings added since, they
+ *          read as zero, which is out of range for them. The thresholds, the calibration and the
+ *          session settings are replaced as a group.
+ *
+ * @param[in,out] p_config     Configuration.
+ * @param[in]     p_default    Default configuration.
+ *
+ * @retval true if a setting was replaced.
+ */
+bool det_config_verify(ble_dds_config_t * p_config, ble_dds_config_t const * p_default);
+
+#endif
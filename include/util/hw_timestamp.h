@@ -0,0 +1,64 @@
+#ifndef __HW_TIMESTAMP_H__
+#define __HW_TIMESTAMP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HW_TIMESTAMP_FREQ               31250       ///< Timestamp counter frequency [Hz].
+
+/**@brief Macro for converting a timestamp tick difference to milliseconds. */
+#define HW_TIMESTAMP_TO_MS(ticks)       ((uint32_t)(((uint64_t)(ticks) * 1000) / HW_TIMESTAMP_FREQ))
+
+/**@brief Timestamped interrupt sources, one TIMER capture register each. */
+typedef enum
+{
+    HW_TIMESTAMP_SRC_PRESENCE,
+    HW_TIMESTAMP_SRC_RANGE,
+    HW_TIMESTAMP_SRC_COUNT
+} hw_timestamp_src_t;
+
+/**@brief Function for initializing the timestamps.
+ *
+ * @details Timestamps count HW_TIMESTAMP_FREQ ticks on one time base. It is taken from the RTC,
+ *          through @ref wall_clock_ticks, and from TIMER1 while precise timestamps are on, see
+ *          @ref hw_timestamp_precise_set.
+ *
+ * @retval NRF_SUCCESS If initialization was successful.
+ */
+uint32_t hw_timestamp_init(void);
+
+/**@brief Function for capturing an event in hardware, through PPI.
+ *
+ * @param[in] src          Capture register to use.
+ * @param[in] event_addr   Address of the event register, e.g. a GPIOTE IN event.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code from the SoftDevice.
+ */
+uint32_t hw_timestamp_attach(hw_timestamp_src_t src, uint32_t event_addr);
+
+/**@brief Function for no longer capturing the event of a source.
+ */
+void hw_timestamp_detach(hw_timestamp_src_t src);
+
+/**@brief Function for getting the timestamp of the last event of a source.
+ *
+ * @details Safe to call from the interrupt handler of the event. The event is captured in
+ *          hardware only while precise timestamps are on, otherwise it is stamped now.
+ */
+uint32_t hw_timestamp_get(hw_timestamp_src_t src);
+
+/**@brief Function for getting the current timestamp. Main context only.
+ */
+uint32_t hw_timestamp_now(void);
+
+/**@brief Function for turning precise timestamps on or off.
+ *
+ * @details While on, TIMER1 runs and events are captured through PPI, which keeps the HFCLK
+ *          requested. While off, the timestamps come from the RTC at interrupt time, at no cost
+ *          in idle current. The time base goes on across the switch.
+ *
+ * @param[in] precise   true while sampling is active, a motion session or a stream.
+ */
+void hw_timestamp_precise_set(bool precise);
+
+#endif
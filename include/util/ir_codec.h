@@ -0,0 +1,74 @@
+#ifndef __IR_CODEC_H__
+#define __IR_CODEC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_dds.h"
+
+#define IR_CODEC_PACKET_MAX             BLE_DDS_MAX_DATA_LEN    ///< Bytes per packet, one notification.
+#define IR_CODEC_PACKET_HEADER          2                       ///< Sequence number and frame count.
+#define IR_CODEC_KEYFRAME_INTERVAL      32                      ///< Frames between keyframes.
+#define IR_CODEC_CHANNELS               4
+
+/**@brief Adaptive Rice parameter state of one residual. */
+typedef struct
+{
+    uint32_t sum;       ///< Sum of recent mapped residuals.
+    uint16_t count;     ///< Number of residuals in the sum.
+} ir_codec_rice_t;
+
+/**@brief Prediction state, identical in encoder and decoder after every frame. */
+typedef struct
+{
+    ble_dds_presence_t prev;                        ///< Last frame.
+    int32_t            prev_dt;                     ///< Last timestamp step.
+    uint8_t            since_key;                   ///< Frames since the last keyframe.
+    bool               keyed;                       ///< A keyframe has been coded since the reset.
+    ir_codec_rice_t    rice[IR_CODEC_CHANNELS + 1]; ///< Timestamp step, then IR1 - IR4.
+} ir_codec_state_t;
+
+/**@brief Streaming encoder of presence samples into notification sized packets.
+ *
+ * @details Packet: uint8_t sequence number, uint8_t frame count, then the frames as a bit stream,
+ *          MSB first, zero padded to a byte. A frame starts with a keyframe bit and the 2 bit marker.
+ *          A keyframe then holds the 32 bit timestamp and IR1 - IR4 as 16 bit values. Any other
+ *          frame holds the change of the timestamp step and the change of IR1 - IR4 since the last
+ *          frame, zigzag mapped and Rice coded with a per field adaptive parameter.
+ */
+typedef struct
+{
+    ir_codec_state_t state;
+    uint8_t          buf[IR_CODEC_PACKET_MAX];
+    uint16_t         bits;                      ///< Bits used in buf, header included.
+    uint8_t          seq;                       ///< Sequence number of the packet being filled.
+    uint8_t          frames;                    ///< Frames in the packet being filled.
+    uint32_t         first_timestamp;           ///< Timestamp of the first frame in the packet.
+} ir_codec_t;
+
+/**@brief Function for restarting the stream, the next frame is a keyframe.
+ */
+void ir_codec_reset(ir_codec_t * p_codec);
+
+/**@brief Function for appending a sample to the packet being filled.
+ *
+ * @param[in] p_codec     Encoder.
+ * @param[in] p_sample    Sample.
+ *
+ * @retval true if the sample was coded, false if it does not fit and the packet has to be sent first.
+ */
+bool ir_codec_put(ir_codec_t * p_codec, ble_dds_presence_t const * p_sample);
+
+/**@brief Function for getting the packet being filled.
+ *
+ * @param[in]  p_codec    Encoder.
+ * @param[out] pp_data    Packet.
+ *
+ * @return Packet length in bytes, 0 if it holds no frame.
+ */
+uint16_t ir_codec_packet_get(ir_codec_t * p_codec, uint8_t const ** pp_data);
+
+/**@brief Function for starting a new packet once the current one has been sent.
+ */
+void ir_codec_packet_release(ir_codec_t * p_codec);
+
+#endif
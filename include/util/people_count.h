@@ -0,0 +1,70 @@
+#ifndef __PEOPLE_COUNT_H__
+#define __PEOPLE_COUNT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_dds.h"
+
+#define PEOPLE_COUNT_LAG_MAX            10          ///< Longest IR1/IR3 or IR2/IR4 delay searched, in samples.
+#define PEOPLE_COUNT_SAMPLES_MIN        4           ///< Shorter sessions are not classified.
+#define PEOPLE_COUNT_CORR_MIN           0.4f        ///< Lowest normalized correlation accepted as one crossing.
+#define PEOPLE_COUNT_RANGE_MAX_MM       1500        ///< Sessions with nothing ranged closer are passers-by.
+
+/**@brief Direction of travel of a motion session.
+ *
+ * @details Entering is moving from IR1 towards IR3, or from IR2 towards IR4.
+ */
+typedef enum
+{
+    PEOPLE_COUNT_NONE,
+    PEOPLE_COUNT_ENTER,
+    PEOPLE_COUNT_EXIT,
+    PEOPLE_COUNT_PASSER_BY,
+} people_count_dir_t;
+
+/**@brief Estimator state for one motion session.
+ */
+typedef struct
+{
+    float    baseline[4];                               ///< Idle IR1..IR4.
+    bool     baseline_valid;
+    float    hist[PEOPLE_COUNT_LAG_MAX][4];             ///< Last samples, baseline removed.
+    uint8_t  hist_pos;
+    uint16_t count;                                     ///< Samples in the session.
+    float    energy[4];                                 ///< Sum of squares per channel.
+    float    corr13[2 * PEOPLE_COUNT_LAG_MAX + 1];      ///< IR3 against IR1 delayed by lag - PEOPLE_COUNT_LAG_MAX.
+    float    corr24[2 * PEOPLE_COUNT_LAG_MAX + 1];      ///< IR4 against IR2 delayed by lag - PEOPLE_COUNT_LAG_MAX.
+    uint16_t range_min;                                 ///< Closest range in the session, mm.
+    bool     range_seen;
+} people_count_t;
+
+/**@brief Function for feeding an idle sample, taken while waiting for motion, into the baseline.
+ */
+void people_count_idle(people_count_t * p_count, ble_dds_presence_t const * p_sample);
+
+/**@brief Function for starting a motion session.
+ */
+void people_count_session_start(people_count_t * p_count);
+
+/**@brief Function for feeding a presence sample taken during the session, at the sampling rate.
+ */
+void people_count_sample(people_count_t * p_count, ble_dds_presence_t const * p_sample);
+
+/**@brief Function for feeding a range reading taken during the session.
+ */
+void people_count_range(people_count_t * p_count, uint16_t range_mm);
+
+/**@brief Function for ending the session and estimating the direction of travel.
+ *
+ * @details The delay between the two elements of each pair is the lag that maximizes their cross
+ *          correlation. The pair with the stronger normalized correlation at a non zero lag gives
+ *          the direction. If the range sensor ran and never saw anything close, the session was
+ *          someone passing by.
+ *
+ * @param[in] p_count    Estimator.
+ *
+ * @return Direction of the session.
+ */
+people_count_dir_t people_count_session_end(people_count_t * p_count);
+
+#endif
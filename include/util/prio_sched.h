@@ -0,0 +1,120 @@
+#ifndef __PRIO_SCHED_H__
+#define __PRIO_SCHED_H__
+
+#include <stdint.h>
+#include "app_util.h"
+#include "app_error.h"
+#include "app_scheduler.h"
+
+/**@brief Event classes, executed strictly in this order. */
+typedef enum
+{
+    PRIO_SCHED_HIGH,        ///< Timer expirations and BLE library work, everything put with app_sched_event_put.
+    PRIO_SCHED_NORMAL,      ///< Sensor interrupt events.
+    PRIO_SCHED_LOW,         ///< Periodic sampling and battery measurements.
+    PRIO_SCHED_COUNT
+} prio_sched_prio_t;
+
+/**@brief Number of latency histogram buckets. Bucket n counts latencies below 2^n RTC ticks,
+ *        the last bucket counts everything longer. */
+#define PRIO_SCHED_LATENCY_BUCKETS      10
+
+/**@brief Per class statistics. */
+typedef struct
+{
+    uint32_t executed;                                  ///< Events executed.
+    uint32_t overflows;                                 ///< Events rejected because the queue was full.
+    uint16_t high_water;                                ///< Most events queued at once.
+    uint32_t latency_max;                               ///< Longest wait from put to execution, in RTC ticks.
+    uint32_t latency[PRIO_SCHED_LATENCY_BUCKETS];       ///< Wait histogram, see @ref PRIO_SCHED_LATENCY_BUCKETS.
+} prio_sched_stats_t;
+
+/**@brief Stored ahead of the event data in every queue slot. */
+typedef struct
+{
+    app_sched_event_handler_t handler;
+    uint32_t                  tick;         ///< RTC tick of the put, for the latency histogram.
+    uint16_t                  size;
+} prio_sched_event_header_t;
+
+/**@brief Size of one queue slot, the header and the largest event, word aligned. */
+#define PRIO_SCHED_SLOT_SIZE(EVENT_SIZE)                                                            \
+    ALIGN_NUM(sizeof(uint32_t), sizeof(prio_sched_event_header_t) + (EVENT_SIZE))
+
+/**@brief Buffer size needed by one class queue. */
+#define PRIO_SCHED_BUF_SIZE(EVENT_SIZE, QUEUE_SIZE)                                                 \
+    ((QUEUE_SIZE) * PRIO_SCHED_SLOT_SIZE(EVENT_SIZE))
+
+/**@brief Macro for initializing one class queue with a static buffer.
+ */
+#define PRIO_SCHED_QUEUE_INIT(PRIO, EVENT_SIZE, QUEUE_SIZE)                                         \
+    do                                                                                              \
+    {                                                                                               \
+        static uint32_t PRIO_SCHED_BUF[CEIL_DIV(PRIO_SCHED_BUF_SIZE((EVENT_SIZE), (QUEUE_SIZE)),    \
+                                                sizeof(uint32_t))];                                 \
+        uint32_t ERR_CODE = prio_sched_queue_init((PRIO), (EVENT_SIZE), (QUEUE_SIZE),               \
+                                                  PRIO_SCHED_BUF);                                  \
+        APP_ERROR_CHECK(ERR_CODE);                                                                  \
+    } while (0)
+
+/**@brief Macro for initializing the scheduler, replaces APP_SCHED_INIT.
+ *
+ * @param[in] EVENT_SIZE     Largest event data size.
+ * @param[in] HIGH_SIZE      Queue size of @ref PRIO_SCHED_HIGH.
+ * @param[in] NORMAL_SIZE    Queue size of @ref PRIO_SCHED_NORMAL.
+ * @param[in] LOW_SIZE       Queue size of @ref PRIO_SCHED_LOW.
+ */
+#define PRIO_SCHED_INIT(EVENT_SIZE, HIGH_SIZE, NORMAL_SIZE, LOW_SIZE)                               \
+    do                                                                                              \
+    {                                                                                               \
+        PRIO_SCHED_QUEUE_INIT(PRIO_SCHED_HIGH,   (EVENT_SIZE), (HIGH_SIZE));                        \
+        PRIO_SCHED_QUEUE_INIT(PRIO_SCHED_NORMAL, (EVENT_SIZE), (NORMAL_SIZE));                      \
+        PRIO_SCHED_QUEUE_INIT(PRIO_SCHED_LOW,    (EVENT_SIZE), (LOW_SIZE));                         \
+    } while (0)
+
+/**@brief Function for initializing the queue of one class, use @ref PRIO_SCHED_INIT instead.
+ *
+ * @param[in] prio          Class.
+ * @param[in] event_size    Largest event data size.
+ * @param[in] queue_size    Number of events the queue holds.
+ * @param[in] p_buf         Buffer of @ref PRIO_SCHED_BUF_SIZE bytes, word aligned.
+ *
+ * @retval NRF_SUCCESS              If the queue was initialized.
+ * @retval NRF_ERROR_INVALID_PARAM  If prio or queue_size is invalid.
+ */
+uint32_t prio_sched_queue_init(prio_sched_prio_t prio, uint16_t event_size, uint16_t queue_size, uint32_t * p_buf);
+
+/**@brief Function for queuing an event in a class. Safe from any interrupt priority.
+ *
+ * @details app_sched_event_put queues in @ref PRIO_SCHED_HIGH.
+ *
+ * @param[in] p_event_data  Event data, copied into the queue. May be NULL if event_size is 0.
+ * @param[in] event_size    Event data size.
+ * @param[in] handler       Handler executed in main context.
+ * @param[in] prio          Class.
+ *
+ * @retval NRF_SUCCESS              If the event was queued.
+ * @retval NRF_ERROR_INVALID_LENGTH If event_size is larger than the queue's event size.
+ * @retval NRF_ERROR_NO_MEM         If the class queue is full, counted in the overflows.
+ */
+uint32_t prio_sched_event_put(void const              * p_event_data,
+                              uint16_t                  event_size,
+                              app_sched_event_handler_t handler,
+                              prio_sched_prio_t         prio);
+
+/**@brief Function for executing queued events until all classes are empty.
+ *
+ * @details One event runs at a time, always from the highest class that has any, so a high class
+ *          event waits at most for the one handler already running. app_sched_execute calls this
+ *          function.
+ */
+void prio_sched_execute(void);
+
+/**@brief Function for getting the statistics of a class.
+ *
+ * @param[in]  prio       Class.
+ * @param[out] p_stats    Statistics.
+ */
+void prio_sched_stats_get(prio_sched_prio_t prio, prio_sched_stats_t * p_stats);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __RANGE_BG_H__
+#define __RANGE_BG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RANGE_BG_LEARN_READINGS         32          ///< Readings averaged before the background is used.
+#define RANGE_BG_SIGMAS                 3.0f        ///< Foreground is nearer than the background by at least this many standard deviations.
+#define RANGE_BG_ABSORB_READINGS        3000        ///< Foreground seen for this many readings in a row is the new background.
+#define RANGE_BG_NO_TARGET_MM           8000        ///< The VL53L0X reports about 8190 mm when nothing is in range.
+
+/**@brief Learned background range, the floor or wall the sensor sees when nobody is there.
+ */
+typedef struct
+{
+    float    mean;          ///< Background range, mm.
+    float    var;           ///< Background variance, mm^2.
+    uint16_t count;         ///< Readings learned, up to RANGE_BG_LEARN_READINGS.
+    uint16_t fg_run;        ///< Foreground readings in a row.
+} range_bg_t;
+
+/**@brief Function for forgetting the background and learning it again.
+ */
+void range_bg_reset(range_bg_t * p_bg);
+
+/**@brief Function for checking if the background has been learned.
+ */
+bool range_bg_learned(range_bg_t const * p_bg);
+
+/**@brief Function for classifying a range reading and adapting the background.
+ *
+ * @details While learning, readings are averaged. A reading further away than the average
+ *          means something stood in front of the background, learning starts over from it. Once
+ *          learned, the background follows the readings that are not foreground slowly. A
+ *          reading is foreground when it is nearer than the background by both margin_mm and
+ *          RANGE_BG_SIGMAS standard deviations.
+ *
+ * @param[in] p_bg         Background.
+ * @param[in] range_mm     Reading.
+ * @param[in] margin_mm    Smallest distance in front of the background that is foreground.
+ *
+ * @retval true if the reading is foreground, always false while learning.
+ */
+bool range_bg_update(range_bg_t * p_bg, uint16_t range_mm, uint16_t margin_mm);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef __SAMPLE_SCHED_H__
+#define __SAMPLE_SCHED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_timer.h"
+
+/**@brief Longest delay or period accepted, in RTC ticks (half the 24 bit counter range, 256 s). */
+#define SAMPLE_SCHED_MAX_TICKS          ((APP_TIMER_MAX_CNT_VAL + 1) / 2 - 1)
+
+/**@brief Macro for converting milliseconds to scheduler ticks. */
+#define SAMPLE_SCHED_TICKS(MS)          APP_TIMER_TICKS(MS)
+
+/**@brief Action handler, called in main context. */
+typedef void (*sample_sched_handler_t)(void * p_context);
+
+/**@brief Scheduled action. Memory is owned by the user, see @ref SAMPLE_SCHED_DEF.
+ */
+typedef struct sample_sched_action_s
+{
+    sample_sched_handler_t          handler;
+    void                          * p_context;
+    uint32_t                        period;     ///< Ticks between runs, 0 for single shot.
+    uint32_t                        due;        ///< RTC tick of the next run.
+    bool                            queued;     ///< In the list of due actions.
+    struct sample_sched_action_s  * p_next;     ///< Action due next.
+} sample_sched_action_t;
+
+/**@brief Macro for defining an action. */
+#define SAMPLE_SCHED_DEF(_name)         static sample_sched_action_t _name
+
+/**@brief Function for initializing the scheduler.
+ *
+ * @details All actions share one single shot app_timer, armed for the earliest due action.
+ *          app_timer must be initialized first.
+ *
+ * @retval NRF_SUCCESS If initialization was successful.
+ */
+uint32_t sample_sched_init(void);
+
+/**@brief Function for setting up an action, see app_timer_create.
+ *
+ * @param[in] p_action     Action.
+ * @param[in] handler      Called every time the action is due.
+ *
+ * @retval NRF_SUCCESS If the action was set up.
+ */
+uint32_t sample_sched_create(sample_sched_action_t * p_action, sample_sched_handler_t handler);
+
+/**@brief Function for starting or restarting an action.
+ *
+ * @param[in] p_action     Action.
+ * @param[in] delay        Ticks until the first run.
+ * @param[in] period       Ticks between runs, 0 to run once.
+ * @param[in] p_context    Passed to the handler.
+ *
+ * @retval NRF_SUCCESS              If the action was started.
+ * @retval NRF_ERROR_INVALID_PARAM  If delay or period exceed SAMPLE_SCHED_MAX_TICKS.
+ */
+uint32_t sample_sched_start(sample_sched_action_t * p_action, uint32_t delay, uint32_t period, void * p_context);
+
+/**@brief Function for starting an action in phase with another one.
+ *
+ * @details Runs are placed offset ticks after the runs of p_ref, so actions sharing a bus can be
+ *          staggered. If p_ref is not running, the first run is offset ticks from now.
+ *
+ * @param[in] p_action     Action.
+ * @param[in] p_ref        Action to align to.
+ * @param[in] offset       Ticks after p_ref.
+ * @param[in] period       Ticks between runs, 0 to run once.
+ * @param[in] p_context    Passed to the handler.
+ *
+ * @retval NRF_SUCCESS              If the action was started.
+ * @retval NRF_ERROR_INVALID_PARAM  If offset or period exceed SAMPLE_SCHED_MAX_TICKS.
+ */
+uint32_t sample_sched_start_aligned(sample_sched_action_t       * p_action,
+                                    sample_sched_action_t const * p_ref,
+                                    uint32_t                      offset,
+                                    uint32_t                      period,
+                                    void                        * p_context);
+
+/**@brief Function for stopping an action. Stopping a stopped action does nothing.
+ */
+void sample_sched_stop(sample_sched_action_t * p_action);
+
+/**@brief Function for checking if an action is due to run.
+ */
+bool sample_sched_is_running(sample_sched_action_t const * p_action);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_util.h"
+#include "nrf_atomic.h"
+
+/**@brief Lock-free single producer, single consumer ring.
+ *
+ * @details The producer (typically an interrupt handler) only writes the write index and the
+ *          consumer (typically main context) only writes the read index. Both indexes run freely
+ *          and are masked on access, so no element is lost to tell a full ring from an empty one.
+ */
+typedef struct
+{
+    uint8_t        * p_buf;         ///< Element storage.
+    uint16_t         elem_size;     ///< Size of one element in bytes.
+    uint16_t         mask;          ///< Number of elements minus one, the number of elements is a power of two.
+    nrf_atomic_u32_t wr;            ///< Elements put, written by the producer only.
+    nrf_atomic_u32_t rd;            ///< Elements taken, written by the consumer only.
+} spsc_ring_t;
+
+/**@brief Macro for defining a ring.
+ *
+ * @param[in] _name    Name of the ring instance.
+ * @param[in] _type    Element type.
+ * @param[in] _size    Number of elements, must be a power of two.
+ */
+#define SPSC_RING_DEF(_name, _type, _size)                                                          \
+    STATIC_ASSERT(IS_POWER_OF_TWO(_size));                                                          \
+    static _type CONCAT_2(_name, _buf)[_size];                                                      \
+    static spsc_ring_t _name =                                                                      \
+    {                                                                                               \
+        .p_buf     = (uint8_t *)CONCAT_2(_name, _buf),                                              \
+        .elem_size = sizeof(_type),                                                                 \
+        .mask      = (_size) - 1,                                                                   \
+    }
+
+/**@brief Function for putting an element, producer side.
+ *
+ * @param[in] p_ring    Ring.
+ * @param[in] p_elem    Element to copy in.
+ *
+ * @retval true if the element was put, false if the ring was full.
+ */
+bool spsc_ring_put(spsc_ring_t * p_ring, void const * p_elem);
+
+/**@brief Function for taking the oldest element, consumer side.
+ *
+ * @param[in]  p_ring    Ring.
+ * @param[out] p_elem    Element copied out.
+ *
+ * @retval true if an element was taken, false if the ring was empty.
+ */
+bool spsc_ring_get(spsc_ring_t * p_ring, void * p_elem);
+
+/**@brief Function for getting the number of elements in the ring.
+ *
+ * @details Exact on the consumer side, it can only grow behind the caller's back.
+ */
+uint32_t spsc_ring_count(spsc_ring_t const * p_ring);
+
+/**@brief Function for dropping all elements, consumer side.
+ */
+void spsc_ring_flush(spsc_ring_t * p_ring);
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef __TLOG_H__
+#define __TLOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_log.h"
+
+#ifndef TLOG_ENABLED
+#define TLOG_ENABLED                1           ///< Hot path log sites are tokenized, 0 formats them through nrf_log instead.
+#endif
+
+#define TLOG_RTT_CHANNEL            1           ///< RTT up buffer of the records, nrf_log writes to buffer 0.
+#define TLOG_BUF_SIZE               1024        ///< Size of the RTT up buffer.
+#define TLOG_ARGS_MAX               6           ///< Most arguments of one log site, more are dropped.
+#define TLOG_CMD_BUF_SIZE           16          ///< Size of the RTT down buffer the filter commands are read from.
+#define TLOG_CMD_LEN_MAX            24          ///< Longest filter command line.
+
+/**@brief Modules of the log sites, each with its own filter. */
+typedef enum
+{
+    TLOG_MODULE_AK9750,                         ///< Presence sensor driver.
+    TLOG_MODULE_VL53L0X,                        ///< Range sensor driver.
+    TLOG_MODULE_DETECTION,                      ///< Detection module.
+    TLOG_MODULE_COUNT
+} tlog_module_t;
+
+#define TLOG_MODULE_NAMES           {"ak9750", "vl53l0x", "detection"}
+
+#if TLOG_ENABLED
+
+/**@brief Macro for the token of a format string.
+ *
+ * @details The string goes to the .tlog_fmt section, which the linker script places at address 0
+ *          and keeps out of the image. Its address is the token, the decoder reads the strings
+ *          from the ELF file.
+ */
+#define TLOG_TOKEN(_fmt)                                                                            \
+    ({                                                                                              \
+        static char const _tlog_fmt[] __attribute__((section(".tlog_fmt"), used)) = _fmt;           \
+        (uint16_t)(uintptr_t)_tlog_fmt;                                                             \
+    })
+
+/**@brief Macro for logging from the sampling path.
+ *
+ * @details Arguments are stored as uint32_t, printf integer conversions only. Nothing is built
+ *          for a call the filter of the module drops.
+ */
+#define TLOG(_module, _fmt, ...)                                                                    \
+    do                                                                                              \
+    {                                                                                               \
+        if (tlog_pass(_module))                                                                     \
+        {                                                                                           \
+            uint32_t const _tlog_args[] = {0, ##__VA_ARGS__};                                       \
+            tlog_write(TLOG_TOKEN(_fmt), sizeof(_tlog_args) / sizeof(uint32_t) - 1, &_tlog_args[1]);\
+        }                                                                                           \
+    } while (0)
+
+#else
+
+#define TLOG(_module, ...)                                                                          \
+    do                                                                                              \
+    {                                                                                               \
+        if (tlog_pass(_module))                                                                     \
+        {                                                                                           \
+            NRF_LOG_INFO(__VA_ARGS__);                                                              \
+        }                                                                                           \
+    } while (0)
+
+#endif
+
+/**@brief Function for initializing the tokenized log.
+ *
+ * @details Records go to RTT up buffer TLOG_RTT_CHANNEL, dropped whole while it is full. Each
+ *          record is little endian: uint16_t token, uint8_t number of arguments, uint8_t sequence
+ *          number, uint32_t app_timer RTC tick, then the arguments as uint32_t. A gap in the
+ *          sequence numbers counts dropped records.
+ *
+ * @retval NRF_SUCCESS If initialization was successful.
+ */
+uint32_t tlog_init(void);
+
+/**@brief Function for writing a record, from any context. Use @ref TLOG instead.
+ *
+ * @param[in] token     Token of the format string.
+ * @param[in] nargs     Number of arguments.
+ * @param[in] p_args    Arguments.
+ */
+void tlog_write(uint16_t token, uint8_t nargs, uint32_t const * p_args);
+
+/**@brief Function for checking the filter of a module, called once per log call.
+ *
+ * @param[in] module    Module of the log site.
+ *
+ * @return true if the call is to be logged.
+ */
+bool tlog_pass(tlog_module_t module);
+
+/**@brief Function for setting the filter of a module.
+ *
+ * @param[in] module    Module, TLOG_MODULE_COUNT sets all of them.
+ * @param[in] every     1 logs every call, N every Nth call, 0 none.
+ */
+void tlog_filter_set(tlog_module_t module, uint8_t every);
+
+/**@brief Function for getting the filter of a module, see @ref tlog_filter_set.
+ */
+uint8_t tlog_filter_get(tlog_module_t module);
+
+/**@brief Function for reading the filter commands sent to RTT down buffer TLOG_RTT_CHANNEL.
+ *
+ * @details A command is a line of "<module> <every>", module being one of TLOG_MODULE_NAMES or
+ *          "all", see @ref tlog_filter_set. Called from the main loop.
+ */
+void tlog_process(void);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __WALL_CLOCK_H__
+#define __WALL_CLOCK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WALL_CLOCK_DRIFT_SPAN_MIN_MS    3600000UL   ///< Shortest time between two syncs used to measure the drift, the write latency is small next to it.
+#define WALL_CLOCK_DRIFT_MAX_PPM        500         ///< Larger drifts are taken as the central's clock being set, not as drift.
+
+/**@brief Function for initializing the clock.
+ *
+ * @details Time is counted in app_timer RTC ticks, extended to 64 bit. A repeated app_timer keeps
+ *          the RTC running and catches every wrap of its 24 bit counter. app_timer must be
+ *          initialized first.
+ *
+ * @retval NRF_SUCCESS If initialization was successful.
+ */
+uint32_t wall_clock_init(void);
+
+/**@brief Function for getting the RTC ticks since init, from any context.
+ */
+uint64_t wall_clock_ticks(void);
+
+/**@brief Function for getting the time since init, ms, from any context. It starts over on every reset.
+ */
+uint64_t wall_clock_uptime_ms(void);
+
+/**@brief Function for setting the time, written by a central.
+ *
+ * @details From the second sync on, the difference between the time the central saw pass and the
+ *          RTC ticks counted gives the drift of the RTC, averaged over the syncs. It corrects the
+ *          time until the next sync.
+ *
+ * @param[in] unix_ms    Time, ms since 1970-01-01 UTC.
+ */
+void wall_clock_sync(uint64_t unix_ms);
+
+/**@brief Function for checking if the time was set since boot.
+ */
+bool wall_clock_synced(void);
+
+/**@brief Function for getting the time.
+ *
+ * @return ms since 1970-01-01 UTC, 0 before the first sync.
+ */
+uint64_t wall_clock_now_ms(void);
+
+/**@brief Function for getting the RTC drift corrected for, ppm. Positive when the RTC runs slow.
+ */
+int16_t wall_clock_drift_ppm(void);
+
+#endif
@@ -20,8 +20,10 @@ static void on_connect(ble_dcs_t * p_tcs, ble_evt_t const * p_ble_evt)
  */
 static void on_disconnect(ble_dcs_t * p_tcs, ble_evt_t const * p_ble_evt)
 {
-    UNUSED_PARAMETER(p_ble_evt);
-    p_tcs->conn_handle = BLE_CONN_HANDLE_INVALID;
+    if (p_tcs->conn_handle == p_ble_evt->evt.gap_evt.conn_handle)
+    {
+        p_tcs->conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
 }
 
 
@@ -106,6 +108,16 @@ static void on_authorize_req(ble_dcs_t * p_dcs, ble_evt_t const * p_ble_evt)
                 }
             }
         }
+        else if (p_evt_rw_authorize_request->request.write.handle == p_dcs->log_filter_handles.value_handle)
+        {
+            evt_type = BLE_DCS_EVT_LOG_FILTER;
+
+            // One byte per module, all of them at once
+            if (p_evt_rw_authorize_request->request.write.len != p_dcs->log_filter_len)
+            {
+                valid_data = false;
+            }
+        }
         else
         {
             valid_data = false;
@@ -139,6 +151,9 @@ static void on_authorize_req(ble_dcs_t * p_dcs, ble_evt_t const * p_ble_evt)
         // Call event handler
         if ( valid_data && (p_dcs->evt_handler != NULL))
         {
+            // The write applies to the central that sent it
+            p_dcs->conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+
             p_dcs->evt_handler(p_dcs,
                                evt_type,
                                p_evt_rw_authorize_request->request.write.data,
@@ -389,6 +404,59 @@ static uint32_t fw_version_char_add(ble_dcs_t * p_dcs, const ble_dcs_init_t * p_
 }
 
 
+/**@brief Function for adding log filter characteristic.
+ *
+ * @param[in] p_dcs       Detect Configuration Service structure.
+ * @param[in] p_dcs_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t log_filter_char_add(ble_dcs_t * p_dcs, const ble_dcs_init_t * p_dcs_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 0;
+    char_md.char_props.read          = 1;
+    char_md.p_char_user_desc         = NULL;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
+
+    ble_uuid.type = p_dcs->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DCS_LOG_FILTER_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+
+    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 1;
+    attr_md.vlen    = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = p_dcs_init->log_filter_len;
+    attr_char_value.init_offs = 0;
+    attr_char_value.p_value   = (uint8_t *)p_dcs_init->p_init_log_filter;
+    attr_char_value.max_len   = BLE_DCS_LOG_FILTER_LEN_MAX;
+
+    return sd_ble_gatts_characteristic_add(p_dcs->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dcs->log_filter_handles);
+}
+
 
 uint32_t ble_dcs_init(ble_dcs_t * p_dcs, const ble_dcs_init_t * p_dcs_init)
 {
@@ -400,12 +468,19 @@ uint32_t ble_dcs_init(ble_dcs_t * p_dcs, const ble_dcs_init_t * p_dcs_init)
 
     VERIFY_PARAM_NOT_NULL(p_dcs);
     VERIFY_PARAM_NOT_NULL(p_dcs_init);
+    VERIFY_PARAM_NOT_NULL(p_dcs_init->p_init_log_filter);
+
+    if (p_dcs_init->log_filter_len > BLE_DCS_LOG_FILTER_LEN_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
 
     NRF_LOG_INFO("Passed null check");
 
     // Initialize the service structure.
     p_dcs->conn_handle                  = BLE_CONN_HANDLE_INVALID;
     p_dcs->evt_handler                  = p_dcs_init->evt_handler;
+    p_dcs->log_filter_len               = p_dcs_init->log_filter_len;
 
     // Add a custom base UUID.
     err_code = sd_ble_uuid_vs_add(&dcs_base_uuid, &p_dcs->uuid_type);
@@ -441,5 +516,9 @@ uint32_t ble_dcs_init(ble_dcs_t * p_dcs, const ble_dcs_init_t * p_dcs_init)
     err_code = fw_version_char_add(p_dcs, p_dcs_init);
     VERIFY_SUCCESS(err_code);
 
+    // Add the log filter Characteristic.
+    err_code = log_filter_char_add(p_dcs, p_dcs_init);
+    VERIFY_SUCCESS(err_code);
+
     return NRF_SUCCESS;
 }
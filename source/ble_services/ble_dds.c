@@ -3,6 +3,83 @@
 #include "sdk_common.h"
 #include "nrf_log.h"
 
+/**@brief Function for finding the state of a connection.
+ *
+ * @param[in] p_dds          Detect Detection Service structure.
+ * @param[in] conn_handle    Connection, or BLE_CONN_HANDLE_INVALID for a free slot.
+ *
+ * @return The link, NULL if there is none.
+ */
+static ble_dds_link_t * link_find(ble_dds_t * p_dds, uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < BLE_DDS_LINK_COUNT; i++)
+    {
+        if (p_dds->links[i].conn_handle == conn_handle)
+        {
+            return &p_dds->links[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool link_subscribed(ble_dds_link_t const * p_link, uint8_t notif)
+{
+    return (p_link->conn_handle != BLE_CONN_HANDLE_INVALID) && ((p_link->notif & notif) != 0);
+}
+
+/**@brief Function for working out which notifications any central enabled, raising an event for
+ *        each that changed.
+ *
+ * @param[in] p_dds      Detect Detection Service structure.
+ * @param[in] joined     Notifications a central just enabled. A central joining the stream others
+ *                       already receive raises the event too, the stream restarts for it.
+ * @param[in] p_data     CCCD value passed with the events.
+ * @param[in] length     Length of the CCCD value.
+ */
+static void notif_update(ble_dds_t * p_dds, uint8_t joined, uint8_t const * p_data, uint16_t length)
+{
+    struct
+    {
+        uint8_t            notif;
+        bool             * p_enabled;
+        ble_dds_evt_type_t evt_type;
+    } const notifs[] =
+    {
+        {BLE_DDS_NOTIF_PRESENCE,        &p_dds->is_presence_notif_enabled,        BLE_DDS_EVT_NOTIF_PRESENCE},
+        {BLE_DDS_NOTIF_RANGE,           &p_dds->is_range_notif_enabled,           BLE_DDS_EVT_NOTIF_RANGE},
+        {BLE_DDS_NOTIF_PRESENCE_STREAM, &p_dds->is_presence_stream_notif_enabled, BLE_DDS_EVT_NOTIF_PRESENCE_STREAM},
+        {BLE_DDS_NOTIF_COUNT,           &p_dds->is_count_notif_enabled,           BLE_DDS_EVT_NOTIF_COUNT},
+        {BLE_DDS_NOTIF_AGGREGATE,       &p_dds->is_aggregate_notif_enabled,       BLE_DDS_EVT_NOTIF_AGGREGATE},
+    };
+    uint8_t notif = 0;
+    uint8_t i;
+
+    for (i = 0; i < BLE_DDS_LINK_COUNT; i++)
+    {
+        if (p_dds->links[i].conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            notif |= p_dds->links[i].notif;
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(notifs); i++)
+    {
+        bool enabled = ((notif & notifs[i].notif) != 0);
+        bool changed = (*notifs[i].p_enabled != enabled);
+
+        *notifs[i].p_enabled = enabled;
+
+        if ((changed || (joined & notifs[i].notif & BLE_DDS_NOTIF_PRESENCE_STREAM)) &&
+            (p_dds->evt_handler != NULL))
+        {
+            p_dds->evt_handler(p_dds, notifs[i].evt_type, p_data, length);
+        }
+    }
+}
+
 /**@brief Function for handling the @ref BLE_GAP_EVT_CONNECTED event from the S132 SoftDevice.
  *
  * @param[in] p_tes     Thingy Environment Service structure.
@@ -10,19 +87,54 @@
  */
 static void on_connect(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
 {
-    p_dds->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    ble_dds_link_t * p_link = link_find(p_dds, BLE_CONN_HANDLE_INVALID);
+
+    if (p_link == NULL)
+    {
+        return;
+    }
+
+    p_link->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    p_link->notif       = 0;
+    p_link->tx_pending  = 0;
 }
 
 
 /**@brief Function for handling the @ref BLE_GAP_EVT_DISCONNECTED event from the S132 SoftDevice.
+ *
+ * @details Notifications only the disconnected central had enabled are reported as disabled.
  *
  * @param[in] p_tes     Thingy Environment Service structure.
  * @param[in] p_ble_evt Pointer to the event received from BLE stack.
  */
 static void on_disconnect(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
 {
-    UNUSED_PARAMETER(p_ble_evt);
-    p_dds->conn_handle = BLE_CONN_HANDLE_INVALID;
+    uint8_t const    cccd_off[2] = {0, 0};
+    ble_dds_link_t * p_link      = link_find(p_dds, p_ble_evt->evt.gap_evt.conn_handle);
+
+    if (p_link == NULL)
+    {
+        return;
+    }
+
+    p_link->conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    notif_update(p_dds, 0, cccd_off, sizeof(cccd_off));
+}
+
+/**@brief Function for handling the @ref BLE_GATTS_EVT_HVN_TX_COMPLETE event from the S132 SoftDevice.
+ *
+ * @details The count also covers notifications of other services on the link.
+ */
+static void on_tx_complete(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
+{
+    ble_dds_link_t * p_link = link_find(p_dds, p_ble_evt->evt.gatts_evt.conn_handle);
+    uint8_t          count  = p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count;
+
+    if (p_link != NULL)
+    {
+        p_link->tx_pending -= MIN(p_link->tx_pending, count);
+    }
 }
 
 /**@brief Function for handling the @ref BLE_GATTS_EVT_WRITE event from the S132 SoftDevice.
@@ -33,49 +145,52 @@ static void on_disconnect(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
 static void on_write(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
 {
     ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+    ble_dds_link_t              * p_link      = link_find(p_dds, p_ble_evt->evt.gatts_evt.conn_handle);
+    uint8_t                       notif       = 0;
+    uint8_t                       joined      = 0;
 
-    if ( (p_evt_write->handle == p_dds->presence_handles.cccd_handle) &&
-         (p_evt_write->len == 2) )
+    if ((p_link == NULL) || (p_evt_write->len != 2))
     {
-        bool notif_enabled;
-
-        notif_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
-
-        if (p_dds->is_presence_notif_enabled != notif_enabled)
-        {
-
-            //NRF_LOG_INFO("******** NOTIF PRESENCE **********\r\n");
-            p_dds->is_presence_notif_enabled = notif_enabled;
+        return;
+    }
 
-            if (p_dds->evt_handler != NULL)
-            {
-                p_dds->evt_handler(p_dds, BLE_DDS_EVT_NOTIF_PRESENCE, p_evt_write->data, p_evt_write->len);
-            }
-        }
+    if (p_evt_write->handle == p_dds->presence_handles.cccd_handle)
+    {
+        notif = BLE_DDS_NOTIF_PRESENCE;
     }
-    else if ( (p_evt_write->handle == p_dds->range_handles.cccd_handle) &&
-         (p_evt_write->len == 2) )
+    else if (p_evt_write->handle == p_dds->range_handles.cccd_handle)
     {
-        bool notif_enabled;
-
-        notif_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
-
-        if (p_dds->is_range_notif_enabled != notif_enabled)
-        {
-            //NRF_LOG_INFO("******** NOTIF RANGE **********\r\n");
-
-            p_dds->is_range_notif_enabled = notif_enabled;
-
-            if (p_dds->evt_handler != NULL)
-            {
-                p_dds->evt_handler(p_dds, BLE_DDS_EVT_NOTIF_RANGE, p_evt_write->data, p_evt_write->len);
-            }
-        }
+        notif = BLE_DDS_NOTIF_RANGE;
+    }
+    else if (p_evt_write->handle == p_dds->presence_stream_handles.cccd_handle)
+    {
+        notif = BLE_DDS_NOTIF_PRESENCE_STREAM;
+    }
+    else if (p_evt_write->handle == p_dds->count_handles.cccd_handle)
+    {
+        notif = BLE_DDS_NOTIF_COUNT;
+    }
+    else if (p_evt_write->handle == p_dds->aggregate_handles.cccd_handle)
+    {
+        notif = BLE_DDS_NOTIF_AGGREGATE;
     }
     else
     {
         // Do Nothing. This event is not relevant for this service.
+        return;
+    }
+
+    if (ble_srv_is_notification_enabled(p_evt_write->data))
+    {
+        joined          = notif & ~p_link->notif;
+        p_link->notif  |= notif;
+    }
+    else
+    {
+        p_link->notif  &= ~notif;
     }
+
+    notif_update(p_dds, joined, p_evt_write->data, p_evt_write->len);
 }
 
 static void on_authorize_req(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
@@ -107,8 +222,11 @@ static void on_authorize_req(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
                     (p_config->threshold_config.eth13l > BLE_DDS_CONFIG_THRESHOLD_MAX)            ||
                     (p_config->threshold_config.eth24h < BLE_DDS_CONFIG_THRESHOLD_MIN)            ||
                     ((int)p_config->threshold_config.eth24l > (int)BLE_DDS_CONFIG_THRESHOLD_MAX)  ||
-                    (p_config->sample_mode < 0)                                                   ||
-                    (p_config->sample_mode > 1))
+                    (p_config->sample_mode < SAMPLE_MODE_CONTINUOUS)                              ||
+                    (p_config->sample_mode > SAMPLE_MODE_AGGREGATE)                               ||
+                    (p_config->calibration.window_s < BLE_DDS_CONFIG_CALIB_WINDOW_MIN)            ||
+                    (p_config->calibration.false_wakes_per_day < BLE_DDS_CONFIG_CALIB_WAKES_MIN)  ||
+                    (p_config->session.timeout < BLE_DDS_CONFIG_SESSION_TIMEOUT_MIN))
                 {
                     valid_data = false;
                 }
@@ -142,6 +260,164 @@ static void on_authorize_req(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
                                    p_evt_rw_authorize_request->request.write.len);
             }
         }
+        else if (p_evt_rw_authorize_request->request.write.handle == p_dds->aggregate_window_handles.value_handle)
+        {
+            ble_gatts_rw_authorize_reply_params_t rw_authorize_reply;
+            bool                                  valid_data = false;
+
+            if (p_evt_rw_authorize_request->request.write.len == sizeof(uint16_t))
+            {
+                uint16_t window_s = uint16_decode(p_evt_rw_authorize_request->request.write.data);
+
+                valid_data = (window_s >= BLE_DDS_AGGREGATE_WINDOW_MIN) &&
+                             (window_s <= BLE_DDS_AGGREGATE_WINDOW_MAX);
+            }
+
+            memset(&rw_authorize_reply, 0, sizeof(rw_authorize_reply));
+
+            rw_authorize_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+
+            if (valid_data)
+            {
+                rw_authorize_reply.params.write.update      = 1;
+                rw_authorize_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+                rw_authorize_reply.params.write.p_data      = p_evt_rw_authorize_request->request.write.data;
+                rw_authorize_reply.params.write.len         = p_evt_rw_authorize_request->request.write.len;
+                rw_authorize_reply.params.write.offset      = p_evt_rw_authorize_request->request.write.offset;
+            }
+            else
+            {
+                rw_authorize_reply.params.write.update      = 0;
+                rw_authorize_reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED;
+            }
+
+            err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle,
+                                                       &rw_authorize_reply);
+            APP_ERROR_CHECK(err_code);
+
+            if (valid_data && (p_dds->evt_handler != NULL))
+            {
+                p_dds->evt_handler(p_dds,
+                                   BLE_DDS_EVT_AGGREGATE_WINDOW_RECEIVED,
+                                   p_evt_rw_authorize_request->request.write.data,
+                                   p_evt_rw_authorize_request->request.write.len);
+            }
+        }
+        else if (p_evt_rw_authorize_request->request.write.handle == p_dds->range_bg_handles.value_handle)
+        {
+            ble_gatts_rw_authorize_reply_params_t rw_authorize_reply;
+            bool                                  valid_data = false;
+
+            if (p_evt_rw_authorize_request->request.write.len == sizeof(ble_dds_range_bg_t))
+            {
+                ble_dds_range_bg_t const * p_range_bg = (ble_dds_range_bg_t const *)p_evt_rw_authorize_request->request.write.data;
+
+                valid_data = ((p_range_bg->flags & ~(BLE_DDS_RANGE_BG_FOREGROUND_ONLY |
+                                                     BLE_DDS_RANGE_BG_GATE_MOTION     |
+                                                     BLE_DDS_RANGE_BG_RELEARN)) == 0) &&
+                             (p_range_bg->margin_mm >= BLE_DDS_RANGE_BG_MARGIN_MIN)    &&
+                             (p_range_bg->margin_mm <= BLE_DDS_RANGE_BG_MARGIN_MAX);
+            }
+
+            memset(&rw_authorize_reply, 0, sizeof(rw_authorize_reply));
+
+            rw_authorize_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+
+            // The model is exposed by the application once it has applied the write
+            rw_authorize_reply.params.write.update      = 0;
+            rw_authorize_reply.params.write.gatt_status = valid_data ? BLE_GATT_STATUS_SUCCESS :
+                                                                       BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED;
+
+            err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle,
+                                                       &rw_authorize_reply);
+            APP_ERROR_CHECK(err_code);
+
+            if (valid_data && (p_dds->evt_handler != NULL))
+            {
+                p_dds->evt_handler(p_dds,
+                                   BLE_DDS_EVT_RANGE_BG_RECEIVED,
+                                   p_evt_rw_authorize_request->request.write.data,
+                                   p_evt_rw_authorize_request->request.write.len);
+            }
+        }
+        else if (p_evt_rw_authorize_request->request.write.handle == p_dds->broadcast_handles.value_handle)
+        {
+            ble_gatts_rw_authorize_reply_params_t rw_authorize_reply;
+            bool                                  valid_data = false;
+
+            if (p_evt_rw_authorize_request->request.write.len == sizeof(ble_dds_broadcast_t))
+            {
+                ble_dds_broadcast_t const * p_broadcast = (ble_dds_broadcast_t const *)p_evt_rw_authorize_request->request.write.data;
+
+                valid_data = (p_broadcast->mode <= BLE_DDS_BROADCAST_EXTENDED)                &&
+                             (p_broadcast->interval_ms >= BLE_DDS_BROADCAST_INTERVAL_MIN)     &&
+                             (p_broadcast->interval_ms <= BLE_DDS_BROADCAST_INTERVAL_MAX);
+            }
+
+            memset(&rw_authorize_reply, 0, sizeof(rw_authorize_reply));
+
+            rw_authorize_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+
+            if (valid_data)
+            {
+                rw_authorize_reply.params.write.update      = 1;
+                rw_authorize_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+                rw_authorize_reply.params.write.p_data      = p_evt_rw_authorize_request->request.write.data;
+                rw_authorize_reply.params.write.len         = p_evt_rw_authorize_request->request.write.len;
+                rw_authorize_reply.params.write.offset      = p_evt_rw_authorize_request->request.write.offset;
+            }
+            else
+            {
+                rw_authorize_reply.params.write.update      = 0;
+                rw_authorize_reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED;
+            }
+
+            err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle,
+                                                       &rw_authorize_reply);
+            APP_ERROR_CHECK(err_code);
+
+            if (valid_data && (p_dds->evt_handler != NULL))
+            {
+                p_dds->evt_handler(p_dds,
+                                   BLE_DDS_EVT_BROADCAST_RECEIVED,
+                                   p_evt_rw_authorize_request->request.write.data,
+                                   p_evt_rw_authorize_request->request.write.len);
+            }
+        }
+        else if (p_evt_rw_authorize_request->request.write.handle == p_dds->time_handles.value_handle)
+        {
+            ble_gatts_rw_authorize_reply_params_t rw_authorize_reply;
+            bool                                  valid_data = false;
+            uint64_t                              time_ms;
+
+            if (p_evt_rw_authorize_request->request.write.len == sizeof(uint64_t))
+            {
+                memcpy(&time_ms, p_evt_rw_authorize_request->request.write.data, sizeof(uint64_t));
+
+                valid_data = (time_ms >= BLE_DDS_TIME_MIN_MS);
+            }
+
+            memset(&rw_authorize_reply, 0, sizeof(rw_authorize_reply));
+
+            rw_authorize_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+
+            // The epochs are exposed by the application once it has set the clock
+            rw_authorize_reply.params.write.update      = 0;
+            rw_authorize_reply.params.write.gatt_status = valid_data ? BLE_GATT_STATUS_SUCCESS :
+                                                                       BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED;
+
+            err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle,
+                                                       &rw_authorize_reply);
+            APP_ERROR_CHECK(err_code);
+
+            if (valid_data && (p_dds->evt_handler != NULL))
+            {
+                p_dds->evt_handler(p_dds,
+                                   BLE_DDS_EVT_TIME_RECEIVED,
+                                   p_evt_rw_authorize_request->request.write.data,
+                                   p_evt_rw_authorize_request->request.write.len);
+            }
+        }
     }
 }
 
@@ -166,85 +442,482 @@ void ble_dds_on_ble_evt(ble_dds_t * p_dds, ble_evt_t const * p_ble_evt)
             on_write(p_dds, p_ble_evt);
             break;
 
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            on_tx_complete(p_dds, p_ble_evt);
+            break;
+
         case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
             on_authorize_req(p_dds, p_ble_evt);
             break;
 
-        default:
-            // No implementation needed.
-            break;
-    }
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+/**@brief Function for notifying a value to every central that enabled it.
+ *
+ * @details The value goes to all of them or, while one of them has no free TX buffer, to none, so
+ *          that a retry does not repeat it on the links that already took it. A link whose queue
+ *          was filled by another service meanwhile misses the value.
+ *
+ * @param[in] p_dds           Detect Detection Service structure.
+ * @param[in] notif           BLE_DDS_NOTIF_ bit of the characteristic.
+ * @param[in] value_handle    Value handle of the characteristic.
+ * @param[in] p_data          Value.
+ * @param[in] length          Value length.
+ *
+ * @return NRF_SUCCESS if a central took the value, NRF_ERROR_INVALID_STATE if none enabled it,
+ *         NRF_ERROR_RESOURCES if one is out of TX buffers, otherwise an error code.
+ */
+static uint32_t notify(ble_dds_t     * p_dds,
+                       uint8_t         notif,
+                       uint16_t        value_handle,
+                       uint8_t const * p_data,
+                       uint16_t        length)
+{
+    ble_gatts_hvx_params_t hvx_params;
+    uint32_t               err_code = NRF_ERROR_INVALID_STATE;
+    bool                   sent     = false;
+    uint8_t                i;
+
+    if (length > BLE_DDS_MAX_DATA_LEN)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    for (i = 0; i < BLE_DDS_LINK_COUNT; i++)
+    {
+        if (link_subscribed(&p_dds->links[i], notif) &&
+            (p_dds->links[i].tx_pending >= BLE_DDS_LINK_TX_QUEUE_SIZE))
+        {
+            return NRF_ERROR_RESOURCES;
+        }
+    }
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    hvx_params.handle = value_handle;
+    hvx_params.p_data = p_data;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+
+    for (i = 0; i < BLE_DDS_LINK_COUNT; i++)
+    {
+        ble_dds_link_t * p_link = &p_dds->links[i];
+        uint16_t         len    = length;
+
+        if (!link_subscribed(p_link, notif))
+        {
+            continue;
+        }
+
+        hvx_params.p_len = &len;
+
+        err_code = sd_ble_gatts_hvx(p_link->conn_handle, &hvx_params);
+        if (err_code == NRF_SUCCESS)
+        {
+            p_link->tx_pending++;
+            sent = true;
+        }
+        else if (err_code == NRF_ERROR_RESOURCES)
+        {
+            // Full after all, wait for its next TX complete
+            p_link->tx_pending = BLE_DDS_LINK_TX_QUEUE_SIZE;
+        }
+    }
+
+    return sent ? NRF_SUCCESS : err_code;
+}
+
+bool ble_dds_connected(ble_dds_t const * p_dds)
+{
+    uint8_t i;
+
+    for (i = 0; i < BLE_DDS_LINK_COUNT; i++)
+    {
+        if (p_dds->links[i].conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t ble_dds_presence_set(ble_dds_t * p_tes, ble_dds_presence_t * p_data)
+{
+    VERIFY_PARAM_NOT_NULL(p_tes);
+
+    return notify(p_tes,
+                  BLE_DDS_NOTIF_PRESENCE,
+                  p_tes->presence_handles.value_handle,
+                  (uint8_t *)p_data,
+                  sizeof(ble_dds_presence_t));
+}
+
+uint32_t ble_dds_range_set(ble_dds_t * p_tes, ble_dds_range_t * p_data)
+{
+    VERIFY_PARAM_NOT_NULL(p_tes);
+
+    return notify(p_tes,
+                  BLE_DDS_NOTIF_RANGE,
+                  p_tes->range_handles.value_handle,
+                  (uint8_t *)p_data,
+                  sizeof(ble_dds_range_t));
+}
+
+uint32_t ble_dds_presence_stream_set(ble_dds_t * p_dds, uint8_t const * p_data, uint16_t length)
+{
+    VERIFY_PARAM_NOT_NULL(p_dds);
+    VERIFY_PARAM_NOT_NULL(p_data);
+
+    return notify(p_dds,
+                  BLE_DDS_NOTIF_PRESENCE_STREAM,
+                  p_dds->presence_stream_handles.value_handle,
+                  p_data,
+                  length);
+}
+
+uint32_t ble_dds_count_set(ble_dds_t * p_dds, ble_dds_count_t * p_count)
+{
+    ble_gatts_value_t gatts_value;
+
+    VERIFY_PARAM_NOT_NULL(p_dds);
+    VERIFY_PARAM_NOT_NULL(p_count);
+
+    if (!p_dds->is_count_notif_enabled)
+    {
+        // Still readable
+        memset(&gatts_value, 0, sizeof(gatts_value));
+
+        gatts_value.len     = sizeof(ble_dds_count_t);
+        gatts_value.offset  = 0;
+        gatts_value.p_value = (uint8_t *)p_count;
+
+        return sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID,
+                                      p_dds->count_handles.value_handle,
+                                      &gatts_value);
+    }
+
+    return notify(p_dds,
+                  BLE_DDS_NOTIF_COUNT,
+                  p_dds->count_handles.value_handle,
+                  (uint8_t *)p_count,
+                  sizeof(ble_dds_count_t));
+}
+
+uint32_t ble_dds_aggregate_set(ble_dds_t * p_dds, ble_dds_aggregate_t * p_aggregate)
+{
+    VERIFY_PARAM_NOT_NULL(p_dds);
+    VERIFY_PARAM_NOT_NULL(p_aggregate);
+
+    return notify(p_dds,
+                  BLE_DDS_NOTIF_AGGREGATE,
+                  p_dds->aggregate_handles.value_handle,
+                  (uint8_t *)p_aggregate,
+                  sizeof(ble_dds_aggregate_t));
+}
+
+uint32_t ble_dds_range_bg_set(ble_dds_t * p_dds, ble_dds_range_bg_t * p_range_bg)
+{
+    ble_gatts_value_t gatts_value;
+
+    VERIFY_PARAM_NOT_NULL(p_dds);
+    VERIFY_PARAM_NOT_NULL(p_range_bg);
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = sizeof(ble_dds_range_bg_t);
+    gatts_value.offset  = 0;
+    gatts_value.p_value = (uint8_t *)p_range_bg;
+
+    return sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID,
+                                  p_dds->range_bg_handles.value_handle,
+                                  &gatts_value);
+}
+
+uint32_t ble_dds_time_set(ble_dds_t * p_dds, ble_dds_time_t * p_time)
+{
+    ble_gatts_value_t gatts_value;
+
+    VERIFY_PARAM_NOT_NULL(p_dds);
+    VERIFY_PARAM_NOT_NULL(p_time);
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = sizeof(ble_dds_time_t);
+    gatts_value.offset  = 0;
+    gatts_value.p_value = (uint8_t *)p_time;
+
+    return sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID,
+                                  p_dds->time_handles.value_handle,
+                                  &gatts_value);
+}
+
+uint32_t ble_dds_config_set(ble_dds_t * p_dds, ble_dds_config_t * p_config)
+{
+    ble_gatts_value_t gatts_value;
+
+    VERIFY_PARAM_NOT_NULL(p_dds);
+    VERIFY_PARAM_NOT_NULL(p_config);
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = sizeof(ble_dds_config_t);
+    gatts_value.offset  = 0;
+    gatts_value.p_value = (uint8_t *)p_config;
+
+    return sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID,
+                                  p_dds->config_handles.value_handle,
+                                  &gatts_value);
+}
+
+/**@brief Function for adding pressure characteristic.
+ *
+ * @param[in] p_tes       Thingy Environment Service structure.
+ * @param[in] p_tes_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t presence_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
+
+    cccd_md.vloc = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.notify = 1;
+    char_md.p_char_user_desc  = NULL;
+    char_md.p_char_pf         = NULL;
+    char_md.p_user_desc_md    = NULL;
+    char_md.p_cccd_md         = &cccd_md;
+    char_md.p_sccd_md         = NULL;
+
+    ble_uuid.type = p_dds->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DDS_PRESENCE_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+
+    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 0;
+    attr_md.vlen    = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(ble_dds_presence_t);
+    attr_char_value.init_offs = 0;
+    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_presence;
+    attr_char_value.max_len   = sizeof(ble_dds_presence_t);
+
+    return sd_ble_gatts_characteristic_add(p_dds->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dds->presence_handles);
+}
+
+/**@brief Function for adding pressure characteristic.
+ *
+ * @param[in] p_tes       Thingy Environment Service structure.
+ * @param[in] p_tes_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t range_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
+
+    cccd_md.vloc = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.notify = 1;
+    char_md.p_char_user_desc  = NULL;
+    char_md.p_char_pf         = NULL;
+    char_md.p_user_desc_md    = NULL;
+    char_md.p_cccd_md         = &cccd_md;
+    char_md.p_sccd_md         = NULL;
+
+    ble_uuid.type = p_dds->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DDS_RANGE_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+
+    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 0;
+    attr_md.vlen    = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(ble_dds_range_t);
+    attr_char_value.init_offs = 0;
+    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_range;
+    attr_char_value.max_len   = sizeof(ble_dds_range_t);
+
+    return sd_ble_gatts_characteristic_add(p_dds->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dds->range_handles);
+}
+
+/**@brief Function for adding configuration characteristic.
+ *
+ * @param[in] p_tes       Thingy Environment Service structure.
+ * @param[in] p_tes_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t config_char_add(ble_dds_t * p_tes, const ble_dds_init_t * p_dds_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 0;
+    char_md.p_char_user_desc         = NULL;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
+
+    ble_uuid.type = p_tes->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DDS_CONFIG_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+
+    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 1;
+    attr_md.vlen    = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(ble_dds_config_t);
+    attr_char_value.init_offs = 0;
+    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_config;
+    attr_char_value.max_len   = sizeof(ble_dds_config_t);
+
+    return sd_ble_gatts_characteristic_add(p_tes->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_tes->config_handles);
 }
 
-uint32_t ble_dds_presence_set(ble_dds_t * p_tes, ble_dds_presence_t * p_data)
+/**@brief Function for adding the compressed presence stream characteristic.
+ *
+ * @param[in] p_dds       Detect Detection Service structure.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t presence_stream_char_add(ble_dds_t * p_dds)
 {
-    ble_gatts_hvx_params_t hvx_params;
-    uint16_t               length = sizeof(ble_dds_presence_t);
-
-    VERIFY_PARAM_NOT_NULL(p_tes);
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
 
-    if ((p_tes->conn_handle == BLE_CONN_HANDLE_INVALID) || (!p_tes->is_presence_notif_enabled))
-    {
-        return NRF_ERROR_INVALID_STATE;
-    }
+    memset(&cccd_md, 0, sizeof(cccd_md));
 
-    if (length > BLE_DDS_MAX_DATA_LEN)
-    {
-        return NRF_ERROR_INVALID_PARAM;
-    }
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
 
-    memset(&hvx_params, 0, sizeof(hvx_params));
+    cccd_md.vloc = BLE_GATTS_VLOC_STACK;
 
-    hvx_params.handle = p_tes->presence_handles.value_handle;
-    hvx_params.p_data = (uint8_t *)p_data;
-    hvx_params.p_len  = &length;
-    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    memset(&char_md, 0, sizeof(char_md));
 
-    return sd_ble_gatts_hvx(p_tes->conn_handle, &hvx_params);
-}
+    char_md.char_props.notify = 1;
+    char_md.p_char_user_desc  = NULL;
+    char_md.p_char_pf         = NULL;
+    char_md.p_user_desc_md    = NULL;
+    char_md.p_cccd_md         = &cccd_md;
+    char_md.p_sccd_md         = NULL;
 
-uint32_t ble_dds_range_set(ble_dds_t * p_tes, ble_dds_range_t * p_data)
-{
-    ble_gatts_hvx_params_t hvx_params;
-    uint16_t               length = sizeof(ble_dds_range_t);
+    ble_uuid.type = p_dds->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DDS_PRESENCE_STREAM_CHAR;
 
-    VERIFY_PARAM_NOT_NULL(p_tes);
+    memset(&attr_md, 0, sizeof(attr_md));
 
-    if ((p_tes->conn_handle == BLE_CONN_HANDLE_INVALID) || (!p_tes->is_range_notif_enabled))
-    {
-        return NRF_ERROR_INVALID_STATE;
-    }
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
 
-    if (length > BLE_DDS_MAX_DATA_LEN)
-    {
-        return NRF_ERROR_INVALID_PARAM;
-    }
+    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 0;
+    attr_md.vlen    = 1;
 
-    memset(&hvx_params, 0, sizeof(hvx_params));
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
 
-    hvx_params.handle = p_tes->range_handles.value_handle;
-    hvx_params.p_data = (uint8_t *)p_data;
-    hvx_params.p_len  = &length;
-    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = 0;
+    attr_char_value.init_offs = 0;
+    attr_char_value.p_value   = NULL;
+    attr_char_value.max_len   = BLE_DDS_MAX_DATA_LEN;
 
-    return sd_ble_gatts_hvx(p_tes->conn_handle, &hvx_params);
+    return sd_ble_gatts_characteristic_add(p_dds->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dds->presence_stream_handles);
 }
 
-/**@brief Function for adding pressure characteristic.
+/**@brief Function for adding the people count characteristic.
  *
- * @param[in] p_tes       Thingy Environment Service structure.
- * @param[in] p_tes_init  Information needed to initialize the service.
+ * @param[in] p_dds       Detect Detection Service structure.
  *
  * @return NRF_SUCCESS on success, otherwise an error code.
  */
-static uint32_t presence_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
+static uint32_t count_char_add(ble_dds_t * p_dds)
 {
     ble_gatts_char_md_t char_md;
     ble_gatts_attr_md_t cccd_md;
     ble_gatts_attr_t    attr_char_value;
     ble_uuid_t          ble_uuid;
     ble_gatts_attr_md_t attr_md;
+    ble_dds_count_t     init_count;
 
+    memset(&init_count, 0, sizeof(init_count));
     memset(&cccd_md, 0, sizeof(cccd_md));
 
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
@@ -254,6 +927,7 @@ static uint32_t presence_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dd
 
     memset(&char_md, 0, sizeof(char_md));
 
+    char_md.char_props.read   = 1;
     char_md.char_props.notify = 1;
     char_md.p_char_user_desc  = NULL;
     char_md.p_char_pf         = NULL;
@@ -262,11 +936,11 @@ static uint32_t presence_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dd
     char_md.p_sccd_md         = NULL;
 
     ble_uuid.type = p_dds->uuid_type;
-    ble_uuid.uuid = BLE_UUID_DDS_PRESENCE_CHAR;
+    ble_uuid.uuid = BLE_UUID_DDS_COUNT_CHAR;
 
     memset(&attr_md, 0, sizeof(attr_md));
 
-    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
     BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
 
     attr_md.vloc    = BLE_GATTS_VLOC_STACK;
@@ -278,25 +952,80 @@ static uint32_t presence_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dd
 
     attr_char_value.p_uuid    = &ble_uuid;
     attr_char_value.p_attr_md = &attr_md;
-    attr_char_value.init_len  = sizeof(ble_dds_presence_t);
+    attr_char_value.init_len  = sizeof(ble_dds_count_t);
     attr_char_value.init_offs = 0;
-    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_presence;
-    attr_char_value.max_len   = sizeof(ble_dds_presence_t);
+    attr_char_value.p_value   = (uint8_t *)&init_count;
+    attr_char_value.max_len   = sizeof(ble_dds_count_t);
 
     return sd_ble_gatts_characteristic_add(p_dds->service_handle,
                                            &char_md,
                                            &attr_char_value,
-                                           &p_dds->presence_handles);
+                                           &p_dds->count_handles);
 }
 
-/**@brief Function for adding pressure characteristic.
+/**@brief Function for adding the aggregation window characteristic.
  *
- * @param[in] p_tes       Thingy Environment Service structure.
- * @param[in] p_tes_init  Information needed to initialize the service.
+ * @param[in] p_dds       Detect Detection Service structure.
+ * @param[in] p_dds_init  Information needed to initialize the service.
  *
  * @return NRF_SUCCESS on success, otherwise an error code.
  */
-static uint32_t range_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
+static uint32_t aggregate_window_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    uint8_t             init_window[sizeof(uint16_t)];
+
+    (void)uint16_encode(p_dds_init->init_aggregate_window_s, init_window);
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 0;
+    char_md.p_char_user_desc         = NULL;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
+
+    ble_uuid.type = p_dds->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DDS_AGGREGATE_WINDOW_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+
+    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 1;
+    attr_md.vlen    = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(init_window);
+    attr_char_value.init_offs = 0;
+    attr_char_value.p_value   = init_window;
+    attr_char_value.max_len   = sizeof(init_window);
+
+    return sd_ble_gatts_characteristic_add(p_dds->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dds->aggregate_window_handles);
+}
+
+/**@brief Function for adding the aggregate statistics characteristic.
+ *
+ * @param[in] p_dds       Detect Detection Service structure.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t aggregate_char_add(ble_dds_t * p_dds)
 {
     ble_gatts_char_md_t char_md;
     ble_gatts_attr_md_t cccd_md;
@@ -321,7 +1050,7 @@ static uint32_t range_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_i
     char_md.p_sccd_md         = NULL;
 
     ble_uuid.type = p_dds->uuid_type;
-    ble_uuid.uuid = BLE_UUID_DDS_RANGE_CHAR;
+    ble_uuid.uuid = BLE_UUID_DDS_AGGREGATE_CHAR;
 
     memset(&attr_md, 0, sizeof(attr_md));
 
@@ -337,25 +1066,25 @@ static uint32_t range_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_i
 
     attr_char_value.p_uuid    = &ble_uuid;
     attr_char_value.p_attr_md = &attr_md;
-    attr_char_value.init_len  = sizeof(ble_dds_range_t);
+    attr_char_value.init_len  = 0;
     attr_char_value.init_offs = 0;
-    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_range;
-    attr_char_value.max_len   = sizeof(ble_dds_range_t);
+    attr_char_value.p_value   = NULL;
+    attr_char_value.max_len   = sizeof(ble_dds_aggregate_t);
 
     return sd_ble_gatts_characteristic_add(p_dds->service_handle,
                                            &char_md,
                                            &attr_char_value,
-                                           &p_dds->range_handles);
+                                           &p_dds->aggregate_handles);
 }
 
-/**@brief Function for adding configuration characteristic.
+/**@brief Function for adding the range background characteristic.
  *
- * @param[in] p_tes       Thingy Environment Service structure.
- * @param[in] p_tes_init  Information needed to initialize the service.
+ * @param[in] p_dds       Detect Detection Service structure.
+ * @param[in] p_dds_init  Information needed to initialize the service.
  *
  * @return NRF_SUCCESS on success, otherwise an error code.
  */
-static uint32_t config_char_add(ble_dds_t * p_tes, const ble_dds_init_t * p_dds_init)
+static uint32_t range_bg_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
 {
     ble_gatts_char_md_t char_md;
     ble_gatts_attr_t    attr_char_value;
@@ -373,8 +1102,8 @@ static uint32_t config_char_add(ble_dds_t * p_tes, const ble_dds_init_t * p_dds_
     char_md.p_cccd_md                = NULL;
     char_md.p_sccd_md                = NULL;
 
-    ble_uuid.type = p_tes->uuid_type;
-    ble_uuid.uuid = BLE_UUID_DDS_CONFIG_CHAR;
+    ble_uuid.type = p_dds->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DDS_RANGE_BG_CHAR;
 
     memset(&attr_md, 0, sizeof(attr_md));
 
@@ -390,15 +1119,124 @@ static uint32_t config_char_add(ble_dds_t * p_tes, const ble_dds_init_t * p_dds_
 
     attr_char_value.p_uuid    = &ble_uuid;
     attr_char_value.p_attr_md = &attr_md;
-    attr_char_value.init_len  = sizeof(ble_dds_config_t);
+    attr_char_value.init_len  = sizeof(ble_dds_range_bg_t);
     attr_char_value.init_offs = 0;
-    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_config;
-    attr_char_value.max_len   = sizeof(ble_dds_config_t);
+    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_range_bg;
+    attr_char_value.max_len   = sizeof(ble_dds_range_bg_t);
 
-    return sd_ble_gatts_characteristic_add(p_tes->service_handle,
+    return sd_ble_gatts_characteristic_add(p_dds->service_handle,
                                            &char_md,
                                            &attr_char_value,
-                                           &p_tes->config_handles);
+                                           &p_dds->range_bg_handles);
+}
+
+/**@brief Function for adding the occupancy broadcast characteristic.
+ *
+ * @param[in] p_dds       Detect Detection Service structure.
+ * @param[in] p_dds_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t broadcast_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 0;
+    char_md.p_char_user_desc         = NULL;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
+
+    ble_uuid.type = p_dds->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DDS_BROADCAST_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+
+    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 1;
+    attr_md.vlen    = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(ble_dds_broadcast_t);
+    attr_char_value.init_offs = 0;
+    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_broadcast;
+    attr_char_value.max_len   = sizeof(ble_dds_broadcast_t);
+
+    return sd_ble_gatts_characteristic_add(p_dds->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dds->broadcast_handles);
+}
+
+/**@brief Function for adding the time sync characteristic.
+ *
+ * @details Written with the time, 8 bytes, and read with where the timestamps start, so the
+ *          value has a variable length.
+ *
+ * @param[in] p_dds       Detect Detection Service structure.
+ * @param[in] p_dds_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t time_char_add(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 0;
+    char_md.p_char_user_desc         = NULL;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
+
+    ble_uuid.type = p_dds->uuid_type;
+    ble_uuid.uuid = BLE_UUID_DDS_TIME_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+
+    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 1;
+    attr_md.vlen    = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(ble_dds_time_t);
+    attr_char_value.init_offs = 0;
+    attr_char_value.p_value   = (uint8_t *)p_dds_init->p_init_time;
+    attr_char_value.max_len   = sizeof(ble_dds_time_t);
+
+    return sd_ble_gatts_characteristic_add(p_dds->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dds->time_handles);
 }
 
 uint32_t ble_dds_init(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
@@ -406,15 +1244,23 @@ uint32_t ble_dds_init(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
     uint32_t      err_code;
     ble_uuid_t    ble_uuid;
     ble_uuid128_t dds_base_uuid = DDS_BASE_UUID;
+    uint8_t       i;
 
     VERIFY_PARAM_NOT_NULL(p_dds);
     VERIFY_PARAM_NOT_NULL(p_dds_init);
 
     // Initialize the service structure.
-    p_dds->conn_handle                  = BLE_CONN_HANDLE_INVALID;
+    for (i = 0; i < BLE_DDS_LINK_COUNT; i++)
+    {
+        p_dds->links[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+
     p_dds->evt_handler                  = p_dds_init->evt_handler;
     p_dds->is_presence_notif_enabled = false;
     p_dds->is_range_notif_enabled    = false;
+    p_dds->is_presence_stream_notif_enabled = false;
+    p_dds->is_count_notif_enabled    = false;
+    p_dds->is_aggregate_notif_enabled = false;
 
     // Add a custom base UUID.
     err_code = sd_ble_uuid_vs_add(&dds_base_uuid, &p_dds->uuid_type);
@@ -441,5 +1287,33 @@ uint32_t ble_dds_init(ble_dds_t * p_dds, const ble_dds_init_t * p_dds_init)
     err_code = config_char_add(p_dds, p_dds_init);
     VERIFY_SUCCESS(err_code);
 
+    // Add the presence stream Characteristic.
+    err_code = presence_stream_char_add(p_dds);
+    VERIFY_SUCCESS(err_code);
+
+    // Add the people count Characteristic.
+    err_code = count_char_add(p_dds);
+    VERIFY_SUCCESS(err_code);
+
+    // Add the aggregation window Characteristic.
+    err_code = aggregate_window_char_add(p_dds, p_dds_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Add the aggregate statistics Characteristic.
+    err_code = aggregate_char_add(p_dds);
+    VERIFY_SUCCESS(err_code);
+
+    // Add the range background Characteristic.
+    err_code = range_bg_char_add(p_dds, p_dds_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Add the occupancy broadcast Characteristic.
+    err_code = broadcast_char_add(p_dds, p_dds_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Add the time sync Characteristic.
+    err_code = time_char_add(p_dds, p_dds_init);
+    VERIFY_SUCCESS(err_code);
+
     return NRF_SUCCESS;
 }
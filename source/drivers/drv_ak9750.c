@@ -1,8 +1,16 @@
 #include "drv_ak9750.h"
 #include "twi_manager.h"
 #include "nrf_log.h"
+#include "tlog.h"
 #include "nrf_delay.h"
 #include "ble_dds.h"
+#include "nrf_assert.h"
+#include "nrf_rtc.h"
+#include "nrf_timer.h"
+#include "nrf_soc.h"
+#include "prio_sched.h"
+#include "app_timer.h"
+#include <string.h>
 
 #define ECNTL1                         0x1C            // Mode setting/ Digital Filter Cutoff Frequency (Fc) setting (Read / Write registers)
 #define CNTL2                          0x1D            // Soft Reset (Read / Write Registers)
@@ -18,6 +26,8 @@
 #define IR3H                           0x0B            // IR3 A/D Converted data (High)
 #define IR4L                           0x0C            // IR4 A/D Converted data (Low)
 #define IR4H                           0x0D            // IR4 A/D Converted data (High)
+#define TMPL                           0x0E            // Internal temperature A/D Converted data (Low)
+#define TMPH                           0x0F            // Internal temperature A/D Converted data (High)
 
 #define INTST_DRI_MASK                 0x01
 #define NORMAL_FC_8_8_SINGLE_SHOT_MODE 0xAA
@@ -42,6 +52,34 @@
 
 #define ETH13H_MASK                     0x10
 
+#define SHADOW_FIRST_REG                ETH13H_L        // First register held in the shadow cache.
+#define SHADOW_LAST_REG                 ECNTL1          // Last register held in the shadow cache.
+#define SHADOW_REG_COUNT                (SHADOW_LAST_REG - SHADOW_FIRST_REG + 1)
+#define THRESHOLD_REG_COUNT             (ETH24L_H - ETH13H_L + 1)
+
+#define STATUS_BLOCK_LEN                (ST2 - INTST + 1)
+#define DATA_BLOCK_LEN                  (ST2 - IR1L + 1)   // IR1..IR4, TMP and ST2 in one read
+
+#define TMP_DATA_SHIFT                  6               // TMP is 10 bit, left aligned in TMPH:TMPL
+
+#define AUTO_RTC                        NRF_RTC2        // Paces autonomous reads, RTC0 and RTC1 are taken.
+#define AUTO_TIMER                      NRF_TIMER2      // Counts autonomous reads.
+#define AUTO_TIMER_IRQn                 TIMER2_IRQn
+#define AUTO_TIMER_IRQHandler           TIMER2_IRQHandler
+#define AUTO_PPI_CH_START               2               // RTC compare -> TWIM start.
+#define AUTO_PPI_CH_CLEAR               3               // RTC compare -> RTC clear.
+#define AUTO_PPI_CH_COUNT               4               // TWIM stopped -> TIMER count.
+#define AUTO_PPI_CH_MASK                ((1UL << AUTO_PPI_CH_START) | (1UL << AUTO_PPI_CH_CLEAR) | (1UL << AUTO_PPI_CH_COUNT))
+
+STATIC_ASSERT(DRV_AK9750_AUTO_RECORD_LEN == DATA_BLOCK_LEN);
+
+/**@brief Set to 1 to read back and log the threshold registers after they are written.
+ *        Only honoured in DEBUG builds.
+ */
+#ifndef AK9750_CONFIG_READBACK
+#define AK9750_CONFIG_READBACK          0
+#endif
+
 /**@brief Check if the driver is open, if not return NRF_ERROR_INVALID_STATE.
  */
 #define DRV_CFG_CHECK(PARAM)                                                                      \
@@ -55,8 +93,22 @@
 static struct
 {
     drv_ak9750_twi_cfg_t const * p_cfg;
+    uint8_t                      shadow[SHADOW_REG_COUNT];   ///< Last value written to each cached register.
+    uint16_t                     shadow_valid;               ///< Bit n set if shadow[n] is known to match the chip.
 } m_ak9750;
 
+/**@brief Autonomous acquisition state.
+ */
+static struct
+{
+    drv_ak9750_batch_handler_t handler;
+    uint8_t                    batch_len;
+    uint8_t                    filling;                                                     ///< Buffer EasyDMA writes to.
+    bool                       active;
+    uint8_t                    reg;                                                         ///< Register address sent before each read.
+    uint8_t                    buf[2][DRV_AK9750_AUTO_BATCH_MAX * DRV_AK9750_AUTO_RECORD_LEN];
+} m_auto;
+
 
 /**@brief Open the TWI bus for communication.
  */
@@ -139,6 +191,137 @@ static uint32_t reg_read(uint8_t reg_addr, uint8_t * p_reg_val)
     return NRF_SUCCESS;
 }
 
+/**@brief Function for reading a block of consecutive sensor registers in one transfer.
+ *
+ * @param[in]  reg_addr            Address of the first register to read.
+ * @param[out] p_buf               Buffer to receive the register values.
+ * @param[in]  len                 Number of registers to read.
+ *
+ * @retval NRF_SUCCESS             If operation was successful.
+ * @retval NRF_ERROR_BUSY          If the TWI drivers are busy.
+ */
+static uint32_t reg_read_burst(uint8_t reg_addr, uint8_t * p_buf, uint8_t len)
+{
+    uint32_t err_code;
+
+    err_code = nrf_drv_twi_tx( m_ak9750.p_cfg->p_twi_instance,
+                               m_ak9750.p_cfg->twi_addr,
+                               &reg_addr,
+                               1,
+                               true );
+    RETURN_IF_ERROR(err_code);
+
+    err_code = nrf_drv_twi_rx( m_ak9750.p_cfg->p_twi_instance,
+                               m_ak9750.p_cfg->twi_addr,
+                               p_buf,
+                               len );
+    RETURN_IF_ERROR(err_code);
+
+    return NRF_SUCCESS;
+}
+
+/**@brief Function for forgetting the cached register values, e.g. after a soft reset.
+ */
+static void shadow_invalidate(void)
+{
+    m_ak9750.shadow_valid = 0;
+}
+
+/**@brief Function for writing a block of cached registers.
+ *
+ * @details Only the span between the first and last register whose value differs from the
+ *          shadow cache is sent, as a single auto-incrementing burst. Nothing is sent when
+ *          all values already match.
+ *
+ * @param[in]  reg_addr            Address of the first register, within the shadow range.
+ * @param[in]  p_vals              Values to write.
+ * @param[in]  len                 Number of registers to write.
+ *
+ * @retval NRF_SUCCESS             If operation was successful.
+ * @retval NRF_ERROR_BUSY          If the TWI drivers are busy.
+ */
+static uint32_t shadow_write(uint8_t reg_addr, uint8_t const * p_vals, uint8_t len)
+{
+    uint32_t err_code;
+    uint8_t  buffer[SHADOW_REG_COUNT + 1];
+    uint8_t  base  = reg_addr - SHADOW_FIRST_REG;
+    int8_t   first = -1;
+    int8_t   last  = -1;
+
+    ASSERT((reg_addr >= SHADOW_FIRST_REG) && ((reg_addr + len - 1) <= SHADOW_LAST_REG));
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        uint8_t idx = base + i;
+
+        if (!(m_ak9750.shadow_valid & (1 << idx)) || (m_ak9750.shadow[idx] != p_vals[i]))
+        {
+            if (first < 0)
+            {
+                first = i;
+            }
+            last = i;
+        }
+    }
+
+    if (first < 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    buffer[0] = reg_addr + first;
+    memcpy(&buffer[1], &p_vals[first], last - first + 1);
+
+    err_code = nrf_drv_twi_tx( m_ak9750.p_cfg->p_twi_instance,
+                               m_ak9750.p_cfg->twi_addr,
+                               buffer,
+                               last - first + 2,
+                               false );
+    if (err_code != NRF_SUCCESS)
+    {
+        // The chip may hold part of the burst; make sure it is resent next time.
+        for (uint8_t i = first; i <= last; i++)
+        {
+            m_ak9750.shadow_valid &= ~(1 << (base + i));
+        }
+        return err_code;
+    }
+
+    for (uint8_t i = first; i <= last; i++)
+    {
+        m_ak9750.shadow[base + i] = p_vals[i];
+        m_ak9750.shadow_valid    |= (1 << (base + i));
+    }
+
+    return NRF_SUCCESS;
+}
+
+#if defined(DEBUG) && AK9750_CONFIG_READBACK
+/**@brief Function for reading back the threshold registers and comparing them to the cache.
+ */
+static uint32_t threshold_readback(void)
+{
+    uint32_t err_code;
+    uint8_t  regs[THRESHOLD_REG_COUNT];
+
+    err_code = reg_read_burst(ETH13H_L, regs, THRESHOLD_REG_COUNT);
+    RETURN_IF_ERROR(err_code);
+
+    NRF_LOG_RAW_INFO("ETH13H: %d %d\n", regs[0], regs[1]);
+    NRF_LOG_RAW_INFO("ETH13L: %d %d\n", regs[2], regs[3]);
+    NRF_LOG_RAW_INFO("ETH24H: %d %d\n", regs[4], regs[5]);
+    NRF_LOG_RAW_INFO("ETH24L: %d %d\n", regs[6], regs[7]);
+
+    if (memcmp(regs, &m_ak9750.shadow[ETH13H_L - SHADOW_FIRST_REG], THRESHOLD_REG_COUNT) != 0)
+    {
+        NRF_LOG_WARNING("AK9750 threshold read-back mismatch\r\n");
+        shadow_invalidate();
+    }
+
+    return NRF_SUCCESS;
+}
+#endif
+
 uint32_t drv_ak9750_open(drv_ak9750_twi_cfg_t const * const p_cfg)
 {
     m_ak9750.p_cfg = p_cfg;
@@ -163,6 +346,9 @@ uint32_t drv_ak9750_reset(void)
 {
     uint32_t err_code;
 
+    // All writable registers return to their defaults.
+    shadow_invalidate();
+
     err_code = reg_write(CNTL2, SRST);
     RETURN_IF_ERROR(err_code);
 
@@ -258,129 +444,53 @@ uint32_t drv_ak9750_init(void)
 uint32_t drv_ak9750_cfg_set(ble_dds_config_t * config)
 {
     uint32_t err_code;
-    uint8_t  dummy;
-
-    // int value = -200;
-    // uint8_t lb = value;
-    // uint8_t ub = value >> 8;
-
-    uint8_t lb;
-    uint8_t ub;
+    uint8_t  status[STATUS_BLOCK_LEN];
+    uint8_t  thresholds[THRESHOLD_REG_COUNT];
+    uint8_t  ctrl[2];   // EINTEN, ECNTL1
 
     // Load Config Values
-    int16_t eth13h = config->threshold_config.eth13h;              
+    int16_t eth13h = config->threshold_config.eth13h;
     int16_t eth13l = config->threshold_config.eth13l;
-    int16_t eth24h = config->threshold_config.eth24h;                              
+    int16_t eth24h = config->threshold_config.eth24h;
     int16_t eth24l = config->threshold_config.eth24l;
 
-    // Read out vars
-    uint8_t eth13_hl[1];
-    uint8_t eth13_hh[1];
-    uint8_t eth13_ll[1];
-    uint8_t eth13_lh[1];
-
-    uint8_t eth24_hl[1];
-    uint8_t eth24_hh[1];
-    uint8_t eth24_ll[1];
-    uint8_t eth24_lh[1];
-
     DRV_CFG_CHECK(m_ak9750.p_cfg);
 
-    lb = eth13h;
-    ub = eth13h >> 8;
-
-    //Setting ETH13H High Threshold
-    err_code = reg_write(ETH13H_L, lb);
-    RETURN_IF_ERROR(err_code);
-    err_code = reg_write(ETH13H_H, ub);
-    RETURN_IF_ERROR(err_code);
-
-    lb = eth13l;
-    ub = eth13l >> 8;
+    // ETH13H_L .. ETH24L_H, little endian pairs
+    thresholds[0] = eth13h;
+    thresholds[1] = eth13h >> 8;
+    thresholds[2] = eth13l;
+    thresholds[3] = eth13l >> 8;
+    thresholds[4] = eth24h;
+    thresholds[5] = eth24h >> 8;
+    thresholds[6] = eth24l;
+    thresholds[7] = eth24l >> 8;
 
-    //Setting hreshold
-    err_code = reg_write(ETH13L_L, lb);
-    RETURN_IF_ERROR(err_code);
-    err_code = reg_write(ETH13L_H, ub);
+    err_code = shadow_write(ETH13H_L, thresholds, THRESHOLD_REG_COUNT);
     RETURN_IF_ERROR(err_code);
 
-    lb = eth24h;
-    ub = eth24h >> 8;
-
-    //Setting hreshold
-    err_code = reg_write(ETH24H_L, lb);
-    RETURN_IF_ERROR(err_code);
-    err_code = reg_write(ETH24H_H, ub);
+#if defined(DEBUG) && AK9750_CONFIG_READBACK
+    err_code = threshold_readback();
     RETURN_IF_ERROR(err_code);
+#endif
 
-    lb = eth24l;
-    ub = eth24l >> 8;
-
-    //Setting hreshold
-    err_code = reg_write(ETH24L_L, lb);
-    RETURN_IF_ERROR(err_code);
-    err_code = reg_write(ETH24L_H, ub);
-    RETURN_IF_ERROR(err_code);
-
-    //Read ETH13H Threshold values
-    err_code = reg_read(ETH13H_L, eth13_hl);
-    RETURN_IF_ERROR(err_code);
-    err_code = reg_read(ETH13H_H, eth13_hh);
-    RETURN_IF_ERROR(err_code);
-
-    //Read ETd values
-    err_code = reg_read(ETH13L_L, eth13_ll);
-    RETURN_IF_ERROR(err_code);
-    err_code = reg_read(ETH13L_H, eth13_lh);
-    RETURN_IF_ERROR(err_code);
-
-    //Read ETd values
-    err_code = reg_read(ETH24H_L, eth24_hl);
-    RETURN_IF_ERROR(err_code);
-    err_code = reg_read(ETH24H_H, eth24_hh);
-    RETURN_IF_ERROR(err_code);
-
-    //Read ETd values
-    err_code = reg_read(ETH24L_L, eth24_ll);
-    RETURN_IF_ERROR(err_code);
-    reg_read(ETH24L_H, eth24_lh);
-    RETURN_IF_ERROR(err_code);
-
-    NRF_LOG_RAW_INFO("ETH13HL: %d\n", eth13_hl[0]);
-    NRF_LOG_RAW_INFO("ETH13HH: %d\n", eth13_hh[0]);
-
-    NRF_LOG_RAW_INFO("ETH13LL: %d\n", eth13_ll[0]);
-    NRF_LOG_RAW_INFO("ETH13LH: %d\n", eth13_lh[0]);
-
-    NRF_LOG_RAW_INFO("ETH24HL: %d\n", eth24_hl[0]);
-    NRF_LOG_RAW_INFO("ETH24HH: %d\n", eth24_hh[0]);
-
-    NRF_LOG_RAW_INFO("ETH24LL: %d\n", eth24_ll[0]);
-    NRF_LOG_RAW_INFO("ETH24LH: %d\n", eth24_lh[0]);
+    // Set Mode Reg
+    ctrl[1] = NORMAL_FC_8_8_CONTINUOUS;
 
     if(config->sample_mode == SAMPLE_MODE_MOTION)
     {
-        //NRF_LOG_INFO("!!!!!! DRV_RANGE_MODE_MOTION ENABLED !!!!! \r\n");
+        // Enable Interrupt for thresholds only
+        ctrl[0] = DRI_DISABLE_ALL_THRESHOLD;
 
-        // Set Mode Reg
-        err_code = reg_write(ECNTL1, NORMAL_FC_8_8_CONTINUOUS);
-        RETURN_IF_ERROR(err_code);
-
-        // Enable Interrupt for DRI
-        err_code = reg_write(EINTEN, DRI_DISABLE_ALL_THRESHOLD);
+        err_code = shadow_write(EINTEN, ctrl, sizeof(ctrl));
         RETURN_IF_ERROR(err_code);
     }
     else if(config->sample_mode == SAMPLE_MODE_CONTINUOUS)
     {
-        //NRF_LOG_INFO("!!!!!! DRV_RANGE_MODE_CONTINUOUS ENABLED !!!!! \r\n");
-
-        // Set Mode Reg
-        err_code = reg_write(ECNTL1, NORMAL_FC_8_8_CONTINUOUS);
-        RETURN_IF_ERROR(err_code);
+        // No interrupt sources, sampling is timer driven
+        ctrl[0] = DRI_DISABLE_NO_THRESHOLD;
 
-        // Enable Interrupt for DRI
-        //err_code = reg_write(EINTEN, DRI_DISABLE_ALL_THRESHOLD);
-        err_code = reg_write(EINTEN, DRI_DISABLE_NO_THRESHOLD);
+        err_code = shadow_write(EINTEN, ctrl, sizeof(ctrl));
         RETURN_IF_ERROR(err_code);
     }
     else
@@ -388,11 +498,8 @@ uint32_t drv_ak9750_cfg_set(ble_dds_config_t * config)
         NRF_LOG_INFO("AK9750 - !!!!!! UNKNOWN SAMPLE MODE !!!!! \r\n");
     }
 
-    // Read Interrupt Status
-    err_code = reg_read(INTST, &dummy);
-    RETURN_IF_ERROR(err_code);
-
-    err_code = reg_read(ST2, &dummy);
+    // Read INTST through ST2 to release any pending interrupt and data latch
+    err_code = reg_read_burst(INTST, status, STATUS_BLOCK_LEN);
     RETURN_IF_ERROR(err_code);
 
     return NRF_SUCCESS;
@@ -467,6 +574,10 @@ uint32_t drv_ak9750_one_shot(void)
 
     DRV_CFG_CHECK(m_ak9750.p_cfg);
 
+    // The chip drops back to standby on its own after a single shot,
+    // so ECNTL1 cannot be trusted from the cache afterwards.
+    m_ak9750.shadow_valid &= ~(1 << (ECNTL1 - SHADOW_FIRST_REG));
+
     // Set Mode Reg
     err_code = reg_write(ECNTL1, NORMAL_FC_8_8_SINGLE_SHOT_MODE);
     RETURN_IF_ERROR(err_code);
@@ -479,20 +590,12 @@ uint32_t drv_ak9750_one_shot(void)
     return NRF_SUCCESS;
 }
 
-uint32_t drv_ak9750_get_irs(ble_dds_presence_t * presence)
+uint32_t drv_ak9750_get_irs(ble_dds_presence_t * presence, int16_t * p_temperature)
 {
     uint32_t iTimeout = 0;
     uint32_t err_code;
-    uint8_t ir1_l;
-    uint8_t ir1_h;
-    uint8_t ir2_l;
-    uint8_t ir2_h;
-    uint8_t ir3_l;
-    uint8_t ir3_h;
-    uint8_t ir4_l;
-    uint8_t ir4_h;
-    uint8_t   st1;
-    uint8_t dummy;
+    uint8_t  data[DATA_BLOCK_LEN];
+    uint8_t  st1;
 
     DRV_CFG_CHECK(m_ak9750.p_cfg);
 
@@ -507,70 +610,215 @@ uint32_t drv_ak9750_get_irs(ble_dds_presence_t * presence)
 
         if (iTimeout > 2) 
         {
-            NRF_LOG_RAW_INFO("\n*** AK9750 Timeout ***\n");
+            TLOG(TLOG_MODULE_AK9750, "*** AK9750 Timeout ***\r\n");
             break;
         }
 
     }while(!(st1 & (1<<0)));
 
-    err_code = reg_read(ST1, &st1);
+    // IR1L through ST2 in one burst, ST2 must be read out after the data registers
+    err_code = reg_read_burst(IR1L, data, DATA_BLOCK_LEN);
     RETURN_IF_ERROR(err_code);
 
-    // IR1
-    err_code = reg_read(IR1L, &ir1_l);
-    RETURN_IF_ERROR(err_code);
-    //NRF_LOG_INFO("IR1L %d \r\n", ir1_l);
+    drv_ak9750_record_decode(data, presence, p_temperature);
 
-    err_code = reg_read(IR1H, &ir1_h);
-    RETURN_IF_ERROR(err_code);
-    //NRF_LOG_INFO("IR1H %d \r\n", ir1_h);
+    TLOG(TLOG_MODULE_AK9750, "IR1: %d IR2: %d IR3: %d IR4: %d\r\n", presence->ir1, presence->ir2, presence->ir3, presence->ir4);
 
-    // IR2
-    err_code = reg_read(IR2L, &ir2_l);
-    RETURN_IF_ERROR(err_code);
-    //NRF_LOG_INFO("IR2L %d \r\n", ir2_l);
+    return NRF_SUCCESS;
+}
 
-    err_code = reg_read(IR2H, &ir2_h);
-    RETURN_IF_ERROR(err_code);
-    //NRF_LOG_INFO("IR2H %d \r\n", ir2_h);
+void drv_ak9750_record_decode(uint8_t const * p_record, ble_dds_presence_t * presence, int16_t * p_temperature)
+{
+    presence->ir1 = p_record[IR1L - IR1L] + (p_record[IR1H - IR1L] << 8);
+    presence->ir2 = p_record[IR2L - IR1L] + (p_record[IR2H - IR1L] << 8);
+    presence->ir3 = p_record[IR3L - IR1L] + (p_record[IR3H - IR1L] << 8);
+    presence->ir4 = p_record[IR4L - IR1L] + (p_record[IR4H - IR1L] << 8);
 
-    // IR3
-    err_code = reg_read(IR3L, &ir3_l);
-    RETURN_IF_ERROR(err_code);
-    //NRF_LOG_INFO("IR3L %d \r\n", ir3_l);
+    if (p_temperature != NULL)
+    {
+        *p_temperature = (int16_t)(p_record[TMPL - IR1L] + (p_record[TMPH - IR1L] << 8)) >> TMP_DATA_SHIFT;
+    }
+}
 
-    err_code = reg_read(IR3H, &ir3_h);
-    RETURN_IF_ERROR(err_code);
-    //NRF_LOG_INFO("IR3H %d \r\n", ir3_h);
+/**@brief Full batch, executed in main-context.
+ */
+static void auto_batch_scheduled(void * p_event_data, uint16_t event_size)
+{
+    uint8_t done = *(uint8_t *)p_event_data;
 
-    // IR4
-    err_code = reg_read(IR4L, &ir4_l);
-    RETURN_IF_ERROR(err_code);
-    //NRF_LOG_INFO("IR4L %d \r\n", ir4_l);
+    if (m_auto.active)
+    {
+        m_auto.handler(m_auto.buf[done], m_auto.batch_len);
+    }
+}
 
-    err_code = reg_read(IR4H, &ir4_h);
-    RETURN_IF_ERROR(err_code);
-    //NRF_LOG_INFO("IR4H %d \r\n", ir4_h);
+/**@brief Batch counter reached, executed in interrupt-context.
+ *
+ * @details The last read of the batch has completed, the next one is at least one interval away,
+ *          so the RX pointer can be moved to the other buffer without racing EasyDMA.
+ */
+void AUTO_TIMER_IRQHandler(void)
+{
+    uint32_t err_code;
+    uint8_t  done = m_auto.filling;
 
-    //Must be read out after data registers
-    err_code = reg_read(ST1, &dummy);
-    RETURN_IF_ERROR(err_code);
+    nrf_timer_event_clear(AUTO_TIMER, NRF_TIMER_EVENT_COMPARE0);
+
+    m_auto.filling ^= 1;
+    nrf_twim_rx_buffer_set(m_ak9750.p_cfg->p_twi_instance->u.twim.p_twim,
+                           m_auto.buf[m_auto.filling],
+                           DRV_AK9750_AUTO_RECORD_LEN);
+
+    err_code = prio_sched_event_put(&done, sizeof(done), auto_batch_scheduled, PRIO_SCHED_NORMAL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief TWI event handler, only bus errors are reported in autonomous mode.
+ */
+static void auto_twi_evt_handler(nrf_drv_twi_evt_t const * p_event, void * p_context)
+{
+    NRF_LOG_WARNING("AK9750 autonomous read failed: %d\r\n", p_event->type);
+}
+
+/**@brief Function for stopping the RTC, PPI, TIMER and TWI of autonomous mode.
+ *
+ * @details Safe on a partly set up chain, so a failed start can go through it too.
+ */
+static uint32_t auto_teardown(void)
+{
+    nrf_rtc_task_trigger(AUTO_RTC, NRF_RTC_TASK_STOP);
+    nrf_rtc_event_disable(AUTO_RTC, NRF_RTC_EVENT_COMPARE_0);
+
+    (void)sd_ppi_channel_enable_clr(AUTO_PPI_CH_MASK);
+
+    NVIC_DisableIRQ(AUTO_TIMER_IRQn);
+    nrf_timer_int_disable(AUTO_TIMER, NRF_TIMER_INT_COMPARE0_MASK);
+    nrf_timer_task_trigger(AUTO_TIMER, NRF_TIMER_TASK_STOP);
+
+    return twi_close();
+}
+
+uint32_t drv_ak9750_auto_start(drv_ak9750_twi_cfg_t const * const p_cfg,
+                               uint16_t                           interval_ms,
+                               uint8_t                            batch_len,
+                               drv_ak9750_batch_handler_t         handler)
+{
+    uint32_t             err_code;
+    nrf_drv_twi_config_t twi_cfg;
+
+    VERIFY_PARAM_NOT_NULL(handler);
+
+    if ((batch_len == 0) || (batch_len > DRV_AK9750_AUTO_BATCH_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_ak9750.p_cfg = p_cfg;
 
-    //Must be read out after data registers
-    err_code = reg_read(ST2, &dummy);
+    m_auto.handler   = handler;
+    m_auto.batch_len = batch_len;
+    m_auto.filling   = 0;
+    m_auto.reg       = IR1L;
+
+    // Non-blocking mode, needed for the held TXRX transfer
+    twi_cfg                    = *p_cfg->p_twi_cfg;
+    twi_cfg.interrupt_priority = APP_IRQ_PRIORITY_LOW;
+
+    err_code = twi_manager_request(p_cfg->p_twi_instance, &twi_cfg, auto_twi_evt_handler, NULL);
     RETURN_IF_ERROR(err_code);
 
-    presence->ir1 = ir1_l + (ir1_h << 8);
-    NRF_LOG_RAW_INFO("\nIR1: %d  \n", presence->ir1);
+    nrf_drv_twi_enable(p_cfg->p_twi_instance);
 
-    presence->ir2 = ir2_l + (ir2_h << 8);
-    NRF_LOG_RAW_INFO("IR2: %d  \n", presence->ir2);
+    nrf_drv_twi_xfer_desc_t xfer = NRF_DRV_TWI_XFER_DESC_TXRX(p_cfg->twi_addr,
+                                                              &m_auto.reg,
+                                                              sizeof(m_auto.reg),
+                                                              m_auto.buf[0],
+                                                              DRV_AK9750_AUTO_RECORD_LEN);
 
-    presence->ir3 = ir3_l + (ir3_h << 8);
-    NRF_LOG_RAW_INFO("IR3: %d  \n", presence->ir3);
+    err_code = nrf_drv_twi_xfer(p_cfg->p_twi_instance,
+                                &xfer,
+                                NRF_DRV_TWI_FLAG_HOLD_XFER         |
+                                NRF_DRV_TWI_FLAG_REPEATED_XFER     |
+                                NRF_DRV_TWI_FLAG_RX_POSTINC        |
+                                NRF_DRV_TWI_FLAG_NO_XFER_EVT_HANDLER);
+    if (err_code != NRF_SUCCESS)
+    {
+        (void)auto_teardown();
+        return err_code;
+    }
 
-    presence->ir4 = ir4_l + (ir4_h << 8);
-    NRF_LOG_RAW_INFO("IR4: %d  \n", presence->ir4);
+    // Count completed reads, interrupt once per batch
+    nrf_timer_task_trigger(AUTO_TIMER, NRF_TIMER_TASK_STOP);
+    nrf_timer_task_trigger(AUTO_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_mode_set(AUTO_TIMER, NRF_TIMER_MODE_COUNTER);
+    nrf_timer_bit_width_set(AUTO_TIMER, NRF_TIMER_BIT_WIDTH_16);
+    nrf_timer_cc_write(AUTO_TIMER, NRF_TIMER_CC_CHANNEL0, batch_len);
+    nrf_timer_shorts_enable(AUTO_TIMER, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK);
+    nrf_timer_event_clear(AUTO_TIMER, NRF_TIMER_EVENT_COMPARE0);
+    nrf_timer_int_enable(AUTO_TIMER, NRF_TIMER_INT_COMPARE0_MASK);
+    NVIC_ClearPendingIRQ(AUTO_TIMER_IRQn);
+    NVIC_SetPriority(AUTO_TIMER_IRQn, APP_IRQ_PRIORITY_LOW);
+    NVIC_EnableIRQ(AUTO_TIMER_IRQn);
+    nrf_timer_task_trigger(AUTO_TIMER, NRF_TIMER_TASK_START);
+
+    // Pace the reads from the 32 kHz clock
+    nrf_rtc_task_trigger(AUTO_RTC, NRF_RTC_TASK_STOP);
+    nrf_rtc_task_trigger(AUTO_RTC, NRF_RTC_TASK_CLEAR);
+    nrf_rtc_prescaler_set(AUTO_RTC, 0);
+    nrf_rtc_cc_set(AUTO_RTC, 0, APP_TIMER_TICKS(interval_ms));
+    nrf_rtc_event_clear(AUTO_RTC, NRF_RTC_EVENT_COMPARE_0);
+    nrf_rtc_event_enable(AUTO_RTC, NRF_RTC_EVENT_COMPARE_0);
+
+    // PPI is shared with the SoftDevice, go through it
+    err_code = sd_ppi_channel_assign(AUTO_PPI_CH_START,
+                                     (void *)nrf_rtc_event_address_get(AUTO_RTC, NRF_RTC_EVENT_COMPARE_0),
+                                     (void *)nrf_drv_twi_start_task_get(p_cfg->p_twi_instance, NRF_DRV_TWI_XFER_TXRX));
+    if (err_code != NRF_SUCCESS)
+    {
+        (void)auto_teardown();
+        return err_code;
+    }
+
+    err_code = sd_ppi_channel_assign(AUTO_PPI_CH_CLEAR,
+                                     (void *)nrf_rtc_event_address_get(AUTO_RTC, NRF_RTC_EVENT_COMPARE_0),
+                                     (void *)nrf_rtc_task_address_get(AUTO_RTC, NRF_RTC_TASK_CLEAR));
+    if (err_code != NRF_SUCCESS)
+    {
+        (void)auto_teardown();
+        return err_code;
+    }
+
+    err_code = sd_ppi_channel_assign(AUTO_PPI_CH_COUNT,
+                                     (void *)nrf_drv_twi_stopped_event_get(p_cfg->p_twi_instance),
+                                     nrf_timer_task_address_get(AUTO_TIMER, NRF_TIMER_TASK_COUNT));
+    if (err_code != NRF_SUCCESS)
+    {
+        (void)auto_teardown();
+        return err_code;
+    }
+
+    err_code = sd_ppi_channel_enable_set(AUTO_PPI_CH_MASK);
+    if (err_code != NRF_SUCCESS)
+    {
+        (void)auto_teardown();
+        return err_code;
+    }
+
+    m_auto.active = true;
+
+    nrf_rtc_task_trigger(AUTO_RTC, NRF_RTC_TASK_START);
 
     return NRF_SUCCESS;
-}
\ No newline at end of file
+}
+
+uint32_t drv_ak9750_auto_stop(void)
+{
+    if (!m_auto.active)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_auto.active = false;
+
+    return auto_teardown();
+}
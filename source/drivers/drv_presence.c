@@ -3,7 +3,11 @@
 #include "sdk_macros.h"
 #include "nrf_log.h"
 #include "nrf_drv_gpiote.h"
-#include "app_scheduler.h"
+#include "prio_sched.h"
+#include "spsc_ring.h"
+#include "hw_timestamp.h"
+#include "sample_sched.h"
+#include <stdlib.h>
 
 #define DRI_MASK                    0x01
 #define IR13H_MASK                  0x10
@@ -11,14 +15,44 @@
 #define IR24H_MASK                  0x06
 #define IR24L_MASK                  0x04
 
+#define DRIFT_CHECK_INTERVAL_MS     10000       // How often the idle IR baseline is sampled in motion mode.
+#define DRIFT_BASELINE_FRAC_BITS    4           // Fractional bits kept in the baseline filter.
+#define DRIFT_EMA_SHIFT_STEADY      4           // Baseline follows 1/16 of the error while temperature is steady.
+#define DRIFT_EMA_SHIFT_TEMP        1           // Baseline follows 1/2 of the error once temperature has moved.
+#define DRIFT_TEMP_STEP             4           // Temperature change treated as a move (0.5 degC in AK9750 units).
+#define DRIFT_THRESHOLD_STEP        16          // Baseline movement [counts] before thresholds are rewritten.
+
+#define SESSION_UNIT_MS             100         // Unit of the ble_dds_session_config_t fields.
+#define SESSION_TICKS(units)        APP_TIMER_TICKS((uint32_t)(units) * SESSION_UNIT_MS)
+#define SESSION_TICKS_HALF_RANGE    ((APP_TIMER_MAX_CNT_VAL + 1) / 2)
+
+#define EDGE_RING_SIZE              8           // Interrupt edges waiting for main context.
+
+/**@brief Temperature compensated IR baseline.
+ */
+typedef struct
+{
+    int32_t  baseline[4];       ///< Per channel idle baseline, DRIFT_BASELINE_FRAC_BITS fixed point.
+    int16_t  temperature;       ///< AK9750 temperature when the baseline last followed a temperature move.
+    int16_t  offset13;          ///< IR1-IR3 baseline currently applied to the ETH13 thresholds.
+    int16_t  offset24;          ///< IR2-IR4 baseline currently applied to the ETH24 thresholds.
+    bool     valid;             ///< Baseline has been seeded.
+} drv_presence_drift_t;
+
 /**@brief Pressure configuration struct.
  */
 typedef struct
 {
     drv_ak9750_twi_cfg_t         cfg;           ///< TWI configuraion.
     drv_presence_evt_handler_t   evt_handler;   ///< Event handler called by gpiote_evt_sceduled.
-    ble_dds_sample_mode_t          mode;          ///< Mode of operation.
+    ble_dds_sample_mode_t        mode;          ///< Mode of operation.
     bool                         enabled;       ///< Driver enabled.
+    ble_dds_config_t             config;        ///< Configuration given to drv_presence_enable.
+    int16_t                      temperature;   ///< Last AK9750 temperature read.
+    drv_presence_drift_t         drift;         ///< Temperature drift compensation state.
+    uint32_t                     deadline;      ///< RTC tick at which the motion session ends, moved forward per interrupt.
+    bool                         holdoff;       ///< A motion session ended recently, new sessions are not started.
+    bool                         autonomous;    ///< Sampling through drv_ak9750_auto_start.
 } drv_presence_t;
 
 /**@brief Stored configuration.
@@ -27,16 +61,196 @@ static drv_presence_t m_drv_presence;
 
 static bool ak9750_output_active = false;
 
-APP_TIMER_DEF(timeout_motion_timer_id);
+SPSC_RING_DEF(m_edge_ring, uint32_t, EDGE_RING_SIZE);   ///< RTC ticks of interrupt edges.
+
+static nrf_atomic_flag_t m_drain_pending;               ///< A drain is in the scheduler queue.
+static nrf_atomic_u32_t  m_edges_dropped;               ///< Edges lost to a full ring.
+
+SAMPLE_SCHED_DEF(timeout_motion_action);
+SAMPLE_SCHED_DEF(drift_action);
+
+/**@brief Clamp a threshold to the range accepted by the AK9750.
+ */
+static int16_t threshold_clamp(int32_t value)
+{
+    if (value < BLE_DDS_CONFIG_THRESHOLD_MIN)
+    {
+        return BLE_DDS_CONFIG_THRESHOLD_MIN;
+    }
+    if (value > BLE_DDS_CONFIG_THRESHOLD_MAX)
+    {
+        return BLE_DDS_CONFIG_THRESHOLD_MAX;
+    }
+    return value;
+}
+
+/**@brief Write the configured thresholds, shifted by the current differential baseline.
+ */
+static uint32_t drift_thresholds_apply(void)
+{
+    ble_dds_config_t config = m_drv_presence.config;
+    int16_t          offset13 = m_drv_presence.drift.offset13;
+    int16_t          offset24 = m_drv_presence.drift.offset24;
+
+    config.threshold_config.eth13h = threshold_clamp(config.threshold_config.eth13h + offset13);
+    config.threshold_config.eth13l = threshold_clamp(config.threshold_config.eth13l + offset13);
+    config.threshold_config.eth24h = threshold_clamp(config.threshold_config.eth24h + offset24);
+    config.threshold_config.eth24l = threshold_clamp(config.threshold_config.eth24l + offset24);
+
+    return drv_ak9750_cfg_set(&config);
+}
+
+/**@brief Feed an idle IR sample into the baseline filter.
+ *
+ * @details The baseline follows slowly while the temperature is steady, so a person is not
+ *          learned into it, and quickly once the AK9750 temperature has moved.
+ *
+ * @retval true if the IR1-IR3 or IR2-IR4 baseline moved enough that the thresholds must be rewritten.
+ */
+static bool drift_update(ble_dds_presence_t const * p_presence, int16_t temperature)
+{
+    drv_presence_drift_t * p_drift = &m_drv_presence.drift;
+    int16_t                ir[4]   = {p_presence->ir1, p_presence->ir2, p_presence->ir3, p_presence->ir4};
+    uint8_t                shift   = DRIFT_EMA_SHIFT_STEADY;
+    int16_t                base13;
+    int16_t                base24;
+
+    if (!p_drift->valid)
+    {
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            p_drift->baseline[i] = (int32_t)ir[i] << DRIFT_BASELINE_FRAC_BITS;
+        }
+        p_drift->temperature = temperature;
+        p_drift->valid       = true;
+    }
+    else
+    {
+        if (abs(temperature - p_drift->temperature) >= DRIFT_TEMP_STEP)
+        {
+            shift                = DRIFT_EMA_SHIFT_TEMP;
+            p_drift->temperature = temperature;
+        }
+
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            int32_t sample = (int32_t)ir[i] << DRIFT_BASELINE_FRAC_BITS;
+
+            p_drift->baseline[i] += (sample - p_drift->baseline[i]) >> shift;
+        }
+    }
+
+    base13 = (p_drift->baseline[0] - p_drift->baseline[2]) >> DRIFT_BASELINE_FRAC_BITS;
+    base24 = (p_drift->baseline[1] - p_drift->baseline[3]) >> DRIFT_BASELINE_FRAC_BITS;
+
+    if ((abs(base13 - p_drift->offset13) < DRIFT_THRESHOLD_STEP) &&
+        (abs(base24 - p_drift->offset24) < DRIFT_THRESHOLD_STEP))
+    {
+        return false;
+    }
+
+    p_drift->offset13 = base13;
+    p_drift->offset24 = base24;
+
+    return true;
+}
+
+/**@brief Periodic idle sample used to track the temperature drift of the IR baseline.
+ */
+static void drift_timeout_handler(void * p_context)
+{
+    uint32_t           err_code;
+    ble_dds_presence_t presence;
+    int16_t            temperature;
+
+    // Samples taken during a motion session are not idle background
+    if (ak9750_output_active || !m_drv_presence.enabled)
+    {
+        return;
+    }
+
+    err_code = drv_ak9750_open(&m_drv_presence.cfg);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = drv_ak9750_get_irs(&presence, &temperature);
+    APP_ERROR_CHECK(err_code);
 
-// Timeout handler for the repeated timer
+    m_drv_presence.temperature = temperature;
+
+    if (drift_update(&presence, temperature))
+    {
+        NRF_LOG_INFO("AK9750 baseline moved, IR13: %d IR24: %d TMP: %d\r\n",
+                     m_drv_presence.drift.offset13,
+                     m_drv_presence.drift.offset24,
+                     temperature);
+
+        err_code = drift_thresholds_apply();
+        APP_ERROR_CHECK(err_code);
+    }
+
+    err_code = drv_ak9750_close();
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Ticks from now until an RTC tick, zero if it has passed.
+ */
+static uint32_t ticks_until(uint32_t tick)
+{
+    uint32_t ticks = app_timer_cnt_diff_compute(tick, app_timer_cnt_get());
+
+    return (ticks < SESSION_TICKS_HALF_RANGE) ? ticks : 0;
+}
+
+/**@brief Move the motion session deadline, never backwards.
+ */
+static void session_extend(uint32_t ticks)
+{
+    uint32_t deadline = (app_timer_cnt_get() + ticks) & APP_TIMER_MAX_CNT_VAL;
+
+    if (ticks_until(deadline) > ticks_until(m_drv_presence.deadline))
+    {
+        m_drv_presence.deadline = deadline;
+    }
+}
+
+// Handler for the single shot motion session and re-arm holdoff action
 static void motion_timeout_handler(void * p_context)
 {
+    uint32_t           err_code;
+    uint32_t           remaining;
     drv_presence_evt_t evt;
+
+    if (!ak9750_output_active)
+    {
+        // End of the re-arm holdoff
+        m_drv_presence.holdoff = false;
+        return;
+    }
+
+    // Interrupts only move the deadline, the action catches up with it here
+    remaining = ticks_until(m_drv_presence.deadline);
+    if (remaining >= APP_TIMER_MIN_TIMEOUT_TICKS)
+    {
+        err_code = sample_sched_start(&timeout_motion_action, remaining, 0, NULL);
+        APP_ERROR_CHECK(err_code);
+        return;
+    }
+
     evt.type = DRV_PRESENCE_EVT_MOTION_STOP;
 
     ak9750_output_active = false; 
 
+    if (SESSION_TICKS(m_drv_presence.config.session.holdoff) >= APP_TIMER_MIN_TIMEOUT_TICKS)
+    {
+        m_drv_presence.holdoff = true;
+
+        err_code = sample_sched_start(&timeout_motion_action,
+                                      SESSION_TICKS(m_drv_presence.config.session.holdoff),
+                                      0,
+                                      NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+
     m_drv_presence.evt_handler(&evt);
 }
 
@@ -48,6 +262,23 @@ static void gpiote_evt_sceduled(void * p_event_data, uint16_t event_size)
     drv_presence_evt_t evt;
     uint8_t int_status;
     uint32_t err_code;
+    uint32_t tick;
+    bool     pending = false;
+
+    (void)nrf_atomic_flag_clear(&m_drain_pending);
+
+    // INTST covers every edge queued since the last drain, one read handles them all
+    while (spsc_ring_get(&m_edge_ring, &tick))
+    {
+        pending = true;
+    }
+
+    if (!pending || !m_drv_presence.enabled)
+    {
+        return;
+    }
+
+    evt.tick = tick;
 
     gpiote_uninit(m_drv_presence.cfg.pin_int);
 
@@ -58,28 +289,29 @@ static void gpiote_evt_sceduled(void * p_event_data, uint16_t event_size)
         NRF_LOG_INFO("*********************** MOTION DETECTED ********************");
         if(int_status & IR13H_MASK || int_status & IR13L_MASK || int_status & IR24H_MASK || int_status & IR24L_MASK)
         {
-            if(!ak9750_output_active)
+            ble_dds_session_config_t const * p_session = &m_drv_presence.config.session;
+
+            if(ak9750_output_active)
+            {
+                // Motion still present, the action picks up the new deadline when it expires
+                session_extend(SESSION_TICKS(p_session->timeout));
+            }
+            else if (!m_drv_presence.holdoff)
             {
                 evt.type = DRV_PRESENCE_EVT_DATA;
                 evt.mode = SAMPLE_MODE_MOTION;
 
+                m_drv_presence.deadline = app_timer_cnt_get();
+                session_extend(SESSION_TICKS(MAX(p_session->timeout, p_session->min_length)));
+
                 // Start motion activated timeout timer, that will stop data collection when there is no more motion
-                err_code = app_timer_start(timeout_motion_timer_id, APP_TIMER_TICKS(3000), NULL);
+                err_code = sample_sched_start(&timeout_motion_action, ticks_until(m_drv_presence.deadline), 0, NULL);
                 APP_ERROR_CHECK(err_code); 
 
                 ak9750_output_active = true;
 
                 m_drv_presence.evt_handler(&evt);
             }
-            else
-            {
-                // Restart Motion Activated Timer
-                err_code = app_timer_stop(timeout_motion_timer_id);
-                APP_ERROR_CHECK(err_code); 
-
-                err_code = app_timer_start(timeout_motion_timer_id, APP_TIMER_TICKS(3000), NULL);
-                APP_ERROR_CHECK(err_code); 
-            }
         }
     }
     else if(m_drv_presence.mode == SAMPLE_MODE_CONTINUOUS)
@@ -102,9 +334,19 @@ static void gpiote_evt_sceduled(void * p_event_data, uint16_t event_size)
 static void gpiote_evt_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
 {
     uint32_t err_code;
+    uint32_t tick = hw_timestamp_get(HW_TIMESTAMP_SRC_PRESENCE);
 
-    err_code = app_sched_event_put(0, 0, gpiote_evt_sceduled);
-    APP_ERROR_CHECK(err_code);
+    if (!spsc_ring_put(&m_edge_ring, &tick))
+    {
+        (void)nrf_atomic_u32_add(&m_edges_dropped, 1);
+    }
+
+    // One scheduler entry drains everything queued until it runs
+    if (nrf_atomic_flag_set_fetch(&m_drain_pending) == 0)
+    {
+        err_code = prio_sched_event_put(0, 0, gpiote_evt_sceduled, PRIO_SCHED_NORMAL);
+        APP_ERROR_CHECK(err_code);
+    }
 }
 
 /**@brief Initialize the GPIO tasks and events system to catch pin data ready interrupts.
@@ -125,6 +367,10 @@ uint32_t gpiote_init(uint32_t pin)
     err_code = nrf_drv_gpiote_in_init(pin, &in_config, gpiote_evt_handler);
     RETURN_IF_ERROR(err_code);
 
+    // The edge is captured by the timestamp TIMER before any interrupt latency
+    err_code = hw_timestamp_attach(HW_TIMESTAMP_SRC_PRESENCE, nrf_drv_gpiote_in_event_addr_get(pin));
+    RETURN_IF_ERROR(err_code);
+
     nrf_drv_gpiote_in_event_enable(pin, true);
 
     return NRF_SUCCESS;
@@ -164,8 +410,11 @@ uint32_t drv_presence_init(drv_presence_init_t * p_params)
     // Presence sensor has internal pullup
     nrf_gpio_cfg_input(m_drv_presence.cfg.pin_int, GPIO_PIN_CNF_PULL_Disabled);
 
-    /**@brief Init application timers */
-    err_code = app_timer_create(&timeout_motion_timer_id, APP_TIMER_MODE_SINGLE_SHOT, motion_timeout_handler);
+    /**@brief Init sampling actions */
+    err_code = sample_sched_create(&timeout_motion_action, motion_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sample_sched_create(&drift_action, drift_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
     return NRF_SUCCESS;
@@ -180,7 +429,8 @@ uint32_t drv_presence_enable(ble_dds_config_t * config)
         return NRF_SUCCESS;
     }
 
-    m_drv_presence.mode = config->sample_mode;
+    m_drv_presence.mode   = config->sample_mode;
+    m_drv_presence.config = *config;
 
     err_code = gpiote_init(m_drv_presence.cfg.pin_int);
     RETURN_IF_ERROR(err_code);
@@ -188,10 +438,9 @@ uint32_t drv_presence_enable(ble_dds_config_t * config)
     err_code = drv_ak9750_open(&m_drv_presence.cfg);
     APP_ERROR_CHECK(err_code);
 
-    err_code = drv_ak9750_init();
-    RETURN_IF_ERROR(err_code);
-
-    err_code = drv_ak9750_cfg_set(config);
+    // The chip was reset in drv_presence_init, only registers that changed since are written.
+    // Thresholds stay relative to the last known baseline.
+    err_code = drift_thresholds_apply();
     RETURN_IF_ERROR(err_code);
 
     err_code = drv_ak9750_close();
@@ -199,6 +448,15 @@ uint32_t drv_presence_enable(ble_dds_config_t * config)
 
     m_drv_presence.enabled = true;
 
+    if (m_drv_presence.mode == SAMPLE_MODE_MOTION)
+    {
+        err_code = sample_sched_start(&drift_action,
+                                      SAMPLE_SCHED_TICKS(DRIFT_CHECK_INTERVAL_MS),
+                                      SAMPLE_SCHED_TICKS(DRIFT_CHECK_INTERVAL_MS),
+                                      NULL);
+        RETURN_IF_ERROR(err_code);
+    }
+
     return NRF_SUCCESS;
 }
 
@@ -206,6 +464,8 @@ uint32_t drv_presence_enable(ble_dds_config_t * config)
  */
 void gpiote_uninit(uint32_t pin)
 {
+    hw_timestamp_detach(HW_TIMESTAMP_SRC_PRESENCE);
+
     nrf_drv_gpiote_in_uninit(pin);
 }
 
@@ -217,11 +477,111 @@ uint32_t drv_presence_disable(void)
     }
     m_drv_presence.enabled = false;
 
+    sample_sched_stop(&drift_action);
+    sample_sched_stop(&timeout_motion_action);
+
+    ak9750_output_active   = false;
+    m_drv_presence.holdoff = false;
+
+    if (m_drv_presence.autonomous)
+    {
+        // The pin interrupt is already off while sampling autonomously
+        m_drv_presence.autonomous = false;
+
+        (void)drv_ak9750_auto_stop();
+    }
+    else
+    {
+        gpiote_uninit(m_drv_presence.cfg.pin_int);
+    }
+
+    spsc_ring_flush(&m_edge_ring);
+
+    if (nrf_atomic_u32_fetch_store(&m_edges_dropped, 0) > 0)
+    {
+        NRF_LOG_WARNING("AK9750 interrupt edges dropped\r\n");
+    }
+
+    return NRF_SUCCESS;
+}
+
+/**@brief Autonomous acquisition batch handler, executed in main-context.
+ */
+static void auto_batch_handler(uint8_t const * p_records, uint8_t count)
+{
+    static ble_dds_presence_t batch[DRV_AK9750_AUTO_BATCH_MAX];
+    drv_presence_evt_t        evt;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        drv_ak9750_record_decode(&p_records[i * DRV_AK9750_AUTO_RECORD_LEN],
+                                 &batch[i],
+                                 &m_drv_presence.temperature);
+    }
+
+    evt.type      = DRV_PRESENCE_EVT_BATCH;
+    evt.mode      = SAMPLE_MODE_CONTINUOUS;
+    evt.p_batch   = batch;
+    evt.batch_len = count;
+
+    m_drv_presence.evt_handler(&evt);
+}
+
+uint32_t drv_presence_auto_start(uint16_t interval_ms, uint8_t batch_len)
+{
+    uint32_t err_code;
+
+    if (!m_drv_presence.enabled || (m_drv_presence.mode != SAMPLE_MODE_CONTINUOUS))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (m_drv_presence.autonomous)
+    {
+        return NRF_SUCCESS;
+    }
+
+    // Data ready interrupts would try to open the bus held by the autonomous reads
     gpiote_uninit(m_drv_presence.cfg.pin_int);
 
+    err_code = drv_ak9750_auto_start(&m_drv_presence.cfg, interval_ms, batch_len, auto_batch_handler);
+    RETURN_IF_ERROR(err_code);
+
+    m_drv_presence.autonomous = true;
+
     return NRF_SUCCESS;
 }
 
+uint32_t drv_presence_auto_stop(void)
+{
+    uint32_t err_code;
+
+    if (!m_drv_presence.autonomous)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_drv_presence.autonomous = false;
+
+    err_code = drv_ak9750_auto_stop();
+    RETURN_IF_ERROR(err_code);
+
+    return gpiote_init(m_drv_presence.cfg.pin_int);
+}
+
+void drv_presence_baseline_seed(ble_dds_presence_t const * p_baseline)
+{
+    drv_presence_drift_t * p_drift = &m_drv_presence.drift;
+
+    p_drift->valid = false;
+
+    (void)drift_update(p_baseline, m_drv_presence.temperature);
+
+    // Make the new baseline the applied one, the caller derived its thresholds against it
+    p_drift->offset13 = p_baseline->ir1 - p_baseline->ir3;
+    p_drift->offset24 = p_baseline->ir2 - p_baseline->ir4;
+}
+
 uint32_t drv_presence_sample(void)
 {
     uint32_t err_code;
@@ -310,7 +670,7 @@ uint32_t drv_presence_get(ble_dds_presence_t * presence)
     err_code = drv_ak9750_open(&m_drv_presence.cfg);
     APP_ERROR_CHECK(err_code);
 
-    err_code = drv_ak9750_get_irs(presence);
+    err_code = drv_ak9750_get_irs(presence, &m_drv_presence.temperature);
     APP_ERROR_CHECK(err_code);
 
     err_code = drv_ak9750_close();
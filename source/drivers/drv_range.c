@@ -1,10 +1,14 @@
 #include "sdk_macros.h"
 #include "nrf_log.h"
 #include "nrf_drv_gpiote.h"
-#include "app_scheduler.h"
+#include "prio_sched.h"
 #include "drv_range.h"
 #include "drv_vl53l0x.h"
 #include "nrf_delay.h"
+#include "spsc_ring.h"
+#include "hw_timestamp.h"
+
+#define EDGE_RING_SIZE      8       // Data ready edges waiting for main context.
 
 /**@brief Pressure configuration struct.
  */
@@ -21,14 +25,36 @@ typedef struct
  */
 static drv_range_t m_drv_range;
 
+SPSC_RING_DEF(m_edge_ring, uint32_t, EDGE_RING_SIZE);   ///< RTC ticks of data ready edges.
+
+static nrf_atomic_flag_t m_drain_pending;               ///< A drain is in the scheduler queue.
+static nrf_atomic_u32_t  m_edges_dropped;               ///< Edges lost to a full ring.
+
 /**@brief GPIOTE sceduled handler, executed in main-context.
  */
 static void gpiote_evt_sceduled(void * p_event_data, uint16_t event_size)
 {
-    // Data ready
     drv_range_evt_t evt;
+    uint32_t        tick;
+    bool            ready = false;
+
+    (void)nrf_atomic_flag_clear(&m_drain_pending);
+
+    // The VL53L0X only holds the latest result, edges queued up behind it are one read
+    while (spsc_ring_get(&m_edge_ring, &tick))
+    {
+        ready = true;
+    }
+
+    if (!ready)
+    {
+        return;
+    }
+
+    // Data ready
     evt.type = DRV_RANGE_EVT_DATA;
     evt.mode = DRV_RANGE_MODE_CONTINUOUS;
+    evt.tick = tick;
 
     m_drv_range.evt_handler(&evt);
 }
@@ -38,9 +64,19 @@ static void gpiote_evt_sceduled(void * p_event_data, uint16_t event_size)
 static void gpiote_evt_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
 {
     uint32_t err_code;
+    uint32_t tick = hw_timestamp_get(HW_TIMESTAMP_SRC_RANGE);
 
-    err_code = app_sched_event_put(0, 0, gpiote_evt_sceduled);
-    APP_ERROR_CHECK(err_code);
+    if (!spsc_ring_put(&m_edge_ring, &tick))
+    {
+        (void)nrf_atomic_u32_add(&m_edges_dropped, 1);
+    }
+
+    // One scheduler entry drains everything queued until it runs
+    if (nrf_atomic_flag_set_fetch(&m_drain_pending) == 0)
+    {
+        err_code = prio_sched_event_put(0, 0, gpiote_evt_sceduled, PRIO_SCHED_NORMAL);
+        APP_ERROR_CHECK(err_code);
+    }
 }
 
 /**@brief Initialize the GPIO tasks and events system to catch pin data ready interrupts.
@@ -61,6 +97,10 @@ static uint32_t gpiote_init(uint32_t pin)
     err_code = nrf_drv_gpiote_in_init(pin, &in_config, gpiote_evt_handler);
     RETURN_IF_ERROR(err_code);
 
+    // The edge is captured by the timestamp TIMER before any interrupt latency
+    err_code = hw_timestamp_attach(HW_TIMESTAMP_SRC_RANGE, nrf_drv_gpiote_in_event_addr_get(pin));
+    RETURN_IF_ERROR(err_code);
+
     nrf_drv_gpiote_in_event_enable(pin, true);
 
     return NRF_SUCCESS;
@@ -138,6 +178,8 @@ uint32_t drv_range_enable(void)
  */
 static void gpiote_uninit(uint32_t pin)
 {
+    hw_timestamp_detach(HW_TIMESTAMP_SRC_RANGE);
+
     nrf_drv_gpiote_in_uninit(pin);
 }
 
@@ -151,6 +193,13 @@ uint32_t drv_range_disable(void)
 
     gpiote_uninit(m_drv_range.cfg.pin_int);
 
+    spsc_ring_flush(&m_edge_ring);
+
+    if (nrf_atomic_u32_fetch_store(&m_edges_dropped, 0) > 0)
+    {
+        NRF_LOG_WARNING("VL53L0X data ready edges dropped\r\n");
+    }
+
     //NRF_LOG_INFO("\n((((((((((((((((((  RANGE DISABLED  ((((((((((((\r\n");
 
     return NRF_SUCCESS;
@@ -1,6 +1,7 @@
 #include "drv_vl53l0x.h"
 #include "twi_manager.h"
 #include "nrf_log.h"
+#include "tlog.h"
 #include "nrf_delay.h"
 #include "ble_dds.h"
 
@@ -1008,7 +1009,7 @@ int16_t readRangeContinuousMillimeters(void)
     iTimeout++;
     nrf_delay_ms(1);
     if (iTimeout > 100) { 
-      NRF_LOG_RAW_INFO("\nVL Read Ranging Timeout\n");
+      TLOG(TLOG_MODULE_VL53L0X, "VL Read Ranging Timeout\r\n");
       did_timeout = true;
       return 65535; }
   }
@@ -1422,7 +1423,7 @@ uint32_t drv_vl53l0x_get_range(ble_dds_range_t * range)
 {
     range->range = readRangeContinuousMillimeters();
 
-    NRF_LOG_RAW_INFO("\nRange: %d  \n", range->range);
+    TLOG(TLOG_MODULE_VL53L0X, "Range: %d\r\n", range->range);
 
     return NRF_SUCCESS;
 }
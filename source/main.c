@@ -90,8 +90,11 @@
 #include "m_board.h"
 #include "twi_manager.h"
 #include "m_detection.h"
-#include "app_scheduler.h"
+#include "prio_sched.h"
 #include "m_batt_meas.h"
+#include "sample_sched.h"
+#include "tlog.h"
+#include "m_config_store.h"
 
 #define DETECT_SERVICES_MAX             5
 
@@ -101,7 +104,9 @@
 #define DEAD_BEEF                       0xDEADBEEF                                  /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
 #define SCHED_MAX_EVENT_DATA_SIZE       MAX(APP_TIMER_SCHED_EVENT_DATA_SIZE, BLE_STACK_HANDLER_SCHED_EVT_SIZE) /**< Maximum size of scheduler events. */
-#define SCHED_QUEUE_SIZE                60  /**< Maximum number of events in the scheduler queue. */
+#define SCHED_QUEUE_SIZE_HIGH           32  /**< Maximum number of timer and BLE library events in the scheduler queue. */
+#define SCHED_QUEUE_SIZE_NORMAL         16  /**< Maximum number of sensor interrupt events in the scheduler queue. */
+#define SCHED_QUEUE_SIZE_LOW            12  /**< Maximum number of sampling events in the scheduler queue. */
 
 #define BATT_MEAS_INTERVAL_MS           5000 // Measurement interval [ms].
 
@@ -219,11 +224,18 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
 static void timers_init(void)
 {
 
-    APP_SCHED_INIT(APP_TIMER_SCHED_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
+    PRIO_SCHED_INIT(APP_TIMER_SCHED_EVENT_DATA_SIZE,
+                    SCHED_QUEUE_SIZE_HIGH,
+                    SCHED_QUEUE_SIZE_NORMAL,
+                    SCHED_QUEUE_SIZE_LOW);
     // Initialize timer module.
     uint32_t err_code = app_timer_init();
     APP_ERROR_CHECK(err_code);
 
+    // Sensor and battery sampling share one timer
+    err_code = sample_sched_init();
+    APP_ERROR_CHECK(err_code);
+
     // Create timers.
 
     /* YOUR_JOB: Create any timers to be used by the application.
@@ -255,6 +267,9 @@ static void log_init(void)
     APP_ERROR_CHECK(err_code);
 
     NRF_LOG_DEFAULT_BACKENDS_INIT();
+
+    err_code = tlog_init();
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -264,6 +279,10 @@ static void log_init(void)
  */
 static void idle_state_handle(void)
 {
+    tlog_process();
+
+    m_config_store_process();
+
     if (NRF_LOG_PROCESS() == false)
     {
         nrf_pwr_mgmt_run();
@@ -279,6 +298,8 @@ static void m_batt_meas_handler(m_batt_meas_event_t const * p_batt_meas_event)
    
     if (p_batt_meas_event != NULL)
     {
+        (void)m_ble_broadcast_battery_set(p_batt_meas_event->level_percent);
+
         if( p_batt_meas_event->type == M_BATT_MEAS_EVENT_LOW)
         {
             //uint32_t err_code;
@@ -0,0 +1,351 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "m_agg_log.h"
+#include "m_config_store.h"
+#include "sdk_common.h"
+
+#include "fds.h"
+#include "nrf_log.h"
+
+#define AGG_FILE_ID             0x1003
+#define AGG_REC_KEY             0x1004
+
+#define FDS_PAGE_TAG_WORDS      2           // Words of a page taken by its tag, as in fds.
+#define FDS_REC_HEADER_WORDS    3           // Words of a record taken by its header, as in fds.
+#define AGG_REC_WORDS           CEIL_DIV(M_AGG_LOG_BATCH * sizeof(agg_stats_window_t), 4)
+#define AGG_PAGE_RECORDS        ((FDS_VIRTUAL_PAGE_SIZE - FDS_PAGE_TAG_WORDS) / (FDS_REC_HEADER_WORDS + AGG_REC_WORDS))
+#define AGG_LOG_RECORDS         ((M_AGG_LOG_FLASH_PAGES - 1) * AGG_PAGE_RECORDS)
+
+// The swap page and the pages of the configuration store and the peer manager come on top
+STATIC_ASSERT(FDS_VIRTUAL_PAGES >= M_AGG_LOG_FLASH_PAGES + 3);
+
+/**@brief Log record not read yet.
+ */
+typedef struct
+{
+    uint32_t         record_id;
+    uint32_t const * p_record;                                          ///< Where it is in flash, NULL until located.
+} log_rec_t;
+
+static agg_stats_window_t       m_log_buf[M_AGG_LOG_BATCH];             ///< Windows being written, fds does not copy them.
+static bool volatile            m_log_write_pending = false;
+static bool volatile            m_log_retry = false;                    ///< A write or read was refused, the handler is called after the next fds event.
+static log_rec_t                m_log[AGG_LOG_RECORDS];                 ///< Ring of the records not read yet, by record ID from m_log_head.
+static uint16_t                 m_log_head = 0;
+static uint16_t                 m_log_count = 0;
+static uint16_t                 m_log_gc_run_count;                     ///< fds garbage collection count when the records were located.
+static bool                     m_log_loaded = false;                   ///< m_log was filled from flash, once fds is initialized.
+static bool volatile            m_log_relocate = false;                 ///< Garbage collection moved records since they were located.
+static m_agg_log_ready_handler_t m_ready_handler;
+
+/**@brief Function for handling flash data storage events.
+ */
+static void agg_log_fds_evt_handler(fds_evt_t const * p_fds_evt)
+{
+    switch (p_fds_evt->id)
+    {
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+            if (p_fds_evt->write.file_id != AGG_FILE_ID)
+            {
+                return;
+            }
+
+            if (p_fds_evt->result != FDS_SUCCESS)
+            {
+                NRF_LOG_ERROR("Aggregate log write failed - %d\r\n", p_fds_evt->result);
+
+                // Put last on the ring when it was queued, nothing else changes it while the write is pending
+                m_log_count--;
+            }
+
+            m_log_write_pending = false;
+            break;
+
+        case FDS_EVT_DEL_RECORD:
+            if (p_fds_evt->del.file_id != AGG_FILE_ID)
+            {
+                return;
+            }
+            break;
+
+        case FDS_EVT_GC:
+            m_log_relocate = true;
+            break;
+
+        default:
+            return;
+    }
+
+    if (m_log_retry)
+    {
+        m_log_retry = false;
+        m_ready_handler();
+    }
+}
+
+/**@brief Function for refusing an operation until the log is ready again.
+ */
+static uint32_t log_retry_later(uint32_t err_code)
+{
+    m_log_retry = true;
+
+    return err_code;
+}
+
+static log_rec_t * log_rec(uint16_t index)
+{
+    return &m_log[(m_log_head + index) % AGG_LOG_RECORDS];
+}
+
+static int log_rec_cmp(void const * p_a, void const * p_b)
+{
+    uint32_t a = ((log_rec_t const *)p_a)->record_id;
+    uint32_t b = ((log_rec_t const *)p_b)->record_id;
+
+    return (a > b) - (a < b);
+}
+
+/**@brief Function for filling the ring from flash, once, the only full search of the log.
+ */
+static void log_load(void)
+{
+    fds_record_desc_t desc;
+    fds_find_token_t  ftok;
+
+    if (m_log_loaded)
+    {
+        return;
+    }
+
+    memset(&ftok, 0x00, sizeof(fds_find_token_t));
+
+    while (fds_record_find(AGG_FILE_ID, AGG_REC_KEY, &desc, &ftok) == FDS_SUCCESS)
+    {
+        if (m_log_count == AGG_LOG_RECORDS)
+        {
+            // Only when the log was made smaller, those left are not read
+            NRF_LOG_WARNING("Aggregate log has more records than it keeps\r\n");
+            break;
+        }
+
+        m_log[m_log_count].record_id = desc.record_id;
+        m_log[m_log_count].p_record  = desc.p_record;
+        m_log_gc_run_count           = desc.gc_run_count;
+        m_log_count++;
+    }
+
+    // Found in page order, which garbage collection mixes
+    qsort(m_log, m_log_count, sizeof(log_rec_t), log_rec_cmp);
+
+    m_log_head   = 0;
+    m_log_loaded = true;
+}
+
+/**@brief Function for finding where the records are in flash, in one pass over the log.
+ */
+static void log_locate(void)
+{
+    fds_record_desc_t desc;
+    fds_find_token_t  ftok;
+
+    m_log_relocate = false;
+
+    for (uint16_t i = 0; i < m_log_count; i++)
+    {
+        log_rec(i)->p_record = NULL;
+    }
+
+    memset(&ftok, 0x00, sizeof(fds_find_token_t));
+
+    while (fds_record_find(AGG_FILE_ID, AGG_REC_KEY, &desc, &ftok) == FDS_SUCCESS)
+    {
+        uint16_t lo = 0;
+        uint16_t hi = m_log_count;
+
+        // The ring is ordered by record ID
+        while (lo < hi)
+        {
+            uint16_t mid = (lo + hi) / 2;
+
+            if (log_rec(mid)->record_id < desc.record_id)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+
+        if ((lo < m_log_count) && (log_rec(lo)->record_id == desc.record_id))
+        {
+            log_rec(lo)->p_record = desc.p_record;
+            m_log_gc_run_count    = desc.gc_run_count;
+        }
+    }
+}
+
+/**@brief Function for taking the oldest record off the ring, once its deletion is queued or it is gone.
+ */
+static void log_oldest_drop(void)
+{
+    m_log_head = (m_log_head + 1) % AGG_LOG_RECORDS;
+    m_log_count--;
+}
+
+/**@brief Function for getting the oldest log record not read yet.
+ *
+ * @param[out] p_desc     Descriptor of the oldest record.
+ *
+ * @retval true if there is one.
+ */
+static bool log_oldest_get(fds_record_desc_t * p_desc)
+{
+    log_load();
+
+    while (m_log_count > 0)
+    {
+        log_rec_t const * p_rec = log_rec(0);
+
+        // Records written since the last pass are located with the next one
+        if (m_log_relocate || (p_rec->p_record == NULL))
+        {
+            log_locate();
+        }
+
+        if (p_rec->p_record != NULL)
+        {
+            memset(p_desc, 0x00, sizeof(fds_record_desc_t));
+            p_desc->record_id    = p_rec->record_id;
+            p_desc->p_record     = p_rec->p_record;
+            p_desc->gc_run_count = m_log_gc_run_count;
+
+            return true;
+        }
+
+        // Not in flash, deleted outside the log
+        log_oldest_drop();
+    }
+
+    return false;
+}
+
+uint32_t m_agg_log_write(agg_stats_window_t const * p_windows, uint8_t count)
+{
+    fds_record_desc_t desc;
+    fds_record_t      record;
+    ret_code_t        rc;
+
+    VERIFY_PARAM_NOT_NULL(p_windows);
+
+    if ((count == 0) || (count > M_AGG_LOG_BATCH))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (m_log_write_pending)
+    {
+        return log_retry_later(NRF_ERROR_BUSY);
+    }
+
+    log_load();
+
+    if ((m_log_count >= AGG_LOG_RECORDS) && log_oldest_get(&desc))
+    {
+        rc = fds_record_delete(&desc);
+        if (rc == FDS_ERR_NO_SPACE_IN_QUEUES)
+        {
+            return log_retry_later(NRF_ERROR_BUSY);
+        }
+        APP_ERROR_CHECK(rc);
+
+        NRF_LOG_WARNING("Aggregate log full, dropped the oldest record\r\n");
+
+        log_oldest_drop();
+    }
+
+    memcpy(m_log_buf, p_windows, count * sizeof(agg_stats_window_t));
+
+    record.data.p_data       = m_log_buf;
+    record.data.length_words = CEIL_DIV(count * sizeof(agg_stats_window_t), 4);
+    record.file_id           = AGG_FILE_ID;
+    record.key               = AGG_REC_KEY;
+
+    rc = fds_record_write(&desc, &record);
+    if (rc == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        // Deleted records are only reclaimed by garbage collection, the write may fit after it
+        m_config_store_gc_request();
+
+        return log_retry_later(NRF_ERROR_NO_MEM);
+    }
+    if (rc == FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        return log_retry_later(NRF_ERROR_BUSY);
+    }
+    APP_ERROR_CHECK(rc);
+
+    m_log_write_pending = true;
+
+    // Record IDs only grow, the ring stays in order
+    log_rec(m_log_count)->record_id = desc.record_id;
+    log_rec(m_log_count)->p_record  = NULL;
+    m_log_count++;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t m_agg_log_read(agg_stats_window_t * p_windows, uint8_t * p_count)
+{
+    fds_record_desc_t  desc;
+    fds_flash_record_t flash_record;
+    uint8_t            count;
+    ret_code_t         rc;
+
+    VERIFY_PARAM_NOT_NULL(p_windows);
+    VERIFY_PARAM_NOT_NULL(p_count);
+
+    if (m_log_write_pending)
+    {
+        // Not found yet, but older than anything written after it
+        return log_retry_later(NRF_ERROR_BUSY);
+    }
+
+    if (!log_oldest_get(&desc))
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    rc = fds_record_open(&desc, &flash_record);
+    APP_ERROR_CHECK(rc);
+
+    count = MIN(flash_record.p_header->length_words * 4 / sizeof(agg_stats_window_t), M_AGG_LOG_BATCH);
+    memcpy(p_windows, flash_record.p_data, count * sizeof(agg_stats_window_t));
+
+    rc = fds_record_close(&desc);
+    APP_ERROR_CHECK(rc);
+
+    // Read again once the deletion can be queued, a deleted record cannot be opened
+    rc = fds_record_delete(&desc);
+    if (rc == FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        return log_retry_later(NRF_ERROR_BUSY);
+    }
+    APP_ERROR_CHECK(rc);
+
+    log_oldest_drop();
+    *p_count = count;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t m_agg_log_init(m_agg_log_ready_handler_t handler)
+{
+    VERIFY_PARAM_NOT_NULL(handler);
+
+    m_ready_handler = handler;
+
+    return fds_register(agg_log_fds_evt_handler);
+}
@@ -1,10 +1,10 @@
 #include "m_batt_meas.h"
 #include "sdk_config.h"
 #include "nrf_drv_saadc.h"
-#include "app_timer.h"
+#include "sample_sched.h"
 #include "math.h"
 #include "nrf_gpio.h"
-#include "app_scheduler.h"
+#include "prio_sched.h"
 #include "nrf_drv_gpiote.h"
 #include "nrf_log.h"
 #include "ble_bas.h"
@@ -28,7 +28,7 @@ static uint8_t                      m_initial_batt_level_percent = INVALID_BATTE
 
 /** @brief Timer for periodic battery measurement.
  */
-APP_TIMER_DEF(batt_meas_app_timer_id);
+SAMPLE_SCHED_DEF(batt_meas_action);
 
 /** @brief Converts ADC gain register values to actual gain.
  */
@@ -247,7 +247,7 @@ static void saadc_event_handler_interrupt(nrf_drv_saadc_evt_t const * const p_ev
         err_code = adc_to_batt_voltage(*p_event->data.done.p_buffer, &voltage);
         APP_ERROR_CHECK(err_code);
 
-        err_code = app_sched_event_put((void*)&voltage, sizeof(voltage), batt_event_handler_adc);
+        err_code = prio_sched_event_put((void*)&voltage, sizeof(voltage), batt_event_handler_adc, PRIO_SCHED_LOW);
         APP_ERROR_CHECK(err_code);
     }
 
@@ -307,7 +307,7 @@ static uint32_t saadc_calibrate(void)
 
 /** @brief Periodic timer handler.
  */
-static void app_timer_periodic_handler(void * unused)
+static void batt_meas_periodic_handler(void * unused)
 {
     uint32_t err_code;
 
@@ -371,15 +371,15 @@ uint32_t m_batt_meas_enable(uint32_t meas_interval_ms)
     }
 
     // Call for a battery voltage sample immediately after enabling battery measurements.
-    app_timer_periodic_handler(NULL);
+    batt_meas_periodic_handler(NULL);
 
-    err_code = app_timer_create(&batt_meas_app_timer_id,
-                                APP_TIMER_MODE_REPEATED,
-                                app_timer_periodic_handler);
+    err_code = sample_sched_create(&batt_meas_action, batt_meas_periodic_handler);
     APP_ERROR_CHECK(err_code);
 
-    err_code = app_timer_start(batt_meas_app_timer_id,
-                               APP_TIMER_TICKS(meas_interval_ms), NULL);
+    err_code = sample_sched_start(&batt_meas_action,
+                                  SAMPLE_SCHED_TICKS(meas_interval_ms),
+                                  SAMPLE_SCHED_TICKS(meas_interval_ms),
+                                  NULL);
     APP_ERROR_CHECK(err_code);
 
     return M_BATT_STATUS_CODE_SUCCESS;
@@ -388,15 +388,12 @@ uint32_t m_batt_meas_enable(uint32_t meas_interval_ms)
 
 uint32_t m_batt_meas_disable(void)
 {
-    uint32_t err_code;
-
     if (m_batt_meas_param.batt_mon_en_pin_used)
     {
         nrf_drv_gpiote_out_clear(m_batt_meas_param.batt_mon_en_pin_no);     // Disable battery monitoring to save power.
     }
 
-    err_code = app_timer_stop(batt_meas_app_timer_id);
-    APP_ERROR_CHECK(err_code);
+    sample_sched_stop(&batt_meas_action);
 
     return M_BATT_STATUS_CODE_SUCCESS;
 }
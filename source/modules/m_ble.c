@@ -1,8 +1,11 @@
 #include "m_ble.h"
 #include "m_board.h"
-#include "m_ble_flash.h"
+#include "m_config_store.h"
+#include "m_conn_policy.h"
+#include "m_l2cap.h"
 #include "ble_dcs.h"
 #include "ble_dds.h"
+#include "tlog.h"
 
 #define APP_BLE_OBSERVER_PRIO           3                                           /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 #define APP_BLE_CONN_CFG_TAG            1                                           /**< A tag identifying the SoftDevice BLE configuration. */
@@ -12,8 +15,18 @@
 #define MAX_CONN_PARAMS_UPDATE_COUNT    3                                           /**< Number of attempts before giving up the connection parameter negotiation. */
 
 #define MANUFACTURER_NAME               "Detect Labs"                               /**< Manufacturer. Will be passed to Device Information Service. */
-#define APP_ADV_INTERVAL                300                                         /**< The advertising interval (in units of 0.625 ms. This value corresponds to 187.5 ms). */
-#define APP_ADV_DURATION                18000                                       /**< The advertising duration (180 seconds) in units of 10 milliseconds. */
+#define APP_ADV_SLOW_INTERVAL           MSEC_TO_UNITS(1000, UNIT_0_625_MS)          /**< Advertising interval once the stored advertising timeout has passed (1 second). */
+#define APP_ADV_SLOW_DURATION           60000                                       /**< Slow advertising duration (10 minutes) in units of 10 milliseconds. */
+#define APP_ADV_VERY_SLOW_INTERVAL      MSEC_TO_UNITS(5000, UNIT_0_625_MS)          /**< Advertising interval after slow advertising, until a connection or motion (5 seconds). */
+
+#ifndef BROADCAST_COMPANY_ID
+#define BROADCAST_COMPANY_ID            0xFFFF                                      /**< Company identifier of the occupancy manufacturer specific data, set by the Makefile. 0xFFFF is the SIG's test value. */
+#endif
+#define BROADCAST_VERSION               1                                           /**< Layout of broadcast_data_t. */
+#define BROADCAST_FLAG_OCCUPIED         0x01                                        /**< A motion session is in progress. */
+#define BROADCAST_BATTERY_UNKNOWN       0xFF                                        /**< Battery level until the first measurement. */
+#define BROADCAST_SESSIONS              4                                           /**< Last sessions in extended advertising, it has no scan response to share with the name and UUID. */
+#define BROADCAST_DURATION_MAX_S        UINT8_MAX                                   /**< Longer sessions are reported at this. */
 
 #define MIN_CONN_INTERVAL               MSEC_TO_UNITS(100, UNIT_1_25_MS)            /**< Minimum acceptable connection interval (0.1 seconds). */
 #define MAX_CONN_INTERVAL               MSEC_TO_UNITS(200, UNIT_1_25_MS)            /**< Maximum acceptable connection interval (0.2 second). */
@@ -30,10 +43,11 @@
 #define SEC_PARAM_MAX_KEY_SIZE          16                                          /**< Maximum encryption key size. */
 
 NRF_BLE_GATT_DEF(m_gatt);                                                           /**< GATT module instance. */
-NRF_BLE_QWR_DEF(m_qwr);                                                             /**< Context for the Queued Write module.*/
+NRF_BLE_QWRS_DEF(m_qwr, NRF_SDH_BLE_PERIPHERAL_LINK_COUNT);                         /**< Context for the Queued Write module, one per connection.*/
 
 static ble_dcs_t                  m_dcs;
-static ble_dcs_params_t         * m_ble_config;
+static ble_dcs_params_t           m_ble_config_buf;
+static ble_dcs_params_t         * m_ble_config = &m_ble_config_buf;
 static const ble_dcs_params_t     m_ble_default_config = DETECT_CONFIG_DEFAULT;
 
 static m_ble_evt_handler_t        m_evt_handler = 0;
@@ -41,11 +55,55 @@ static m_ble_service_handle_t   * m_service_handles = 0;
 static uint32_t                   m_service_num = 0;
 static bool                       m_major_minor_fw_ver_changed = false;
 static ble_advertising_t * p_m_advertising;
-static uint16_t * p_m_conn_handle;
+static uint16_t * p_m_conn_handle;                                                   ///< Most recent connection still open.
 
 // YOUR_JOB: Use UUIDs for service(s) used in your application.
 static ble_uuid_t m_adv_uuids[] = {{BLE_UUID_DCS_SERVICE, BLE_UUID_TYPE_VENDOR_BEGIN}};
 
+/**@brief Occupancy broadcast, manufacturer specific advertising data after the company identifier.
+ */
+typedef PACKED( struct
+{
+    uint8_t  version;           ///< BROADCAST_VERSION.
+    uint8_t  flags;             ///< BROADCAST_FLAG_ bits.
+    uint8_t  battery;           ///< Battery level, %.
+    uint8_t  seq;               ///< Incremented on every occupancy or count change, so observers can tell they missed one.
+    uint8_t  direction;         ///< Last session, as in ble_dds_count_t.
+    uint16_t enter;             ///< Sessions classified as entering since boot.
+    uint16_t exit;              ///< Sessions classified as exiting since boot.
+}) broadcast_data_t;
+
+/**@brief One past motion session in the extended broadcast.
+ */
+typedef PACKED( struct
+{
+    uint8_t  seq;               ///< broadcast_data_t::seq when the session ended.
+    uint8_t  direction;         ///< As in ble_dds_count_t.
+    uint8_t  duration_s;        ///< Session length, saturates at BROADCAST_DURATION_MAX_S.
+}) broadcast_session_t;
+
+static ble_dds_broadcast_t m_broadcast_config = {.mode = BLE_DDS_BROADCAST_OFF};
+static broadcast_data_t    m_broadcast = {.version = BROADCAST_VERSION, .battery = BROADCAST_BATTERY_UNKNOWN};
+static broadcast_session_t m_broadcast_sessions[BROADCAST_SESSIONS];                ///< Newest first, 0 seq for none yet.
+static uint8_t             m_broadcast_buf[sizeof(broadcast_data_t) + sizeof(m_broadcast_sessions)];  ///< Manufacturer specific data being encoded.
+static volatile bool    m_advertising_active = false;                              ///< The SoftDevice is using the advertising buffers.
+static uint8_t          m_enc_advdata[2][BLE_GAP_ADV_SET_DATA_SIZE_MAX];            ///< Advertising data, one pair in use, the other one for the next update.
+static uint8_t          m_enc_srdata[2][BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+static uint8_t          m_enc_idx = 0;
+
+/**@brief Advertising back-off stages, from the stored advertising parameters down to the very slow interval.
+ */
+typedef enum
+{
+    ADV_STAGE_FAST,
+    ADV_STAGE_SLOW,
+    ADV_STAGE_VERY_SLOW,
+} adv_stage_t;
+
+static adv_stage_t      m_adv_stage = ADV_STAGE_FAST;
+
+static void adv_modes_fill(ble_adv_modes_config_t * p_config);
+
 /**@brief Function for handling the YYY Service events.
  * YOUR_JOB implement a service handler function depending on the event the service you are using can generate
  *
@@ -103,20 +161,58 @@ static void gatt_init(void)
  */
 static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 {
-    uint32_t err_code;
+    uint32_t               err_code;
+    ble_adv_modes_config_t modes;
 
     switch (ble_adv_evt)
     {
         case BLE_ADV_EVT_FAST:
             NRF_LOG_INFO("on_adv_evt: BLE_ADV_EVT_FAST\r\n");
-            err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
-            APP_ERROR_CHECK(err_code);
+            m_advertising_active = true;
+            if (m_adv_stage != ADV_STAGE_FAST)
+            {
+                // Back off through the slow interval again once this times out
+                m_adv_stage = ADV_STAGE_FAST;
+                adv_modes_fill(&modes);
+                ble_advertising_modes_config_set(p_m_advertising, &modes);
+            }
+            if (ble_conn_state_peripheral_conn_count() == 0)
+            {
+                err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case BLE_ADV_EVT_SLOW:
+            NRF_LOG_INFO("on_adv_evt: BLE_ADV_EVT_SLOW\r\n");
+            m_advertising_active = true;
+            if (m_adv_stage == ADV_STAGE_FAST)
+            {
+                m_adv_stage = ADV_STAGE_SLOW;
+            }
+            if (ble_conn_state_peripheral_conn_count() == 0)
+            {
+                err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING_SLOW);
+                APP_ERROR_CHECK(err_code);
+            }
             break;
 
         case BLE_ADV_EVT_IDLE:
             NRF_LOG_INFO("on_adv_evt: BLE_ADV_EVT_IDLE\r\n");
-            NRF_LOG_INFO("************* ENTERING SLEEP MODE *****************\r\n");
-            m_board_sleep_mode_enter();
+            m_advertising_active = false;
+            if ((ble_conn_state_peripheral_conn_count() > 0) || (m_adv_stage == ADV_STAGE_VERY_SLOW))
+            {
+                // Only stopped looking for another central
+                break;
+            }
+
+            // A gateway may come back any time, keep advertising at the very slow interval instead of sleeping
+            m_adv_stage = ADV_STAGE_VERY_SLOW;
+            adv_modes_fill(&modes);
+            ble_advertising_modes_config_set(p_m_advertising, &modes);
+
+            err_code = ble_advertising_start(p_m_advertising, BLE_ADV_MODE_SLOW);
+            APP_ERROR_CHECK(err_code);
             break;
 
         default:
@@ -125,24 +221,270 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 }
 
 
+/**@brief Function for filling in the advertising and scan response data.
+ *
+ * @details Broadcasting, the advertising packet holds the occupancy for observers that do not scan
+ *          actively. In legacy advertising the service UUID and appearance move to the scan
+ *          response to make room. Extended advertising has no scan response here, the last
+ *          sessions take the place of the name and UUID.
+ */
+static void advdata_fill(ble_advdata_t * p_advdata, ble_advdata_t * p_srdata, ble_advdata_manuf_data_t * p_manuf)
+{
+    uint16_t len = sizeof(m_broadcast);
+
+    memset(p_advdata, 0, sizeof(ble_advdata_t));
+    memset(p_srdata, 0, sizeof(ble_advdata_t));
+
+    p_advdata->flags = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+
+    if (m_broadcast_config.mode == BLE_DDS_BROADCAST_OFF)
+    {
+        p_advdata->name_type               = BLE_ADVDATA_FULL_NAME;
+        p_advdata->include_appearance      = true;
+        p_advdata->uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
+        p_advdata->uuids_complete.p_uuids  = m_adv_uuids;
+        return;
+    }
+
+    memcpy(m_broadcast_buf, &m_broadcast, sizeof(m_broadcast));
+
+    if (m_broadcast_config.mode == BLE_DDS_BROADCAST_EXTENDED)
+    {
+        p_advdata->name_type = BLE_ADVDATA_NO_NAME;
+
+        memcpy(&m_broadcast_buf[len], m_broadcast_sessions, sizeof(m_broadcast_sessions));
+        len += sizeof(m_broadcast_sessions);
+    }
+    else
+    {
+        p_advdata->name_type = BLE_ADVDATA_FULL_NAME;
+
+        p_srdata->include_appearance      = true;
+        p_srdata->uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
+        p_srdata->uuids_complete.p_uuids  = m_adv_uuids;
+    }
+
+    p_manuf->company_identifier = BROADCAST_COMPANY_ID;
+    p_manuf->data.p_data        = m_broadcast_buf;
+    p_manuf->data.size          = len;
+
+    p_advdata->p_manuf_specific_data = p_manuf;
+}
+
+/**@brief Function for filling in the advertising modes.
+ *
+ * @details Advertising starts with the stored interval and, once the stored timeout has passed,
+ *          backs off to the slow and then the very slow interval. A timeout of 0 keeps the stored
+ *          interval. Observers come and go, so broadcasting does not time out. Extended advertising only
+ *          puts a short pointer on the primary channels and the data on a secondary channel at
+ *          2 Mbps, which keeps the air free in rooms with many sensors.
+ */
+static void adv_modes_fill(ble_adv_modes_config_t * p_config)
+{
+    memset(p_config, 0, sizeof(ble_adv_modes_config_t));
+
+    // Restarted by m_ble once a link is free, whichever central disconnects
+    p_config->ble_adv_on_disconnect_disabled = true;
+
+    p_config->ble_adv_fast_enabled  = true;
+    p_config->ble_adv_fast_interval = m_ble_config->adv_params.interval;
+    p_config->ble_adv_fast_timeout  = m_ble_config->adv_params.timeout * 100;
+
+    if (m_broadcast_config.mode == BLE_DDS_BROADCAST_OFF)
+    {
+        p_config->ble_adv_slow_enabled  = true;
+        p_config->ble_adv_slow_interval = (m_adv_stage == ADV_STAGE_VERY_SLOW) ? APP_ADV_VERY_SLOW_INTERVAL :
+                                                                                 APP_ADV_SLOW_INTERVAL;
+        p_config->ble_adv_slow_timeout  = (m_adv_stage == ADV_STAGE_VERY_SLOW) ? 0 : APP_ADV_SLOW_DURATION;
+        return;
+    }
+
+    p_config->ble_adv_fast_interval = MSEC_TO_UNITS(m_broadcast_config.interval_ms, UNIT_0_625_MS);
+    p_config->ble_adv_fast_timeout  = 0;
+
+    if (m_broadcast_config.mode == BLE_DDS_BROADCAST_EXTENDED)
+    {
+        p_config->ble_adv_extended_enabled = true;
+        p_config->ble_adv_primary_phy      = BLE_GAP_PHY_1MBPS;
+        p_config->ble_adv_secondary_phy    = BLE_GAP_PHY_2MBPS;
+    }
+}
+
+/**@brief Function for encoding the advertising data again and handing it to the SoftDevice.
+ *
+ * @details The SoftDevice only takes new data while advertising if it comes in other buffers, so
+ *          the two pairs of buffers take turns.
+ */
+static uint32_t advdata_update(void)
+{
+    uint32_t                 err_code;
+    ble_advdata_t            advdata;
+    ble_advdata_t            srdata;
+    ble_advdata_manuf_data_t manuf;
+    ble_gap_adv_data_t     * p_adv_data;
+
+    if ((p_m_advertising == NULL) || !p_m_advertising->initialized)
+    {
+        // Picked up by advertising_init
+        return NRF_SUCCESS;
+    }
+
+    advdata_fill(&advdata, &srdata, &manuf);
+
+    m_enc_idx ^= 1;
+
+    p_adv_data = &p_m_advertising->adv_data;
+
+    p_adv_data->adv_data.p_data      = m_enc_advdata[m_enc_idx];
+    p_adv_data->adv_data.len         = BLE_GAP_ADV_SET_DATA_SIZE_MAX;
+    p_adv_data->scan_rsp_data.p_data = m_enc_srdata[m_enc_idx];
+    p_adv_data->scan_rsp_data.len    = BLE_GAP_ADV_SET_DATA_SIZE_MAX;
+
+    err_code = ble_advdata_encode(&advdata, p_adv_data->adv_data.p_data, &p_adv_data->adv_data.len);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = ble_advdata_encode(&srdata, p_adv_data->scan_rsp_data.p_data, &p_adv_data->scan_rsp_data.len);
+    VERIFY_SUCCESS(err_code);
+
+    if (p_adv_data->scan_rsp_data.len == 0)
+    {
+        p_adv_data->scan_rsp_data.p_data = NULL;
+    }
+
+    if (!m_advertising_active)
+    {
+        // Configured with the advertising parameters when advertising starts
+        return NRF_SUCCESS;
+    }
+
+    return sd_ble_gap_adv_set_configure(&p_m_advertising->adv_handle, p_adv_data, NULL);
+}
+
+/**@brief Function for applying the advertising modes and data again, back in the fast stage if advertising.
+ */
+static uint32_t adv_restart(void)
+{
+    uint32_t               err_code;
+    ble_adv_modes_config_t modes;
+    bool                   restart = m_advertising_active;
+
+    if ((p_m_advertising == NULL) || !p_m_advertising->initialized)
+    {
+        // Picked up by advertising_init
+        return NRF_SUCCESS;
+    }
+
+    m_adv_stage = ADV_STAGE_FAST;
+
+    adv_modes_fill(&modes);
+    ble_advertising_modes_config_set(p_m_advertising, &modes);
+
+    if (restart)
+    {
+        // The advertising type and interval only change when advertising starts
+        (void)sd_ble_gap_adv_stop(p_m_advertising->adv_handle);
+        m_advertising_active = false;
+    }
+
+    err_code = advdata_update();
+    VERIFY_SUCCESS(err_code);
+
+    return restart ? ble_advertising_start(p_m_advertising, BLE_ADV_MODE_FAST) : NRF_SUCCESS;
+}
+
+uint32_t m_ble_broadcast_config_set(ble_dds_broadcast_t const * p_config)
+{
+    VERIFY_PARAM_NOT_NULL(p_config);
+
+    if (memcmp(p_config, &m_broadcast_config, sizeof(ble_dds_broadcast_t)) == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_broadcast_config = *p_config;
+
+    return adv_restart();
+}
+
+uint32_t m_ble_advertising_boost(void)
+{
+    if (!m_advertising_active || (m_adv_stage == ADV_STAGE_FAST))
+    {
+        // Connected to every central it takes, or already fast
+        return NRF_SUCCESS;
+    }
+
+    NRF_LOG_INFO("Advertising boosted\r\n");
+
+    return adv_restart();
+}
+
+uint32_t m_ble_broadcast_occupancy_set(bool occupied, ble_dds_count_t const * p_count)
+{
+    uint8_t flags = occupied ? BROADCAST_FLAG_OCCUPIED : 0;
+
+    VERIFY_PARAM_NOT_NULL(p_count);
+
+    if ((m_broadcast.flags     == flags)              &&
+        (m_broadcast.direction == p_count->direction) &&
+        (m_broadcast.enter     == p_count->enter)     &&
+        (m_broadcast.exit      == p_count->exit))
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_broadcast.flags     = flags;
+    m_broadcast.direction = p_count->direction;
+    m_broadcast.enter     = p_count->enter;
+    m_broadcast.exit      = p_count->exit;
+    m_broadcast.seq++;
+
+    return (m_broadcast_config.mode != BLE_DDS_BROADCAST_OFF) ? advdata_update() : NRF_SUCCESS;
+}
+
+uint32_t m_ble_broadcast_session_add(ble_dds_count_t const * p_count, uint32_t duration_ms)
+{
+    VERIFY_PARAM_NOT_NULL(p_count);
+
+    memmove(&m_broadcast_sessions[1], &m_broadcast_sessions[0], sizeof(m_broadcast_sessions) - sizeof(broadcast_session_t));
+
+    m_broadcast.flags     = 0;
+    m_broadcast.direction = p_count->direction;
+    m_broadcast.enter     = p_count->enter;
+    m_broadcast.exit      = p_count->exit;
+    m_broadcast.seq++;
+
+    m_broadcast_sessions[0].seq        = m_broadcast.seq;
+    m_broadcast_sessions[0].direction  = p_count->direction;
+    m_broadcast_sessions[0].duration_s = MIN(duration_ms / 1000, BROADCAST_DURATION_MAX_S);
+
+    return (m_broadcast_config.mode != BLE_DDS_BROADCAST_OFF) ? advdata_update() : NRF_SUCCESS;
+}
+
+uint32_t m_ble_broadcast_battery_set(uint8_t level_percent)
+{
+    if (m_broadcast.battery == level_percent)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_broadcast.battery = level_percent;
+
+    return (m_broadcast_config.mode != BLE_DDS_BROADCAST_OFF) ? advdata_update() : NRF_SUCCESS;
+}
+
 /**@brief Function for initializing the Advertising functionality.
  */
 static void advertising_init(void)
 {
-    uint32_t               err_code;
-    ble_advertising_init_t init; 
+    uint32_t                 err_code;
+    ble_advertising_init_t   init;
+    ble_advdata_manuf_data_t manuf;
 
     memset(&init, 0, sizeof(init));
 
-    init.advdata.name_type               = BLE_ADVDATA_FULL_NAME;
-    init.advdata.include_appearance      = true;
-    init.advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
-    init.advdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
-    init.advdata.uuids_complete.p_uuids  = m_adv_uuids;
-
-    init.config.ble_adv_fast_enabled  = true;
-    init.config.ble_adv_fast_interval = APP_ADV_INTERVAL;
-    init.config.ble_adv_fast_timeout  = APP_ADV_DURATION;
+    advdata_fill(&init.advdata, &init.srdata, &manuf);
+    adv_modes_fill(&init.config);
 
     init.evt_handler = on_adv_evt;
 
@@ -188,8 +530,6 @@ uint32_t m_sd_ble_gap_disconnect(void)
  */
 static void pm_evt_handler(pm_evt_t const * p_evt)
 {
-    ret_code_t err_code;
-
     switch (p_evt->evt_id)
     {
         case PM_EVT_BONDED_PEER_CONNECTED:
@@ -224,16 +564,8 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
 
         case PM_EVT_STORAGE_FULL:
         {
-            // Run garbage collection on the flash.
-            err_code = fds_gc();
-            if (err_code == FDS_ERR_NO_SPACE_IN_QUEUES)
-            {
-                // Retry.
-            }
-            else
-            {
-                APP_ERROR_CHECK(err_code);
-            }
+            // Garbage is collected from the main loop, outside of sessions
+            m_config_store_gc_request();
         } break;
 
         case PM_EVT_PEERS_DELETE_SUCCEEDED:
@@ -313,6 +645,19 @@ static void peer_manager_init()
 }
 
 
+/**@brief Function for storing the configuration, copied to m_ble_config first if it is another one.
+ */
+static uint32_t ble_config_store(ble_dcs_params_t const * p_config)
+{
+    if (p_config != m_ble_config)
+    {
+        *m_ble_config = *p_config;
+    }
+
+    return m_config_store_set(M_CONFIG_STORE_TAG_BLE, m_ble_config, sizeof(ble_dcs_params_t));
+}
+
+
 /**@brief Function for the GAP initialization.
  *
  * @details This function sets up all the necessary GAP (Generic Access Profile) parameters of the
@@ -352,7 +697,7 @@ uint32_t gap_params_init(void)
         m_ble_config->conn_params.slave_latency = SLAVE_LATENCY;
         m_ble_config->conn_params.sup_timeout   = MSEC_TO_UNITS(CONN_SUP_TIMEOUT_MS, UNIT_10_MS);
 
-        err_code = m_ble_flash_config_store(m_ble_config);
+        err_code = ble_config_store(m_ble_config);
         if (err_code != NRF_SUCCESS)
         {
             return err_code;
@@ -439,7 +784,8 @@ static void dcs_evt_handler (ble_dcs_t        * p_dcs,
                              uint8_t  const   * p_data,
                              uint16_t           length)
 {
-    bool update_flash = false;
+    uint32_t err_code;
+    bool     update_flash = false;
 
     //NRF_LOG_INFO("dcs_evt_handler:  %d.",evt_type);
     switch (evt_type)
@@ -458,13 +804,16 @@ static void dcs_evt_handler (ble_dcs_t        * p_dcs,
             {
                 memcpy(&m_ble_config->adv_params, p_data, length);
 
+                // Applied right away if advertising for another central, otherwise when advertising starts
+                err_code = adv_restart();
+                APP_ERROR_CHECK(err_code);
+
                 update_flash = true;
             }
             break;
         case BLE_DCS_EVT_CONN_PARAM:
             if (length == sizeof(ble_dcs_conn_params_t))
             {
-                uint32_t              err_code;
                 ble_gap_conn_params_t gap_conn_params;
 
                 memcpy(&m_ble_config->conn_params, p_data, length);
@@ -475,19 +824,27 @@ static void dcs_evt_handler (ble_dcs_t        * p_dcs,
                 gap_conn_params.slave_latency     = m_ble_config->conn_params.slave_latency;
                 gap_conn_params.conn_sup_timeout  = m_ble_config->conn_params.sup_timeout;
 
-                err_code = ble_conn_params_change_conn_params(*p_m_conn_handle, &gap_conn_params);
+                // The peer knows best for this connection
+                m_conn_policy_override(m_dcs.conn_handle);
+
+                err_code = ble_conn_params_change_conn_params(m_dcs.conn_handle, &gap_conn_params);
                 APP_ERROR_CHECK(err_code);
 
                 update_flash = true;
             }
             break;
+        case BLE_DCS_EVT_LOG_FILTER:
+            // A debug setting, back to defaults on reset
+            for (uint16_t i = 0; (i < length) && (i < TLOG_MODULE_COUNT); i++)
+            {
+                tlog_filter_set((tlog_module_t)i, p_data[i]);
+            }
+            break;
     }
 
     if (update_flash)
     {
-        uint32_t err_code;
-
-        err_code = m_ble_flash_config_store(m_ble_config);
+        err_code = ble_config_store(m_ble_config);
         APP_ERROR_CHECK(err_code);
     }
 }
@@ -521,7 +878,7 @@ static uint32_t detect_config_verify(void)
             update_flash = false;
             m_major_minor_fw_ver_changed = true;
             
-            err_code = m_ble_flash_config_store(&m_ble_default_config);
+            err_code = ble_config_store(&m_ble_default_config);
             APP_ERROR_CHECK(err_code);
         }
     }
@@ -537,7 +894,7 @@ static uint32_t detect_config_verify(void)
 
     if (update_flash)
     {
-        err_code = m_ble_flash_config_store(m_ble_config);
+        err_code = ble_config_store(m_ble_config);
         APP_ERROR_CHECK(err_code);
     }
     
@@ -554,12 +911,16 @@ static uint32_t services_init(m_ble_service_handle_t * p_service_handles, uint32
     ble_dfu_buttonless_init_t dfus_init = {0};
 
     ble_dcs_init_t            dcs_init  = {0};
+    uint8_t                   log_filter[TLOG_MODULE_COUNT];
 
     // Initialize Queued Write Module.
     qwr_init.error_handler = nrf_qwr_error_handler;
 
-    err_code = nrf_ble_qwr_init(&m_qwr, &qwr_init);
-    APP_ERROR_CHECK(err_code);
+    for (uint32_t i = 0; i < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT; i++)
+    {
+        err_code = nrf_ble_qwr_init(&m_qwr[i], &qwr_init);
+        APP_ERROR_CHECK(err_code);
+    }
 
     // Initialize the async SVCI interface to bootloader.
     //COMMENT THIS SERVICE OUT TO BYPASS BOOTLOADER
@@ -575,6 +936,14 @@ static uint32_t services_init(m_ble_service_handle_t * p_service_handles, uint32
 
     dcs_init.p_init_vals = m_ble_config;
 
+    for (uint8_t i = 0; i < TLOG_MODULE_COUNT; i++)
+    {
+        log_filter[i] = tlog_filter_get((tlog_module_t)i);
+    }
+
+    dcs_init.p_init_log_filter = log_filter;
+    dcs_init.log_filter_len    = TLOG_MODULE_COUNT;
+
     dcs_init.evt_handler = dcs_evt_handler;
 
     err_code = ble_dcs_init(&m_dcs, &dcs_init);
@@ -653,9 +1022,9 @@ static void on_conn_params_evt(ble_conn_params_evt_t * p_evt)
 {
     uint32_t err_code;
 
-    if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED)
+    if ((p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED) && !m_conn_policy_negotiation_failed(p_evt->conn_handle))
     {
-        err_code = sd_ble_gap_disconnect(*p_m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
+        err_code = sd_ble_gap_disconnect(p_evt->conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
         APP_ERROR_CHECK(err_code);
     }
 }
@@ -697,6 +1066,10 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
 
     ble_dcs_on_ble_evt(&m_dcs, p_ble_evt);
 
+    m_conn_policy_on_ble_evt(p_ble_evt);
+
+    m_l2cap_on_ble_evt(p_ble_evt);
+
     for (uint32_t i = 0; i < m_service_num; i++)
     {
         if (m_service_handles[i].ble_evt_cb != NULL)
@@ -708,15 +1081,51 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GAP_EVT_DISCONNECTED:
-            // LED indication will be changed when advertising starts.
+            if (*p_m_conn_handle == p_ble_evt->evt.gap_evt.conn_handle)
+            {
+                ble_conn_state_conn_handle_list_t handles = ble_conn_state_periph_handles();
+
+                *p_m_conn_handle = (handles.len > 0) ? handles.conn_handles[handles.len - 1] :
+                                                       BLE_CONN_HANDLE_INVALID;
+            }
+
+            if (!m_advertising_active)
+            {
+                // LED indication will be changed when advertising starts.
+                err_code = ble_advertising_start(p_m_advertising, BLE_ADV_MODE_FAST);
+                APP_ERROR_CHECK(err_code);
+            }
+            else if (ble_conn_state_peripheral_conn_count() == 0)
+            {
+                err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
+                APP_ERROR_CHECK(err_code);
+            }
             break;
 
         case BLE_GAP_EVT_CONNECTED:
+            // Connectable advertising stops once connected
+            m_advertising_active = false;
+
             err_code = bsp_indication_set(BSP_INDICATE_CONNECTED);
             APP_ERROR_CHECK(err_code);
             *p_m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
-            err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, *p_m_conn_handle);
-            APP_ERROR_CHECK(err_code);
+
+            for (uint32_t i = 0; i < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT; i++)
+            {
+                if (m_qwr[i].conn_handle == BLE_CONN_HANDLE_INVALID)
+                {
+                    err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr[i], *p_m_conn_handle);
+                    APP_ERROR_CHECK(err_code);
+                    break;
+                }
+            }
+
+            if (ble_conn_state_peripheral_conn_count() < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+            {
+                // Room for another central
+                err_code = ble_advertising_start(p_m_advertising, BLE_ADV_MODE_FAST);
+                APP_ERROR_CHECK(err_code);
+            }
             break;
 
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
@@ -771,6 +1180,10 @@ static void ble_stack_init(void)
     err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // Bulk transfer channel.
+    err_code = m_l2cap_cfg_set(APP_BLE_CONN_CFG_TAG, ram_start);
+    APP_ERROR_CHECK(err_code);
+
     // Enable BLE stack.
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
@@ -792,15 +1205,19 @@ uint32_t m_ble_init(m_ble_init_t * p_params, uint16_t * _m_conn_handle, ble_adve
     
     ble_stack_init();
 
-    /**@brief Load configuration from flash. */
-    err_code = m_ble_flash_init(&m_ble_default_config, &m_ble_config);
-
-     if (err_code != NRF_SUCCESS)
+    err_code = m_config_store_init();
+    if (err_code != NRF_SUCCESS)
     {
-        NRF_LOG_ERROR(" m_ble_flash_init failed - %d\r\n", err_code);
+        NRF_LOG_ERROR("m_config_store_init failed - %d\r\n", err_code);
         return err_code;
     }
 
+    /**@brief Load configuration from flash. */
+    if (m_config_store_load(M_CONFIG_STORE_TAG_BLE, m_ble_config, sizeof(ble_dcs_params_t)) != NRF_SUCCESS)
+    {
+        *m_ble_config = m_ble_default_config;
+    }
+
     err_code = detect_config_verify();
 
     if (err_code != NRF_SUCCESS)
@@ -826,5 +1243,12 @@ uint32_t m_ble_init(m_ble_init_t * p_params, uint16_t * _m_conn_handle, ble_adve
 
     conn_params_init();
 
+    err_code = m_conn_policy_init();
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_ERROR("m_conn_policy_init failed - %d\r\n", err_code);
+        return err_code;
+    }
+
     return NRF_SUCCESS;
 }
@@ -0,0 +1,595 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "m_config_store.h"
+#include "sdk_common.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+#include "app_util_platform.h"
+#include "prio_sched.h"
+#include "ble_dcs.h"
+#include "ble_dds.h"
+#include "range_bg.h"
+
+#include "fds.h"
+#include "nrf_log.h"
+
+#define CONFIG_FILE_ID          0x3000
+#define CONFIG_REC_KEY          0x3001
+#define LEGACY_BLE_FILE_ID      0x2000      ///< File of the BLE configuration record before this store.
+#define LEGACY_BLE_REC_KEY      0x2001
+#define LEGACY_DET_FILE_ID      0x1001      ///< File of the detection configuration and range background records before this store.
+#define LEGACY_DET_REC_KEY      0x1002
+#define LEGACY_DET_CONFIG_SIZE  offsetof(ble_dds_config_t, calibration) ///< ble_dds_config_t ended at the sample mode then.
+#define LEGACY_RANGE_BG_REC_KEY 0x1005
+#define LEGACY_VALID            0x42UL      ///< First word of every legacy record.
+
+#define TLV_HEADER_SIZE         2           ///< Tag and length, one byte each.
+
+/**@brief Configuration record, the values follow each other as tag, length and value.
+ */
+typedef union
+{
+    struct
+    {
+        uint16_t version;
+        uint16_t len;                       ///< Bytes used in tlv.
+        uint8_t  tlv[M_CONFIG_STORE_SIZE];
+    } data;
+    uint32_t padding[CEIL_DIV(2 * sizeof(uint16_t) + M_CONFIG_STORE_SIZE, 4)];
+} config_record_t;
+
+/**@brief BLE configuration record before this store.
+ */
+typedef struct
+{
+    uint32_t         valid;
+    ble_dcs_params_t config;
+} legacy_ble_record_t;
+
+/**@brief Detection configuration record before this store.
+ */
+typedef struct
+{
+    uint32_t valid;
+    uint8_t  config[LEGACY_DET_CONFIG_SIZE];
+} legacy_det_record_t;
+
+// Range and presence interval, four thresholds and a one byte sample mode
+STATIC_ASSERT(LEGACY_DET_CONFIG_SIZE == 13);
+
+/**@brief Range background record before this store, the value is laid out as range_bg_store_t in m_detection.
+ */
+typedef struct
+{
+    uint32_t valid;
+    struct
+    {
+        uint8_t    flags;
+        uint16_t   margin_mm;
+        range_bg_t model;
+    } range_bg;
+} legacy_range_bg_record_t;
+
+static uint16_t const       m_legacy_files[] = { LEGACY_BLE_FILE_ID, LEGACY_DET_FILE_ID };
+
+static config_record_t      m_image;                    ///< Values as set.
+static config_record_t      m_written;                  ///< Values as written or being written, fds does not copy them.
+static bool                 m_written_valid = false;    ///< m_written is what is in flash, or will be.
+static fds_record_desc_t    m_desc;
+static bool                 m_found = false;            ///< m_desc refers to a record.
+static bool volatile        m_dirty = false;            ///< m_image changed since it was last copied to m_written.
+static bool volatile        m_write_pending = false;
+static bool volatile        m_retry = false;            ///< A write was due but could not be queued, tried again after the next fds event.
+static bool volatile        m_init_done = false;
+static ret_code_t           m_init_result;
+static bool                 m_gc_hold = false;
+static bool volatile        m_gc_requested = false;
+static bool volatile        m_gc_running = false;
+static bool volatile        m_gc_check = false;         ///< Flash changed since the need for garbage collection was last checked.
+static bool volatile        m_legacy_imported = false;  ///< Values were taken from legacy records, their files are deleted once the record is written.
+static uint8_t volatile     m_legacy_delete_left = 0;   ///< Legacy files still to be deleted, from the end of m_legacy_files.
+
+APP_TIMER_DEF(m_debounce_timer_id);
+
+/**@brief Function for finding a value in a record.
+ *
+ * @return The tag of the value, followed by its length and the value. NULL if not found.
+ */
+static uint8_t * tlv_find(config_record_t * p_record, uint8_t tag)
+{
+    uint16_t pos = 0;
+
+    while (pos + TLV_HEADER_SIZE <= p_record->data.len)
+    {
+        uint8_t * p_tlv = &p_record->data.tlv[pos];
+
+        if (p_tlv[0] == tag)
+        {
+            return p_tlv;
+        }
+
+        pos += TLV_HEADER_SIZE + p_tlv[1];
+    }
+
+    return NULL;
+}
+
+/**@brief Function for checking that the values of a record read from flash fill it exactly.
+ */
+static bool tlv_valid(config_record_t const * p_record)
+{
+    uint16_t pos = 0;
+
+    if (p_record->data.len > M_CONFIG_STORE_SIZE)
+    {
+        return false;
+    }
+
+    while (pos + TLV_HEADER_SIZE <= p_record->data.len)
+    {
+        pos += TLV_HEADER_SIZE + p_record->data.tlv[pos + 1];
+    }
+
+    return (pos == p_record->data.len);
+}
+
+/**@brief Function for writing the values, unless they are the ones in flash already.
+ */
+static void config_flush(void)
+{
+    fds_record_t record;
+    bool         unchanged;
+    ret_code_t   rc;
+
+    m_retry = m_write_pending;
+
+    if (m_write_pending || !m_dirty)
+    {
+        // Flushed again once the write is done
+        return;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    m_dirty   = false;
+    unchanged = m_written_valid                                 &&
+                (m_written.data.len == m_image.data.len)        &&
+                (memcmp(m_written.data.tlv, m_image.data.tlv, m_image.data.len) == 0);
+
+    if (!unchanged)
+    {
+        memcpy(&m_written, &m_image, sizeof(m_written));
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    if (unchanged)
+    {
+        // Set and set back within the debounce time
+        return;
+    }
+
+    record.data.p_data       = &m_written;
+    record.data.length_words = CEIL_DIV(2 * sizeof(uint16_t) + m_written.data.len, 4);
+    record.file_id           = CONFIG_FILE_ID;
+    record.key               = CONFIG_REC_KEY;
+
+    rc = m_found ? fds_record_update(&m_desc, &record) : fds_record_write(&m_desc, &record);
+
+    if ((rc == FDS_ERR_NO_SPACE_IN_FLASH) || (rc == FDS_ERR_NO_SPACE_IN_QUEUES))
+    {
+        // Written again after garbage collection, or with the next change
+        m_written_valid = false;
+        m_dirty         = true;
+        m_retry         = true;
+        m_gc_requested  = m_gc_requested || (rc == FDS_ERR_NO_SPACE_IN_FLASH);
+        return;
+    }
+    APP_ERROR_CHECK(rc);
+
+    m_found         = true;
+    m_written_valid = true;
+    m_write_pending = true;
+
+    NRF_LOG_INFO("Storing configuration, %d bytes\r\n", m_written.data.len);
+}
+
+static void config_flush_scheduled(void * p_event_data, uint16_t event_size)
+{
+    config_flush();
+}
+
+static void debounce_timeout_handler(void * p_context)
+{
+    config_flush();
+}
+
+/**@brief Function for deleting the files used before this store, those that still have records.
+ */
+static void legacy_delete(void)
+{
+    fds_record_desc_t desc;
+    fds_find_token_t  ftok;
+
+    while (m_legacy_delete_left > 0)
+    {
+        uint16_t file_id = m_legacy_files[m_legacy_delete_left - 1];
+
+        memset(&ftok, 0x00, sizeof(fds_find_token_t));
+
+        if ((fds_record_find_in_file(file_id, &desc, &ftok) == FDS_SUCCESS) &&
+            (fds_file_delete(file_id) != FDS_SUCCESS))
+        {
+            // The fds queue is full, tried again after the next fds event
+            return;
+        }
+        m_legacy_delete_left--;
+    }
+}
+
+static void legacy_delete_scheduled(void * p_event_data, uint16_t event_size)
+{
+    legacy_delete();
+}
+
+/**@brief Function for handling flash data storage events.
+ */
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+            m_init_result = p_evt->result;
+            m_init_done   = true;
+            break;
+
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+            m_gc_check = true;
+
+            if (p_evt->write.file_id == CONFIG_FILE_ID)
+            {
+                m_write_pending = false;
+
+                if (p_evt->result != FDS_SUCCESS)
+                {
+                    NRF_LOG_ERROR("Configuration write failed - %d\r\n", p_evt->result);
+
+                    // Written again with the next change
+                    m_written_valid = false;
+                }
+                else if (m_legacy_imported)
+                {
+                    // The imported values are in flash, the records they came from can go
+                    m_legacy_imported    = false;
+                    m_legacy_delete_left = ARRAY_SIZE(m_legacy_files);
+                }
+            }
+            break;
+
+        case FDS_EVT_DEL_RECORD:
+        case FDS_EVT_DEL_FILE:
+            m_gc_check = true;
+            break;
+
+        case FDS_EVT_GC:
+            m_gc_running = false;
+            m_gc_check   = true;
+            break;
+
+        default:
+            break;
+    }
+
+    if (m_retry && (p_evt->id != FDS_EVT_INIT))
+    {
+        (void)prio_sched_event_put(NULL, 0, config_flush_scheduled, PRIO_SCHED_LOW);
+    }
+
+    if ((m_legacy_delete_left > 0) && (p_evt->id != FDS_EVT_INIT))
+    {
+        (void)prio_sched_event_put(NULL, 0, legacy_delete_scheduled, PRIO_SCHED_LOW);
+    }
+}
+
+/**@brief Function for reading a legacy record, the part of it stored.
+ *
+ * @return true if the record was found and is valid, the rest of p_data is zero.
+ */
+static bool legacy_read(uint16_t file_id, uint16_t key, void * p_data, uint16_t size)
+{
+    fds_record_desc_t  desc;
+    fds_flash_record_t flash_record;
+    fds_find_token_t   ftok;
+
+    memset(&ftok, 0x00, sizeof(fds_find_token_t));
+    memset(p_data, 0, size);
+
+    if ((fds_record_find(file_id, key, &desc, &ftok) != FDS_SUCCESS) ||
+        (fds_record_open(&desc, &flash_record) != FDS_SUCCESS))
+    {
+        return false;
+    }
+
+    memcpy(p_data, flash_record.p_data, MIN(flash_record.p_header->length_words * 4, size));
+    (void)fds_record_close(&desc);
+
+    return (*(uint32_t *)p_data == LEGACY_VALID);
+}
+
+/**@brief Function for taking the values of the records written before this store.
+ *
+ * @return true if any value was taken.
+ */
+static bool legacy_import(void)
+{
+    legacy_ble_record_t      ble;
+    legacy_det_record_t      det;
+    legacy_range_bg_record_t range_bg;
+    bool                     imported = false;
+    uint32_t                 err_code;
+
+    if (legacy_read(LEGACY_BLE_FILE_ID, LEGACY_BLE_REC_KEY, &ble, sizeof(ble)))
+    {
+        err_code = m_config_store_set(M_CONFIG_STORE_TAG_BLE, &ble.config, sizeof(ble.config));
+        APP_ERROR_CHECK(err_code);
+        imported = true;
+    }
+
+    if (legacy_read(LEGACY_DET_FILE_ID, LEGACY_DET_REC_KEY, &det, sizeof(det)))
+    {
+        // Stored as short as it was, the settings added since load as zero and m_detection gives each its default
+        err_code = m_config_store_set(M_CONFIG_STORE_TAG_DETECTION, det.config, sizeof(det.config));
+        APP_ERROR_CHECK(err_code);
+        imported = true;
+    }
+
+    if (legacy_read(LEGACY_DET_FILE_ID, LEGACY_RANGE_BG_REC_KEY, &range_bg, sizeof(range_bg)))
+    {
+        err_code = m_config_store_set(M_CONFIG_STORE_TAG_RANGE_BG, &range_bg.range_bg, sizeof(range_bg.range_bg));
+        APP_ERROR_CHECK(err_code);
+        imported = true;
+    }
+
+    return imported;
+}
+
+/**@brief Function for loading the newest configuration record.
+ */
+static uint32_t config_load(void)
+{
+    fds_record_desc_t  desc;
+    fds_flash_record_t flash_record;
+    fds_find_token_t   ftok;
+    ret_code_t         rc;
+
+    memset(&ftok, 0x00, sizeof(fds_find_token_t));
+    memset(&m_image, 0, sizeof(m_image));
+
+    m_image.data.version = M_CONFIG_STORE_VERSION;
+
+    // An update cut short by a reset leaves the old record next to the new one
+    while (fds_record_find(CONFIG_FILE_ID, CONFIG_REC_KEY, &desc, &ftok) == FDS_SUCCESS)
+    {
+        if (!m_found || (desc.record_id > m_desc.record_id))
+        {
+            if (m_found)
+            {
+                (void)fds_record_delete(&m_desc);
+            }
+
+            m_desc  = desc;
+            m_found = true;
+        }
+        else
+        {
+            (void)fds_record_delete(&desc);
+        }
+    }
+
+    if (!m_found)
+    {
+        if (!legacy_import())
+        {
+            NRF_LOG_INFO("No configuration stored, using defaults\r\n");
+
+            // Nothing valid to keep in them
+            m_legacy_delete_left = ARRAY_SIZE(m_legacy_files);
+            legacy_delete();
+
+            return NRF_SUCCESS;
+        }
+
+        NRF_LOG_INFO("Configuration imported from legacy records, %d bytes\r\n", m_image.data.len);
+
+        // Written now rather than after the debounce time, the legacy records are deleted after it
+        m_legacy_imported = true;
+        (void)app_timer_stop(m_debounce_timer_id);
+        config_flush();
+
+        return NRF_SUCCESS;
+    }
+
+    // Left over when a reset came between importing them and deleting them
+    m_legacy_delete_left = ARRAY_SIZE(m_legacy_files);
+    legacy_delete();
+
+    rc = fds_record_open(&m_desc, &flash_record);
+    VERIFY_SUCCESS(rc);
+
+    memset(&m_written, 0, sizeof(m_written));
+    memcpy(&m_written, flash_record.p_data, MIN(flash_record.p_header->length_words * 4, sizeof(m_written)));
+
+    rc = fds_record_close(&m_desc);
+    VERIFY_SUCCESS(rc);
+
+    if ((m_written.data.version != M_CONFIG_STORE_VERSION) || !tlv_valid(&m_written))
+    {
+        NRF_LOG_WARNING("Configuration record version %d not loaded, using defaults\r\n", m_written.data.version);
+        return NRF_SUCCESS;
+    }
+
+    memcpy(&m_image, &m_written, sizeof(m_image));
+    m_written_valid = true;
+
+    NRF_LOG_INFO("Configuration loaded, %d bytes\r\n", m_image.data.len);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t m_config_store_init(void)
+{
+    ret_code_t rc;
+
+    rc = fds_register(fds_evt_handler);
+    VERIFY_SUCCESS(rc);
+
+    rc = fds_init();
+    VERIFY_SUCCESS(rc);
+
+    // Only formatting new pages takes flash operations, otherwise it is done already
+    while (!m_init_done)
+    {
+        app_sched_execute();
+    }
+
+    if (m_init_result != FDS_SUCCESS)
+    {
+        NRF_LOG_ERROR("FDS init failed - %d\r\n", m_init_result);
+        return m_init_result;
+    }
+
+    rc = app_timer_create(&m_debounce_timer_id, APP_TIMER_MODE_SINGLE_SHOT, debounce_timeout_handler);
+    VERIFY_SUCCESS(rc);
+
+    return config_load();
+}
+
+uint32_t m_config_store_load(m_config_store_tag_t tag, void * p_value, uint8_t len)
+{
+    uint8_t * p_tlv;
+
+    VERIFY_PARAM_NOT_NULL(p_value);
+
+    CRITICAL_REGION_ENTER();
+
+    p_tlv = tlv_find(&m_image, (uint8_t)tag);
+    if (p_tlv != NULL)
+    {
+        memset(p_value, 0, len);
+        memcpy(p_value, &p_tlv[TLV_HEADER_SIZE], MIN(len, p_tlv[1]));
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return (p_tlv != NULL) ? NRF_SUCCESS : NRF_ERROR_NOT_FOUND;
+}
+
+uint32_t m_config_store_set(m_config_store_tag_t tag, void const * p_value, uint8_t len)
+{
+    uint32_t  err_code = NRF_SUCCESS;
+    bool      changed  = false;
+    uint8_t * p_tlv;
+
+    VERIFY_PARAM_NOT_NULL(p_value);
+
+    CRITICAL_REGION_ENTER();
+
+    p_tlv = tlv_find(&m_image, (uint8_t)tag);
+
+    if ((p_tlv != NULL) && (p_tlv[1] == len))
+    {
+        if (memcmp(&p_tlv[TLV_HEADER_SIZE], p_value, len) != 0)
+        {
+            memcpy(&p_tlv[TLV_HEADER_SIZE], p_value, len);
+            changed = true;
+        }
+    }
+    else if (m_image.data.len + TLV_HEADER_SIZE + len - ((p_tlv != NULL) ? (TLV_HEADER_SIZE + p_tlv[1]) : 0) > M_CONFIG_STORE_SIZE)
+    {
+        err_code = NRF_ERROR_NO_MEM;
+    }
+    else
+    {
+        if (p_tlv != NULL)
+        {
+            // The length changed, the value moves to the end
+            uint16_t  old_size = TLV_HEADER_SIZE + p_tlv[1];
+            uint8_t * p_end    = &m_image.data.tlv[m_image.data.len];
+
+            memmove(p_tlv, p_tlv + old_size, p_end - (p_tlv + old_size));
+            m_image.data.len -= old_size;
+        }
+
+        p_tlv    = &m_image.data.tlv[m_image.data.len];
+        p_tlv[0] = (uint8_t)tag;
+        p_tlv[1] = len;
+        memcpy(&p_tlv[TLV_HEADER_SIZE], p_value, len);
+
+        m_image.data.len += TLV_HEADER_SIZE + len;
+        changed           = true;
+    }
+
+    m_dirty = m_dirty || changed;
+
+    CRITICAL_REGION_EXIT();
+
+    if (changed)
+    {
+        // A running single shot timer ignores a start, it is stopped first to start over
+        (void)app_timer_stop(m_debounce_timer_id);
+        err_code = app_timer_start(m_debounce_timer_id, APP_TIMER_TICKS(M_CONFIG_STORE_DEBOUNCE_MS), NULL);
+    }
+
+    return err_code;
+}
+
+void m_config_store_gc_hold(bool hold)
+{
+    m_gc_hold = hold;
+}
+
+void m_config_store_gc_request(void)
+{
+    m_gc_requested = true;
+}
+
+void m_config_store_process(void)
+{
+    fds_stat_t stat;
+    ret_code_t rc;
+
+    if (m_gc_hold || m_gc_running)
+    {
+        return;
+    }
+
+    if (m_gc_check && !m_gc_requested)
+    {
+        m_gc_check = false;
+
+        // Pages are erased only when the free space runs low, not for every deleted record
+        if ((fds_stat(&stat) == FDS_SUCCESS) &&
+            (stat.dirty_records > 0)         &&
+            (stat.largest_contig < M_CONFIG_STORE_GC_CONTIG_WORDS))
+        {
+            m_gc_requested = true;
+        }
+    }
+
+    if (!m_gc_requested)
+    {
+        return;
+    }
+
+    rc = fds_gc();
+    if (rc == FDS_SUCCESS)
+    {
+        m_gc_requested = false;
+        m_gc_running   = true;
+
+        NRF_LOG_INFO("Collecting flash garbage\r\n");
+    }
+    // Otherwise the fds queue is full, tried again on the next pass
+}
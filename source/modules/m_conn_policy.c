@@ -0,0 +1,257 @@
+#include "m_conn_policy.h"
+#include "ble_conn_params.h"
+#include "nrf_sdh_ble.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "nrf_log.h"
+
+typedef enum
+{
+    PROFILE_NONE,
+    PROFILE_FAST,
+    PROFILE_IDLE,
+} profile_t;
+
+static const ble_gap_conn_params_t m_profiles[] =
+{
+    [PROFILE_FAST] =
+    {
+        .min_conn_interval = (uint16_t)MSEC_TO_UNITS(M_CONN_POLICY_FAST_MIN_INT_MS, UNIT_1_25_MS),
+        .max_conn_interval = (uint16_t)MSEC_TO_UNITS(M_CONN_POLICY_FAST_MAX_INT_MS, UNIT_1_25_MS),
+        .slave_latency     = M_CONN_POLICY_FAST_LATENCY,
+        .conn_sup_timeout  = (uint16_t)MSEC_TO_UNITS(M_CONN_POLICY_FAST_SUP_TIMEOUT_MS, UNIT_10_MS),
+    },
+    [PROFILE_IDLE] =
+    {
+        .min_conn_interval = (uint16_t)MSEC_TO_UNITS(M_CONN_POLICY_IDLE_MIN_INT_MS, UNIT_1_25_MS),
+        .max_conn_interval = (uint16_t)MSEC_TO_UNITS(M_CONN_POLICY_IDLE_MAX_INT_MS, UNIT_1_25_MS),
+        .slave_latency     = M_CONN_POLICY_IDLE_LATENCY,
+        .conn_sup_timeout  = (uint16_t)MSEC_TO_UNITS(M_CONN_POLICY_IDLE_SUP_TIMEOUT_MS, UNIT_10_MS),
+    },
+};
+
+/**@brief Policy state of one connection.
+ */
+typedef struct
+{
+    uint16_t  conn_handle;          ///< BLE_CONN_HANDLE_INVALID if the slot is free.
+    profile_t requested;            ///< Profile last requested from the central.
+    bool      overridden;           ///< The peer set the parameters of this connection.
+} link_t;
+
+static link_t    m_links[NRF_SDH_BLE_PERIPHERAL_LINK_COUNT];
+static uint8_t   m_demand      = 0;                 ///< One bit per m_conn_policy_demand_t.
+static profile_t m_wanted      = PROFILE_NONE;      ///< Profile the demand calls for, on every connection.
+
+APP_TIMER_DEF(m_idle_timer_id);
+
+static link_t * link_find(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT; i++)
+    {
+        if (m_links[i].conn_handle == conn_handle)
+        {
+            return &m_links[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool link_any(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT; i++)
+    {
+        if (m_links[i].conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**@brief Function for requesting the wanted profile on a connection if it was not requested yet.
+ */
+static void profile_request(link_t * p_link)
+{
+    uint32_t err_code;
+
+    if ((p_link == NULL)                                 ||
+        (p_link->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        p_link->overridden                               ||
+        (m_wanted == PROFILE_NONE)                       ||
+        (m_wanted == p_link->requested))
+    {
+        return;
+    }
+
+    err_code = ble_conn_params_change_conn_params(p_link->conn_handle, (ble_gap_conn_params_t *)&m_profiles[m_wanted]);
+    if (err_code == NRF_SUCCESS)
+    {
+        NRF_LOG_INFO("Connection parameters requested: 0x%x %s\r\n",
+                     p_link->conn_handle, (m_wanted == PROFILE_FAST) ? "fast" : "idle");
+
+        p_link->requested = m_wanted;
+    }
+    else if ((err_code != NRF_ERROR_BUSY) && (err_code != NRF_ERROR_INVALID_STATE))
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    // Busy, retried once the update in progress completes
+}
+
+/**@brief Function for requesting the wanted profile on every connection.
+ */
+static void profile_request_all(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT; i++)
+    {
+        profile_request(&m_links[i]);
+    }
+}
+
+static void idle_timeout_handler(void * p_context)
+{
+    if (m_demand == 0)
+    {
+        m_wanted = PROFILE_IDLE;
+        profile_request_all();
+    }
+}
+
+uint32_t m_conn_policy_init(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT; i++)
+    {
+        m_links[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+
+    return app_timer_create(&m_idle_timer_id, APP_TIMER_MODE_SINGLE_SHOT, idle_timeout_handler);
+}
+
+void m_conn_policy_demand_set(m_conn_policy_demand_t demand, bool active)
+{
+    uint32_t err_code;
+    uint8_t  demand_prev = m_demand;
+
+    if (active)
+    {
+        m_demand |= (1 << demand);
+    }
+    else
+    {
+        m_demand &= ~(1 << demand);
+    }
+
+    if ((m_demand != 0) && (demand_prev == 0))
+    {
+        err_code = app_timer_stop(m_idle_timer_id);
+        APP_ERROR_CHECK(err_code);
+
+        m_wanted = PROFILE_FAST;
+        profile_request_all();
+    }
+    else if ((m_demand == 0) && (demand_prev != 0))
+    {
+        // Sessions follow each other closely, do not renegotiate between them
+        err_code = app_timer_start(m_idle_timer_id, APP_TIMER_TICKS(M_CONN_POLICY_IDLE_HOLDOFF_MS), NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+void m_conn_policy_on_ble_evt(ble_evt_t const * p_ble_evt)
+{
+    uint32_t err_code;
+    link_t * p_link;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            p_link = link_find(BLE_CONN_HANDLE_INVALID);
+            if (p_link == NULL)
+            {
+                break;
+            }
+
+            p_link->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            p_link->requested   = PROFILE_NONE;
+            p_link->overridden  = false;
+
+            if (m_demand != 0)
+            {
+                m_wanted = PROFILE_FAST;
+                profile_request(p_link);
+            }
+            else
+            {
+                // Leave the central its own parameters for service discovery
+                err_code = app_timer_start(m_idle_timer_id, APP_TIMER_TICKS(M_CONN_POLICY_IDLE_HOLDOFF_MS), NULL);
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            p_link = link_find(p_ble_evt->evt.gap_evt.conn_handle);
+            if (p_link == NULL)
+            {
+                break;
+            }
+
+            p_link->conn_handle = BLE_CONN_HANDLE_INVALID;
+
+            if (!link_any())
+            {
+                err_code = app_timer_stop(m_idle_timer_id);
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        {
+            ble_gap_conn_params_t const * p_params = &p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params;
+
+            NRF_LOG_INFO("Connection 0x%x interval: %d, latency: %d\r\n",
+                         p_ble_evt->evt.gap_evt.conn_handle, p_params->max_conn_interval, p_params->slave_latency);
+
+            profile_request(link_find(p_ble_evt->evt.gap_evt.conn_handle));
+        }
+        break;
+
+        default:
+            break;
+    }
+}
+
+void m_conn_policy_override(uint16_t conn_handle)
+{
+    link_t * p_link = link_find(conn_handle);
+
+    if (p_link != NULL)
+    {
+        p_link->overridden = true;
+    }
+}
+
+bool m_conn_policy_negotiation_failed(uint16_t conn_handle)
+{
+    link_t const * p_link = link_find(conn_handle);
+
+    if ((p_link == NULL) || p_link->overridden || (p_link->requested == PROFILE_NONE))
+    {
+        return false;
+    }
+
+    NRF_LOG_WARNING("Central 0x%x kept its connection parameters\r\n", conn_handle);
+
+    return true;
+}
@@ -1,25 +1,778 @@
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
 #include "m_detection.h"
-#include "m_detection_flash.h"
+#include "m_config_store.h"
+#include "m_agg_log.h"
+#include "m_conn_policy.h"
+#include "m_l2cap.h"
 #include "detect_board.h"
 #include "drv_presence.h"
 #include "drv_range.h"
+#include "hw_timestamp.h"
+#include "wall_clock.h"
+#include "tlog.h"
+#include "sample_sched.h"
+#include "prio_sched.h"
+#include "ir_codec.h"
+#include "people_count.h"
+#include "agg_stats.h"
+#include "range_bg.h"
+#include "det_config.h"
 
 static ble_dds_t              m_dds;                                        ///< Structure to identify the Thingy Environment Service.
-static ble_dds_config_t     * m_p_config;                                   ///< Configuraion pointer./
+static ble_dds_config_t       m_config;                                     ///< Configuration, as stored.
+static ble_dds_config_t     * m_p_config = &m_config;                       ///< Configuraion pointer./
 static const ble_dds_config_t m_default_config = DETECTION_CONFIG_DEFAULT;  ///< Default configuraion.
 
+#define PRESENCE_AUTO_BATCH_LEN      8          // Continuous presence samples per CPU wakeup while the TWI bus is not shared.
+
+#define PREROLL_INTERVAL_MS          250        // Presence sample rate while waiting for motion.
+#define PREROLL_SAMPLES              8          // Samples kept from before the motion trigger.
+#define HISTORY_SIZE                 16         // Pre-roll plus notifications waiting for a free TX buffer, power of two.
+#define STREAM_LATENCY_MS            200        // Longest a sample waits in a partly filled stream packet.
+
+#define AGGREGATE_WINDOW_DEFAULT_S   60         // Aggregation window until the peer writes one.
+#define AGGREGATE_TICK_MS            1000       // Aggregation windows are counted in these.
+#define AGGREGATE_LOG_WINDOW_MIN_S   60         // Shorter windows are only kept in RAM, logging them would wear the flash out.
+
+#define RANGE_BG_MARGIN_DEFAULT_MM   150        // Foreground margin until the peer writes one.
+#define BROADCAST_INTERVAL_DEFAULT_MS 1000      // Advertising interval while broadcasting until the peer writes one.
+#define RANGE_BG_SAVE_DELTA_MM       50         // The background is stored again once it moved this far.
+#define RANGE_BG_IDLE_PROBE_MS       10000      // Range reading interval while waiting for motion, keeps the background learned.
+
+#define BULK_CMD_LOG                 0x01       // Central: send the aggregation log.
+#define BULK_CMD_CAPTURE_START       0x02       // Central: send presence samples as they are taken.
+#define BULK_CMD_CAPTURE_STOP        0x03       // Central: stop sending presence samples.
+#define BULK_SDU_LOG                 0x01       // Peripheral: aggregation windows follow.
+#define BULK_SDU_LOG_END             0x02       // Peripheral: the log is empty.
+#define BULK_SDU_SAMPLES             0x03       // Peripheral: presence samples follow.
+
+#define CALIB_AK9750_EVAL_RATE_HZ    10         // Rate the AK9750 compares IR13/IR24 against the thresholds in motion mode.
+#define CALIB_SIGMA_MIN              2.0f       // Lowest threshold, in standard deviations of the idle noise.
+#define CALIB_SIGMA_MAX              8.0f       // Highest threshold, in standard deviations of the idle noise.
+#define CALIB_SIGMA_STEP             0.1f
+#define CALIB_THRESHOLD_MIN          20         // Thresholds never go closer to the baseline than this.
+
+/**@brief Running statistics of one IR differential (Welford).
+ */
+typedef struct
+{
+    float    mean;
+    float    m2;
+} calib_stats_t;
+
+/**@brief Threshold calibration state.
+ */
+typedef struct
+{
+    bool               active;          ///< Calibration in progress.
+    ble_dds_config_t   config;          ///< Configuration being calibrated, stored once done.
+    uint32_t           samples;         ///< Samples taken so far.
+    uint32_t           samples_total;   ///< Samples to take over the calibration window.
+    int32_t            ir_sum[4];       ///< Sum of IR1..IR4, for the idle baseline.
+    calib_stats_t      ir13;            ///< IR1-IR3 noise.
+    calib_stats_t      ir24;            ///< IR2-IR4 noise.
+} calib_t;
+
+static calib_t m_calib;
+
+/**@brief Aggregate statistics state.
+ *
+ * @details Windows are notified oldest first: the one being notified, then those read back from
+ *          the flash log, then those still pending in RAM. Pending windows are logged once there
+ *          are enough for a record, room for a second record lets them wait for a write in flight.
+ */
+typedef struct
+{
+    agg_stats_t        ir[4];                                   ///< IR1..IR4 in the current window.
+    agg_stats_t        range;                                   ///< Range in the current window.
+    uint16_t           window_s;                                ///< Window length.
+    uint16_t           elapsed_s;                               ///< Time into the current window.
+    uint8_t            boot;                                    ///< Reset count in window timestamps taken before the time is set.
+    bool               boot_counted;                            ///< This reset is counted.
+    agg_stats_window_t pending[2 * M_AGG_LOG_BATCH];  ///< Windows neither notified nor logged, oldest first.
+    uint8_t            pending_count;
+    agg_stats_window_t tx[M_AGG_LOG_BATCH];           ///< Windows being notified.
+    uint8_t            tx_first;
+    uint8_t            tx_count;
+    uint8_t            tx_channel;                              ///< Next channel of the first window being notified.
+} aggregate_t;
+
+static aggregate_t m_agg;
+
+/**@brief Bulk transfers over the L2CAP channel.
+ */
+typedef struct
+{
+    bool     log;                                       ///< The aggregation log is being sent.
+    bool     capture;                                   ///< Presence samples are sent as they are taken.
+    uint8_t  capture_buf[M_L2CAP_SDU_MAX];              ///< SDU of samples being filled.
+    uint16_t capture_len;
+    uint32_t capture_dropped;                           ///< Samples lost while both TX buffers were in flight.
+} bulk_t;
+
+static bulk_t m_bulk;
+
+/**@brief Range background settings and model, as stored.
+ */
+typedef struct
+{
+    uint8_t    flags;                           ///< BLE_DDS_RANGE_BG_ flags.
+    uint16_t   margin_mm;
+    range_bg_t model;
+} range_bg_store_t;
+
+static range_bg_store_t m_range_bg;             ///< Range background model and settings.
+static float m_range_bg_saved_mm = 0.0f;        ///< Background when last stored.
+static bool m_range_probe = false;              ///< The range being read is for the background or the motion gate, not notified.
+static bool m_gate_waiting = false;             ///< The AK9750 triggered, the session starts once the range sees foreground.
+static uint16_t m_idle_ticks = 0;               ///< Pre-roll samples since the last idle range reading.
+static ble_dds_broadcast_t m_broadcast;         ///< Occupancy broadcast settings, motion detection runs without a peer unless off.
+static uint32_t m_session_start_ms = 0;         ///< Start of the current motion session, ms since presence sampling started.
+static ble_dds_time_t m_time;                   ///< Absolute time of the presence and range timestamps.
+
+/**@brief Presence samples not notified yet, oldest first.
+ *
+ * @details Filled at a low rate before a motion session and flushed ahead of the live stream
+ *          once it starts. During the session it holds samples the SoftDevice had no TX buffer for.
+ */
+typedef struct
+{
+    ble_dds_presence_t samples[HISTORY_SIZE];
+    uint8_t            first;
+    uint8_t            count;
+} history_t;
+
+static history_t m_history;
+static ir_codec_t m_stream;                 ///< Compressed presence stream packet being filled.
+static ble_dds_range_t m_range_sent;        ///< Last notified range reading.
+static people_count_t m_people;             ///< Direction of travel estimator.
+static ble_dds_count_t m_count;             ///< People count exposed to the peer.
+
+STATIC_ASSERT(IS_POWER_OF_TWO(HISTORY_SIZE));
+STATIC_ASSERT(PREROLL_SAMPLES <= HISTORY_SIZE);
+
 bool range_read = true;
-uint32_t range_timestamp = 0;
-uint32_t presence_timestamp = 0;
+uint32_t range_epoch = 0;
+uint32_t presence_epoch = 0;
 uint8_t range_start_flag = 0;
 uint8_t presence_start_flag = 0;
 uint8_t presence_stop_flag = 0;
+static bool presence_continuous = false;    ///< Continuous presence streaming is running.
+static bool presence_auto = false;          ///< Continuous presence is sampled without the CPU.
+static bool range_active = false;           ///< The VL53L0X is using the TWI bus.
+static bool presence_active = false;        ///< Presence sampling runs for at least one characteristic.
+
+SAMPLE_SCHED_DEF(presence_action);
+SAMPLE_SCHED_DEF(range_action);
+SAMPLE_SCHED_DEF(calib_action);
+SAMPLE_SCHED_DEF(preroll_action);
+SAMPLE_SCHED_DEF(aggregate_action);
+
+
+/**@brief Function for appending a presence sample to the history, dropping the oldest when full.
+ */
+static void history_push(ble_dds_presence_t const * p_presence, uint8_t limit)
+{
+    if (m_history.count >= limit)
+    {
+        m_history.first = (m_history.first + 1) & (HISTORY_SIZE - 1);
+        m_history.count--;
+    }
+
+    m_history.samples[(m_history.first + m_history.count) & (HISTORY_SIZE - 1)] = *p_presence;
+    m_history.count++;
+}
+
+/**@brief Function for checking if the peer wants presence samples, raw, compressed or counted.
+ */
+static bool presence_notif_enabled(void)
+{
+    return m_dds.is_presence_notif_enabled        ||
+           m_dds.is_presence_stream_notif_enabled ||
+           m_dds.is_count_notif_enabled;
+}
+
+/**@brief Function for checking if motion detection runs for the occupancy broadcast.
+ */
+static bool broadcast_sampling(void)
+{
+    return (m_broadcast.mode != BLE_DDS_BROADCAST_OFF) && (m_p_config->sample_mode == SAMPLE_MODE_MOTION);
+}
+
+/**@brief Function for checking if presence sampling is wanted, by the peer, the broadcast or a capture.
+ */
+static bool presence_wanted(void)
+{
+    return presence_notif_enabled() || broadcast_sampling() || m_bulk.capture;
+}
+
+/**@brief Function for notifying the stream packet being filled.
+ */
+static uint32_t stream_send(void)
+{
+    uint32_t        err_code;
+    uint8_t const * p_data;
+    uint16_t        length = ir_codec_packet_get(&m_stream, &p_data);
+
+    if (length == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    err_code = ble_dds_presence_stream_set(&m_dds, p_data, length);
+    if (err_code == NRF_SUCCESS)
+    {
+        ir_codec_packet_release(&m_stream);
+    }
+
+    return err_code;
+}
+
+/**@brief Function for coding the history into stream packets, sending each one that is full.
+ *
+ * @param[in] force    Also send a partly filled packet, e.g. at the end of a session.
+ */
+static void stream_flush(bool force)
+{
+    while (m_history.count > 0)
+    {
+        if (!ir_codec_put(&m_stream, &m_history.samples[m_history.first]))
+        {
+            if (stream_send() != NRF_SUCCESS)
+            {
+                // Retried on the next sample
+                return;
+            }
+            continue;
+        }
+
+        m_history.first = (m_history.first + 1) & (HISTORY_SIZE - 1);
+        m_history.count--;
+    }
+
+    if ((m_stream.frames > 0) &&
+        (force || (m_stream.state.prev.timestamp - m_stream.first_timestamp >= STREAM_LATENCY_MS)))
+    {
+        (void)stream_send();
+    }
+}
+
+/**@brief Function for notifying the history in order until the SoftDevice runs out of TX buffers.
+ */
+static void history_flush(void)
+{
+    uint32_t err_code;
+
+    if (m_dds.is_presence_stream_notif_enabled)
+    {
+        stream_flush(false);
+
+        m_conn_policy_demand_set(M_CONN_POLICY_DEMAND_BACKLOG, m_history.count > 0);
+        return;
+    }
+
+    while (m_history.count > 0)
+    {
+        err_code = ble_dds_presence_set(&m_dds, &m_history.samples[m_history.first]);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            // Retried on the next sample
+            break;
+        }
+
+        m_history.first = (m_history.first + 1) & (HISTORY_SIZE - 1);
+        m_history.count--;
+    }
+
+    m_conn_policy_demand_set(M_CONN_POLICY_DEMAND_BACKLOG, m_history.count > 0);
+}
+
+static void history_reset(void)
+{
+    m_history.first = 0;
+    m_history.count = 0;
+
+    ir_codec_reset(&m_stream);
+}
 
-APP_TIMER_DEF(presence_timer_id);
-APP_TIMER_DEF(range_timer_id);
-APP_TIMER_DEF(range_timestamp_timer_id);
-APP_TIMER_DEF(presence_timestamp_timer_id);
 
+/**@brief Function for classifying the motion session that just ended and updating the count.
+ */
+static void count_session_end(void)
+{
+    people_count_dir_t direction = people_count_session_end(&m_people);
+
+    m_count.timestamp = HW_TIMESTAMP_TO_MS(hw_timestamp_now() - presence_epoch);
+    m_count.direction = direction;
+
+    if (direction == PEOPLE_COUNT_ENTER)
+    {
+        m_count.enter++;
+    }
+    else if (direction == PEOPLE_COUNT_EXIT)
+    {
+        m_count.exit++;
+    }
+
+    NRF_LOG_INFO("Session direction: %d, enter: %d, exit: %d\r\n", direction, m_count.enter, m_count.exit);
+
+    (void)ble_dds_count_set(&m_dds, &m_count);
+    (void)m_ble_broadcast_session_add(&m_count, m_count.timestamp - m_session_start_ms);
+}
+
+/**@brief Function for getting the next windows to send, if none is left being sent.
+ *
+ * @return NRF_SUCCESS if windows are waiting in m_agg.tx, NRF_ERROR_NOT_FOUND if there are none,
+ *         NRF_ERROR_BUSY if a log write is still in flight, otherwise an error code.
+ */
+static uint32_t aggregate_tx_refill(void)
+{
+    uint32_t err_code;
+
+    if (m_agg.tx_count > 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    // Logged windows are older than the pending ones
+    err_code = m_agg_log_read(m_agg.tx, &m_agg.tx_count);
+    if (err_code == NRF_ERROR_NOT_FOUND)
+    {
+        if (m_agg.pending_count == 0)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+
+        memcpy(m_agg.tx, m_agg.pending, m_agg.pending_count * sizeof(agg_stats_window_t));
+        m_agg.tx_count      = m_agg.pending_count;
+        m_agg.pending_count = 0;
+        err_code            = NRF_SUCCESS;
+    }
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_agg.tx_first   = 0;
+        m_agg.tx_channel = 0;
+    }
+
+    return err_code;
+}
+
+/**@brief Function for notifying aggregation windows until none is left or the SoftDevice runs out of TX buffers.
+ */
+static void aggregate_flush(void)
+{
+    uint32_t             err_code;
+    agg_stats_window_t * p_window;
+    ble_dds_aggregate_t  aggregate;
+
+    while (m_dds.is_aggregate_notif_enabled)
+    {
+        err_code = aggregate_tx_refill();
+        if ((err_code == NRF_ERROR_BUSY) || (err_code == NRF_ERROR_NOT_FOUND))
+        {
+            // Retried once the log is ready again, or on the next window when nothing is left
+            return;
+        }
+
+        APP_ERROR_CHECK(err_code);
+
+        p_window = &m_agg.tx[m_agg.tx_first];
+
+        aggregate.timestamp = p_window->timestamp;
+        aggregate.channel   = m_agg.tx_channel;
+        aggregate.count     = (m_agg.tx_channel < 4) ? p_window->presence_count : p_window->range_count;
+        aggregate.summary   = p_window->summary[m_agg.tx_channel];
+
+        err_code = ble_dds_aggregate_set(&m_dds, &aggregate);
+        if (err_code != NRF_SUCCESS)
+        {
+            // Retried when a notification has been sent
+            return;
+        }
+
+        if (++m_agg.tx_channel == BLE_DDS_AGGREGATE_CHANNELS)
+        {
+            m_agg.tx_channel = 0;
+            m_agg.tx_first++;
+            m_agg.tx_count--;
+        }
+    }
+}
+
+static void aggregate_flush_scheduled(void * p_event_data, uint16_t event_size)
+{
+    aggregate_flush();
+}
+
+/**@brief Function for sending aggregation windows over the bulk channel until none is left or
+ *        its TX buffers are in flight.
+ *
+ * @details Takes the windows out of the log like the aggregate characteristic does, whole
+ *          windows in an SDU instead of one channel per notification.
+ */
+static void bulk_log_flush(void)
+{
+    uint32_t err_code;
+    uint8_t  sdu[M_L2CAP_SDU_MAX];
+    uint16_t len;
+    uint8_t  count;
+
+    while (m_bulk.log)
+    {
+        err_code = aggregate_tx_refill();
+        if (err_code == NRF_ERROR_BUSY)
+        {
+            // Retried once the log is ready again
+            return;
+        }
+
+        if (err_code == NRF_ERROR_NOT_FOUND)
+        {
+            sdu[0] = BULK_SDU_LOG_END;
+
+            if (m_l2cap_send(sdu, 1) == NRF_SUCCESS)
+            {
+                m_bulk.log = false;
+            }
+            return;
+        }
+
+        APP_ERROR_CHECK(err_code);
+
+        sdu[0] = BULK_SDU_LOG;
+        len    = 1;
+
+        for (count = 0; (count < m_agg.tx_count) && (len + sizeof(agg_stats_window_t) <= m_l2cap_sdu_max()); count++)
+        {
+            memcpy(&sdu[len], &m_agg.tx[m_agg.tx_first + count], sizeof(agg_stats_window_t));
+            len += sizeof(agg_stats_window_t);
+        }
+
+        if (count == 0)
+        {
+            NRF_LOG_WARNING("Bulk MTU too small for the log: %d\r\n", m_l2cap_sdu_max());
+            m_bulk.log = false;
+            return;
+        }
+
+        if (m_l2cap_send(sdu, len) != NRF_SUCCESS)
+        {
+            // Retried when an SDU has been sent
+            return;
+        }
+
+        // A window the characteristic was part way through is sent whole
+        m_agg.tx_first  += count;
+        m_agg.tx_count  -= count;
+        m_agg.tx_channel = 0;
+    }
+}
+
+/**@brief Function for sending the capture SDU being filled.
+ */
+static uint32_t bulk_capture_send(void)
+{
+    uint32_t err_code;
+
+    if (m_bulk.capture_len <= 1)
+    {
+        return NRF_SUCCESS;
+    }
+
+    err_code = m_l2cap_send(m_bulk.capture_buf, m_bulk.capture_len);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_bulk.capture_len = 1;
+    }
+
+    return err_code;
+}
+
+/**@brief Function for appending a presence sample to the capture, sending the SDU once it is full.
+ */
+static void bulk_capture_add(ble_dds_presence_t const * p_presence)
+{
+    if (!m_bulk.capture)
+    {
+        return;
+    }
+
+    if ((m_bulk.capture_len + sizeof(ble_dds_presence_t) > m_l2cap_sdu_max()) &&
+        (bulk_capture_send() != NRF_SUCCESS))
+    {
+        m_bulk.capture_dropped++;
+        return;
+    }
+
+    memcpy(&m_bulk.capture_buf[m_bulk.capture_len], p_presence, sizeof(ble_dds_presence_t));
+    m_bulk.capture_len += sizeof(ble_dds_presence_t);
+}
+
+/**@brief Function for logging the oldest pending windows to flash once there are enough for a record.
+ */
+static void aggregate_log(void)
+{
+    if ((m_agg.pending_count < M_AGG_LOG_BATCH) || (m_agg.window_s < AGGREGATE_LOG_WINDOW_MIN_S))
+    {
+        return;
+    }
+
+    if (m_agg_log_write(m_agg.pending, M_AGG_LOG_BATCH) != NRF_SUCCESS)
+    {
+        // Retried once the log is ready again
+        return;
+    }
+
+    m_agg.pending_count -= M_AGG_LOG_BATCH;
+    memmove(&m_agg.pending[0], &m_agg.pending[M_AGG_LOG_BATCH], m_agg.pending_count * sizeof(agg_stats_window_t));
+}
+
+static void aggregate_log_ready_scheduled(void * p_event_data, uint16_t event_size)
+{
+    aggregate_log();
+    aggregate_flush();
+    bulk_log_flush();
+}
+
+/**@brief Function for retrying what the log refused, executed in fds event context.
+ */
+static void aggregate_log_ready(void)
+{
+    (void)prio_sched_event_put(NULL, 0, aggregate_log_ready_scheduled, PRIO_SCHED_LOW);
+}
+
+/**@brief Function for getting the timestamp of a window ending now.
+ *
+ * @details Before the time is set the timestamp counts from the reset, with the reset count, so
+ *          windows logged before a reset still sort before those after it.
+ */
+static uint32_t aggregate_timestamp(void)
+{
+    if (wall_clock_synced())
+    {
+        return (uint32_t)(wall_clock_now_ms() / 1000);
+    }
+
+    return AGG_STATS_TS_UNSET                                                           |
+           ((uint32_t)(m_agg.boot & AGG_STATS_TS_BOOT_MASK) << AGG_STATS_TS_BOOT_POS)   |
+           ((uint32_t)(wall_clock_uptime_ms() / 1000) & AGG_STATS_TS_UPTIME_MASK);
+}
+
+static void aggregate_window_reset(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < ARRAY_SIZE(m_agg.ir); i++)
+    {
+        agg_stats_reset(&m_agg.ir[i]);
+    }
+
+    agg_stats_reset(&m_agg.range);
+
+    m_agg.elapsed_s = 0;
+}
+
+static void aggregate_presence_add(ble_dds_presence_t const * p_presence)
+{
+    agg_stats_add(&m_agg.ir[0], p_presence->ir1);
+    agg_stats_add(&m_agg.ir[1], p_presence->ir2);
+    agg_stats_add(&m_agg.ir[2], p_presence->ir3);
+    agg_stats_add(&m_agg.ir[3], p_presence->ir4);
+}
+
+/**@brief Function for handling the aggregation tick, closes the window once it is over.
+ */
+static void aggregate_timeout_handler(void * p_context)
+{
+    agg_stats_window_t window;
+    uint8_t            i;
+
+    if (++m_agg.elapsed_s < m_agg.window_s)
+    {
+        return;
+    }
+
+    window.timestamp      = aggregate_timestamp();
+    window.presence_count = m_agg.ir[0].count;
+    window.range_count    = m_agg.range.count;
+
+    for (i = 0; i < ARRAY_SIZE(m_agg.ir); i++)
+    {
+        agg_stats_summary_get(&m_agg.ir[i], &window.summary[i]);
+    }
+
+    agg_stats_summary_get(&m_agg.range, &window.summary[BLE_DDS_AGGREGATE_CHANNELS - 1]);
+
+    aggregate_window_reset();
+
+    if (m_agg.pending_count == ARRAY_SIZE(m_agg.pending))
+    {
+        // Not logged, or the log refused both records
+        memmove(&m_agg.pending[0], &m_agg.pending[1], (m_agg.pending_count - 1) * sizeof(agg_stats_window_t));
+        m_agg.pending_count--;
+
+        NRF_LOG_WARNING("Aggregate window dropped\r\n");
+    }
+
+    m_agg.pending[m_agg.pending_count++] = window;
+
+    aggregate_log();
+    aggregate_flush();
+    bulk_log_flush();
+}
+
+static uint32_t aggregate_start(void)
+{
+    uint32_t err_code;
+
+    aggregate_window_reset();
+
+    if (!m_agg.boot_counted)
+    {
+        m_agg.boot_counted = true;
+
+        (void)m_config_store_load(M_CONFIG_STORE_TAG_AGG_BOOT, &m_agg.boot, sizeof(m_agg.boot));
+        m_agg.boot++;
+
+        err_code = m_config_store_set(M_CONFIG_STORE_TAG_AGG_BOOT, &m_agg.boot, sizeof(m_agg.boot));
+        APP_ERROR_CHECK(err_code);
+    }
+
+    NRF_LOG_INFO("Aggregating over %d s windows\r\n", m_agg.window_s);
+
+    return sample_sched_start(&aggregate_action,
+                              SAMPLE_SCHED_TICKS(AGGREGATE_TICK_MS),
+                              SAMPLE_SCHED_TICKS(AGGREGATE_TICK_MS),
+                              NULL);
+}
+
+/**@brief Function for checking if presence and range are sampled at their set intervals, without motion sessions.
+ */
+static bool sampling_continuous(void)
+{
+    return (m_p_config->sample_mode == SAMPLE_MODE_CONTINUOUS) ||
+           (m_p_config->sample_mode == SAMPLE_MODE_AGGREGATE);
+}
+
+/**@brief Function for exposing the absolute time of the presence and range timestamps, once the time is set.
+ *
+ * @details Samples keep their timestamps relative to the start of sampling, the central adds these.
+ */
+static void time_update(void)
+{
+    uint32_t err_code;
+    uint64_t now_ms = wall_clock_now_ms();
+    uint32_t tick   = hw_timestamp_now();
+
+    m_time.presence_epoch_ms = (wall_clock_synced() && presence_active) ?
+                               now_ms - HW_TIMESTAMP_TO_MS(tick - presence_epoch) : 0;
+    m_time.range_epoch_ms    = (wall_clock_synced() && range_active) ?
+                               now_ms - HW_TIMESTAMP_TO_MS(tick - range_epoch) : 0;
+    m_time.drift_ppm         = wall_clock_drift_ppm();
+
+    err_code = ble_dds_time_set(&m_dds, &m_time);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for starting a motion session.
+ */
+static void session_start(void)
+{
+    uint32_t err_code;
+
+    presence_stop_flag = 0;
+
+    // Samples are notified as they come until the session ends
+    m_conn_policy_demand_set(M_CONN_POLICY_DEMAND_STREAM, true);
+
+    // No flash page is erased while a session is being sampled
+    m_config_store_gc_hold(true);
+
+    // Edges are captured in hardware until the session ends, the RTC stamps them in between
+    hw_timestamp_precise_set(true);
+
+    sample_sched_stop(&preroll_action);
+
+    people_count_session_start(&m_people);
+
+    m_session_start_ms = HW_TIMESTAMP_TO_MS(hw_timestamp_now() - presence_epoch);
+
+    (void)m_ble_broadcast_occupancy_set(true, &m_count);
+
+    // Something is happening, a gateway that lost the link should find the sensor quickly
+    (void)m_ble_advertising_boost();
+
+    // Send what led up to the trigger ahead of the live stream
+    history_flush();
+
+    //Start action to drive ak sampling when motion is detected
+    err_code = sample_sched_start(&presence_action,
+                                  SAMPLE_SCHED_TICKS(m_p_config->presence_interval_ms),
+                                  SAMPLE_SCHED_TICKS(m_p_config->presence_interval_ms),
+                                  NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for taking a range reading outside of a session, not notified.
+ */
+static void range_probe(void)
+{
+    uint32_t err_code;
+
+    m_range_probe = true;
+
+    err_code = sample_sched_start(&range_action, 0, 0, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for getting the range background as exposed to the peer.
+ */
+static void range_bg_value_get(ble_dds_range_bg_t * p_value)
+{
+    bool learned = range_bg_learned(&m_range_bg.model);
+
+    p_value->flags         = m_range_bg.flags;
+    p_value->margin_mm     = m_range_bg.margin_mm;
+    p_value->background_mm = learned ? (uint16_t)lroundf(m_range_bg.model.mean) : 0;
+    p_value->stddev_mm     = learned ? (uint16_t)lroundf(sqrtf(m_range_bg.model.var)) : 0;
+}
+
+/**@brief Function for exposing the range background to the peer and storing it.
+ */
+static void range_bg_save(void)
+{
+    ble_dds_range_bg_t value;
+
+    range_bg_value_get(&value);
+    (void)ble_dds_range_bg_set(&m_dds, &value);
+
+    if (m_config_store_set(M_CONFIG_STORE_TAG_RANGE_BG, &m_range_bg, sizeof(m_range_bg)) == NRF_SUCCESS)
+    {
+        m_range_bg_saved_mm = m_range_bg.model.mean;
+    }
+}
+
+/**@brief Function for classifying a range reading against the background, which is stored when it moved.
+ *
+ * @retval true if the reading is in front of the background.
+ */
+static bool range_foreground(uint16_t range_mm)
+{
+    bool learned    = range_bg_learned(&m_range_bg.model);
+    bool foreground = range_bg_update(&m_range_bg.model, range_mm, m_range_bg.margin_mm);
+
+    if (range_bg_learned(&m_range_bg.model) &&
+        (!learned || (fabsf(m_range_bg.model.mean - m_range_bg_saved_mm) >= RANGE_BG_SAVE_DELTA_MM)))
+    {
+        NRF_LOG_INFO("Range background: %d mm\r\n", (int)m_range_bg.model.mean);
+        range_bg_save();
+    }
+
+    return foreground;
+}
 
 /**@brief Pressure sensor event handler.
  */
@@ -33,36 +786,133 @@ static void drv_presence_evt_handler(drv_presence_evt_t const * p_event)
         {
             if(p_event->mode == SAMPLE_MODE_MOTION)
             {
-                presence_stop_flag = 0;
+                if ((m_range_bg.flags & BLE_DDS_RANGE_BG_GATE_MOTION) &&
+                    range_active                                      &&
+                    range_bg_learned(&m_range_bg.model))
+                {
+                    // The AK9750 alone does not start a session, someone has to be in range too
+                    m_gate_waiting = true;
+                    range_probe();
+                }
+                else
+                {
+                    session_start();
+                }
+            }
+        }
+        break;
+
+        case DRV_PRESENCE_EVT_BATCH:
+        {
+            uint32_t now_ms = HW_TIMESTAMP_TO_MS(hw_timestamp_now() - presence_epoch);
 
-                //Start Timer to drive ak sampling when motion is detect_ble_evt_disconnected
-                app_timer_start(presence_timer_id,
-                        APP_TIMER_TICKS(m_p_config->presence_interval_ms),
-                        NULL);
+            for (uint8_t i = 0; i < p_event->batch_len; i++)
+            {
+                ble_dds_presence_t presence = p_event->p_batch[i];
+                uint32_t           age_ms   = (p_event->batch_len - 1 - i) * m_p_config->presence_interval_ms;
+
+                // Samples are spaced by the RTC, the batch ends about now
+                presence.timestamp = (now_ms > age_ms) ? (now_ms - age_ms) : 0;
+
+                bulk_capture_add(&presence);
+
+                if (m_p_config->sample_mode == SAMPLE_MODE_AGGREGATE)
+                {
+                    aggregate_presence_add(&presence);
+                    continue;
+                }
+
+                presence.marker    = presence_start_flag ? 0 : 1;
+                presence_start_flag = 1;
+
+                history_push(&presence, HISTORY_SIZE);
             }
+
+            history_flush();
         }
         break;
 
         case DRV_PRESENCE_EVT_MOTION_STOP:
         {
+            if (m_gate_waiting)
+            {
+                // Nothing came in front of the background, it was not a session
+                m_gate_waiting = false;
+                break;
+            }
+
             presence_stop_flag = 1;
 
             // reset start flag
             range_start_flag = 0;
             presence_start_flag = 0;
 
-            err_code = app_timer_stop(presence_timer_id);
-            APP_ERROR_CHECK(err_code);
-        }
-        break;
+            sample_sched_stop(&presence_action);
+
+            history_flush();
+
+            if (m_dds.is_presence_stream_notif_enabled)
+            {
+                // Do not hold the end of the session back waiting for more samples
+                stream_flush(true);
+            }
+
+            count_session_end();
+
+            m_conn_policy_demand_set(M_CONN_POLICY_DEMAND_STREAM, false);
+            m_config_store_gc_hold(false);
+            hw_timestamp_precise_set(false);
+
+            err_code = sample_sched_start(&preroll_action,
+                                          SAMPLE_SCHED_TICKS(PREROLL_INTERVAL_MS),
+                                          SAMPLE_SCHED_TICKS(PREROLL_INTERVAL_MS),
+                                          NULL);
+            APP_ERROR_CHECK(err_code);
+        }
+        break;
+
+        case DRV_PRESENCE_EVT_ERROR:
+            APP_ERROR_CHECK_BOOL(false);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**@brief Function for deciding if a range reading is notified, and marking it.
+ *
+ * @details Readings within the deadband of the last notified one are dropped until the heartbeat
+ *          is due, so the peer can hold the last value in between.
+ */
+static bool range_report_due(ble_dds_range_t * p_range)
+{
+    ble_dds_range_report_config_t const * p_report = &m_p_config->range_report;
+
+    // If this is the first sampling of the session, mark it
+    if (!range_start_flag)
+    {
+        range_start_flag = 1;
+        p_range->marker  = 1;
+        return true;
+    }
+
+    p_range->marker = 0;
 
-        case DRV_PRESENCE_EVT_ERROR:
-            APP_ERROR_CHECK_BOOL(false);
-            break;
+    if ((p_report->deadband_mm == 0) ||
+        (abs((int32_t)p_range->range - (int32_t)m_range_sent.range) > p_report->deadband_mm))
+    {
+        return true;
+    }
 
-        default:
-            break;
+    if ((p_report->heartbeat_s > 0) &&
+        (p_range->timestamp - m_range_sent.timestamp >= p_report->heartbeat_s * 1000UL))
+    {
+        p_range->marker = BLE_DDS_MARKER_HEARTBEAT;
+        return true;
     }
+
+    return false;
 }
 
 /**@brief Pressure sensor event handler.
@@ -76,26 +926,48 @@ static void drv_range_evt_handler(drv_range_evt_t const * p_event)
         {
             {
                 ble_dds_range_t range;
+                bool            foreground;
 
                 // Always need to read register in order to range again
                 drv_range_get(&range);
 
-                if (!presence_stop_flag)
+                foreground = range_foreground(range.range);
+
+                if (m_range_probe)
                 {
-                    // If this is the first sampling of the session, mark it
-                    if(!range_start_flag)
+                    m_range_probe = false;
+
+                    if (m_gate_waiting && foreground)
                     {
-                        range_start_flag = 1;
-                        range.marker = 1;
+                        NRF_LOG_INFO("Motion confirmed at %d mm\r\n", range.range);
+
+                        m_gate_waiting = false;
+                        session_start();
                     }
-                    else
+                }
+                else if (m_p_config->sample_mode == SAMPLE_MODE_AGGREGATE)
+                {
+                    agg_stats_add(&m_agg.range, (int16_t)MIN(range.range, INT16_MAX));
+                }
+                else if (!presence_stop_flag)
+                {
+                    // Time of the data ready edge, captured in hardware
+                    range.timestamp = HW_TIMESTAMP_TO_MS(p_event->tick - range_epoch);
+
+                    people_count_range(&m_people, range.range);
+
+                    // Until the background is learned every reading is forwarded
+                    if ((!(m_range_bg.flags & BLE_DDS_RANGE_BG_FOREGROUND_ONLY) ||
+                         !range_bg_learned(&m_range_bg.model)                   ||
+                         foreground)                                            &&
+                        range_report_due(&range))
                     {
-                        range.marker = 0;
+                        TLOG(TLOG_MODULE_DETECTION, "Range Timestamp: %d\r\n", range.timestamp);
+                        if (ble_dds_range_set(&m_dds, &range) == NRF_SUCCESS)
+                        {
+                            m_range_sent = range;
+                        }
                     }
-                    
-                    NRF_LOG_INFO("Range Timestamp: %d \n", range_timestamp);
-                    range.timestamp = range_timestamp;
-                    (void)ble_dds_range_set(&m_dds, &range);
                 }
 
                 range_read = true;
@@ -118,6 +990,7 @@ static void drv_range_evt_handler(drv_range_evt_t const * p_event)
  */
 static void presence_timeout_handler(void * p_context)
 {
+    uint32_t           err_code;
     ble_dds_presence_t presence;
 
     // If this is the first sampling of the session, mark it
@@ -131,237 +1004,652 @@ static void presence_timeout_handler(void * p_context)
         presence.marker = 0;
     }
 
-    drv_presence_get(&presence);
-    NRF_LOG_INFO("Presence Timestamp: %d \n", presence_timestamp);
-    presence.timestamp = presence_timestamp;
-    (void)ble_dds_presence_set(&m_dds, &presence);
-
-    if(m_p_config->sample_mode == SAMPLE_MODE_MOTION)
+    drv_presence_get(&presence);
+    presence.timestamp = HW_TIMESTAMP_TO_MS(hw_timestamp_now() - presence_epoch);
+    TLOG(TLOG_MODULE_DETECTION, "Presence Timestamp: %d\r\n", presence.timestamp);
+
+    bulk_capture_add(&presence);
+
+    if(m_p_config->sample_mode == SAMPLE_MODE_MOTION)
+    {
+        people_count_sample(&m_people, &presence);
+
+        // Keeps the order with the pre-roll and any sample still waiting for a TX buffer
+        history_push(&presence, HISTORY_SIZE);
+        history_flush();
+
+        // Range once per presence sample, unless the last ranging is still running
+        if (range_active)
+        {
+            err_code = sample_sched_start(&range_action, 0, 0, NULL);
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+    else if (m_p_config->sample_mode == SAMPLE_MODE_AGGREGATE)
+    {
+        aggregate_presence_add(&presence);
+    }
+    else if (m_dds.is_presence_stream_notif_enabled)
+    {
+        history_push(&presence, HISTORY_SIZE);
+        history_flush();
+    }
+    else
+    {
+        (void)ble_dds_presence_set(&m_dds, &presence);
+    }
+}
+
+/**@brief Function for handling the pre-roll timer timeout event.
+ *
+ * @details Keeps the last PREROLL_SAMPLES presence samples while waiting for motion.
+ */
+static void preroll_timeout_handler(void * p_context)
+{
+    ble_dds_presence_t presence;
+
+    drv_presence_get(&presence);
+    presence.timestamp = HW_TIMESTAMP_TO_MS(hw_timestamp_now() - presence_epoch);
+    presence.marker    = BLE_DDS_MARKER_PREROLL;
+
+    history_push(&presence, PREROLL_SAMPLES);
+
+    // Anything left from the session is pre-roll now, it is sent with the next one
+    m_conn_policy_demand_set(M_CONN_POLICY_DEMAND_BACKLOG, false);
+
+    people_count_idle(&m_people, &presence);
+
+    // Idle readings are what the background is, and the motion gate polls until someone is in range
+    if (range_active && (m_gate_waiting                           ||
+                         !range_bg_learned(&m_range_bg.model)     ||
+                         (++m_idle_ticks >= RANGE_BG_IDLE_PROBE_MS / PREROLL_INTERVAL_MS)))
+    {
+        m_idle_ticks = 0;
+        range_probe();
+    }
+}
+
+/**@brief Function for handling pressure timer timout event.
+ *
+ * @details This function will read the pressure at the configured rate.
+ */
+static void range_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+
+    // If ranger has completed a ranging and we have gotten the data,
+    // initiate another sampling, otherwise skip this slot
+    if (range_read)
+    {
+        err_code = drv_range_sample();
+        APP_ERROR_CHECK(err_code); 
+        range_read = false;
+    }
+}
+
+/**@brief Function for choosing how continuous presence is sampled.
+ *
+ * @details Autonomous acquisition holds the TWI bus, so it is only used while the VL53L0X is off.
+ *          Otherwise presence_action polls the sensor.
+ */
+static uint32_t presence_source_set(bool autonomous)
+{
+    uint32_t err_code;
+
+    autonomous = autonomous && !range_active;
+
+    if (!presence_continuous || (autonomous == presence_auto))
+    {
+        return NRF_SUCCESS;
+    }
+
+    presence_auto = autonomous;
+
+    if (autonomous)
+    {
+        sample_sched_stop(&presence_action);
+
+        return drv_presence_auto_start(m_p_config->presence_interval_ms, PRESENCE_AUTO_BATCH_LEN);
+    }
+
+    err_code = drv_presence_auto_stop();
+    APP_ERROR_CHECK(err_code);
+
+    return sample_sched_start(&presence_action,
+                              SAMPLE_SCHED_TICKS(m_p_config->presence_interval_ms),
+                              SAMPLE_SCHED_TICKS(m_p_config->presence_interval_ms),
+                              NULL);
+}
+
+/**@brief Function for stopping pressure sampling.
+ */
+static uint32_t presence_stop(void)
+{
+    // reset start flag
+    presence_start_flag = 0;
+
+    presence_active = false;
+
+    m_gate_waiting = false;
+
+    m_conn_policy_demand_set(M_CONN_POLICY_DEMAND_STREAM, false);
+    m_conn_policy_demand_set(M_CONN_POLICY_DEMAND_BACKLOG, false);
+    m_config_store_gc_hold(false);
+
+    (void)m_ble_broadcast_occupancy_set(false, &m_count);
+
+    presence_continuous = false;
+    presence_auto       = false;
+
+    sample_sched_stop(&presence_action);
+
+    hw_timestamp_precise_set(false);
+
+    sample_sched_stop(&preroll_action);
+
+    history_reset();
+
+    return drv_presence_disable();
+}
+
+/**@brief Function for stopping pressure sampling.
+ */
+static uint32_t range_stop(void)
+{
+    uint32_t err_code;
+
+    // reset start flag
+    range_start_flag = 0;
+
+    sample_sched_stop(&range_action);
+
+    m_range_probe = false;
+
+    if (m_gate_waiting)
+    {
+        // Without the range the AK9750 trigger decides alone
+        m_gate_waiting = false;
+        session_start();
+    }
+
+    err_code = drv_range_disable();
+    APP_ERROR_CHECK(err_code);
+
+    range_active = false;
+
+    // The bus is free again
+    return presence_source_set(true);
+}
+
+/**@brief Function for aborting or ending the threshold calibration.
+ */
+static uint32_t calib_stop(void)
+{
+    m_calib.active = false;
+
+    sample_sched_stop(&calib_action);
+
+    return drv_presence_disable();
+}
+
+uint32_t m_detection_stop(void)
+{
+    uint32_t err_code;
+
+    if (m_calib.active)
+    {
+        err_code = calib_stop();
+        APP_ERROR_CHECK(err_code);
+
+        // Aborted, expose the stored configuration again instead of the calibration request
+        err_code = ble_dds_config_set(&m_dds, m_p_config);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    // Aggregation keeps running and logs while disconnected, motion detection keeps broadcasting
+    if ((m_p_config->sample_mode != SAMPLE_MODE_AGGREGATE) && !broadcast_sampling())
+    {
+        err_code = presence_stop();
+        APP_ERROR_CHECK(err_code);
+    }
+
+    return NRF_SUCCESS;
+}
+
+/**@brief Function for starting pressure sampling.
+ */
+static uint32_t presence_start(void)
+{
+    uint32_t         err_code;
+    ble_dds_config_t drv_config = *m_p_config;
+
+    // The driver samples aggregation like continuous streaming
+    if (sampling_continuous())
+    {
+        drv_config.sample_mode = SAMPLE_MODE_CONTINUOUS;
+    }
+
+    err_code = drv_presence_enable(&drv_config);
+    APP_ERROR_CHECK(err_code);
+
+    presence_active = true;
+
+    // Timestamps are ms from here
+    presence_epoch = hw_timestamp_now();
+    time_update();
+
+    if(sampling_continuous())
+    {     
+        if (presence_continuous)
+        {
+            return NRF_SUCCESS;
+        }
+
+        presence_continuous = true;
+
+        history_reset();
+
+        // Aggregation only notifies a few records per window
+        m_conn_policy_demand_set(M_CONN_POLICY_DEMAND_STREAM, m_p_config->sample_mode == SAMPLE_MODE_CONTINUOUS);
+        hw_timestamp_precise_set(m_p_config->sample_mode == SAMPLE_MODE_CONTINUOUS);
+
+        err_code = sample_sched_start(&presence_action,
+                                      SAMPLE_SCHED_TICKS(m_p_config->presence_interval_ms),
+                                      SAMPLE_SCHED_TICKS(m_p_config->presence_interval_ms),
+                                      NULL);
+        APP_ERROR_CHECK(err_code);
+
+        return presence_source_set(true);
+    }
+    else if(m_p_config->sample_mode == SAMPLE_MODE_MOTION)
+    {
+        history_reset();
+
+        return sample_sched_start(&preroll_action,
+                                  SAMPLE_SCHED_TICKS(PREROLL_INTERVAL_MS),
+                                  SAMPLE_SCHED_TICKS(PREROLL_INTERVAL_MS),
+                                  NULL);
+    }
+
+    //NRF_LOG_RAW_INFO("\r########## presence_intervale_ms: %d  \n", m_default_config.presence_interval_ms);
+          
+    return NRF_SUCCESS;  
+}
+
+/**@brief Function for storing the configuration, copied to m_p_config first if it is another one.
+ */
+static uint32_t config_store(ble_dds_config_t const * p_config)
+{
+    if (p_config != m_p_config)
+    {
+        *m_p_config = *p_config;
+    }
+
+    return m_config_store_set(M_CONFIG_STORE_TAG_DETECTION, m_p_config, sizeof(ble_dds_config_t));
+}
+
+/**@brief Function for starting pressure sampling.
+ */
+static uint32_t range_start(void)
+{
+    uint32_t err_code;
+
+    // Presence has to share the bus from now on
+    range_active = true;
+
+    err_code = presence_source_set(false);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = drv_range_enable();
+    APP_ERROR_CHECK(err_code);
+
+    // Timestamps are ms from here
+    range_epoch = hw_timestamp_now();
+    time_update();
+
+    if(sampling_continuous())
+    {
+        range_read = true;
+
+        // Range half way between presence samples so the two never queue on the TWI bus
+        err_code = sample_sched_start_aligned(&range_action,
+                                              &presence_action,
+                                              SAMPLE_SCHED_TICKS(m_p_config->presence_interval_ms) / 2,
+                                              SAMPLE_SCHED_TICKS(m_p_config->range_interval_ms),
+                                              NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+    else if(m_p_config->sample_mode == SAMPLE_MODE_MOTION)
+    {
+        range_read = true;
+    }
+    
+
+    //NRF_LOG_RAW_INFO("\r########## range_intervale_ms: %d  \n", m_default_config.range_interval_ms);  
+
+    return NRF_SUCCESS;              
+}
+
+static uint32_t config_verify(ble_dds_config_t * p_config)
+{
+    uint32_t err_code;
+
+    if (det_config_verify(p_config, &m_default_config))
+    {
+        err_code = config_store(p_config);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    return NRF_SUCCESS;
+}
+
+/**@brief Function for applying the configuration.
+ *
+ */
+static uint32_t config_apply(ble_dds_config_t * p_config)
+{
+    uint32_t err_code;
+
+    VERIFY_PARAM_NOT_NULL(p_config);
+
+    bool aggregate = (p_config->sample_mode == SAMPLE_MODE_AGGREGATE);
+
+    (void)presence_stop();
+    (void)range_stop();
+
+    sample_sched_stop(&aggregate_action);
+
+     if ((p_config->presence_interval_ms > 0) &&
+        (presence_wanted() || aggregate))
+    {
+        err_code = presence_start();
+        APP_ERROR_CHECK(err_code);
+    }
+
+    if ((p_config->range_interval_ms > 0) &&
+        (presence_notif_enabled() || aggregate))
+    {
+        err_code = range_start();
+        APP_ERROR_CHECK(err_code);
+    }
+
+    if (aggregate)
     {
-        // Start range timer that will repeatedly attempt to 
-        // start another ranging when the last finishes
-        app_timer_start(range_timer_id,
-                            APP_TIMER_TICKS(1),
-                            NULL);
+        err_code = aggregate_start();
+        APP_ERROR_CHECK(err_code);
     }
+
+    return NRF_SUCCESS;
 }
 
-/**@brief Function for handling pressure timer timout event.
+
+static void calib_stats_add(calib_stats_t * p_stats, uint32_t n, int32_t value)
+{
+    float delta = (float)value - p_stats->mean;
+
+    p_stats->mean += delta / n;
+    p_stats->m2   += delta * ((float)value - p_stats->mean);
+}
+
+/**@brief Function for turning the measured noise into a threshold pair around the baseline.
  *
- * @details This function will read the pressure at the configured rate.
+ * @details The IR differential noise is taken as Gaussian. The threshold is the smallest multiple
+ *          of sigma at which the expected number of exceedances per day, over both thresholds of
+ *          both differentials, stays below the requested false wake rate.
  */
-static void range_timeout_handler(void * p_context)
+static int16_t calib_threshold(calib_stats_t const * p_stats, uint32_t samples, float sigmas)
 {
-    uint32_t err_code;
+    float threshold = sigmas * sqrtf(p_stats->m2 / (samples - 1));
 
-    // If ranger has completed a ranging and we have gotten the data,
-    // initiate another sampling
-    if (range_read)
+    if (threshold < CALIB_THRESHOLD_MIN)
     {
-        err_code = drv_range_sample();
-        APP_ERROR_CHECK(err_code); 
-        range_read = false;
-
-        if(m_p_config->sample_mode == SAMPLE_MODE_MOTION)
-        {
-            err_code = app_timer_stop(range_timer_id);
-            APP_ERROR_CHECK(err_code);
-        }
+        return CALIB_THRESHOLD_MIN;
     }
-}
 
-static void range_timestamp_timeout_handler(void * p_context)
-{
-    if (range_timestamp > 4294967290)
+    if (threshold > BLE_DDS_CONFIG_THRESHOLD_MAX)
     {
-        range_timestamp = 0;
+        return BLE_DDS_CONFIG_THRESHOLD_MAX;
     }
-    range_timestamp++;
-}
 
-static void reset_range_timestamp(void)
-{
-    range_timestamp = 0;
+    return (int16_t)lroundf(threshold);
 }
 
-static void presence_timestamp_timeout_handler(void * p_context)
+static float calib_sigmas(uint8_t false_wakes_per_day)
 {
-    if (presence_timestamp > 4294967290)
+    float evals_per_day = 86400.0f * CALIB_AK9750_EVAL_RATE_HZ * 4;
+    float p_target      = false_wakes_per_day / evals_per_day;
+    float sigmas;
+
+    for (sigmas = CALIB_SIGMA_MIN; sigmas < CALIB_SIGMA_MAX; sigmas += CALIB_SIGMA_STEP)
     {
-        presence_timestamp = 0;
+        if (0.5f * erfcf(sigmas / (float)M_SQRT2) <= p_target)
+        {
+            break;
+        }
     }
-    presence_timestamp++;
-}
 
-static void reset_presence_timestamp(void)
-{
-    presence_timestamp = 0;
+    return sigmas;
 }
 
-/**@brief Function for stopping pressure sampling.
- */
-static uint32_t presence_stop(void)
+static void calib_finish(void)
 {
-    uint32_t err_code;
+    uint32_t           err_code;
+    ble_dds_config_t * p_config = &m_calib.config;
+    uint32_t           n        = m_calib.samples;
+    float              sigmas   = calib_sigmas(p_config->calibration.false_wakes_per_day);
+    int16_t            th13     = calib_threshold(&m_calib.ir13, n, sigmas);
+    int16_t            th24     = calib_threshold(&m_calib.ir24, n, sigmas);
+    ble_dds_presence_t baseline;
+
+    err_code = calib_stop();
+    APP_ERROR_CHECK(err_code);
 
-    // reset start flag
-    presence_start_flag = 0;
+    baseline.ir1 = m_calib.ir_sum[0] / (int32_t)n;
+    baseline.ir2 = m_calib.ir_sum[1] / (int32_t)n;
+    baseline.ir3 = m_calib.ir_sum[2] / (int32_t)n;
+    baseline.ir4 = m_calib.ir_sum[3] / (int32_t)n;
+
+    p_config->threshold_config.eth13h =  th13;
+    p_config->threshold_config.eth13l = -th13;
+    p_config->threshold_config.eth24h =  th24;
+    p_config->threshold_config.eth24l = -th24;
+
+    NRF_LOG_INFO("Calibrated over %d samples, sigmas x10: %d, ETH13: %d ETH24: %d\r\n",
+                 n, (int)(sigmas * 10), th13, th24);
 
-    err_code = app_timer_stop(presence_timer_id);
+    // Thresholds are relative to the idle baseline measured during the calibration
+    drv_presence_baseline_seed(&baseline);
+
+    err_code = config_store(p_config);
     APP_ERROR_CHECK(err_code);
 
-    err_code = app_timer_stop(presence_timestamp_timer_id);
+    err_code = ble_dds_config_set(&m_dds, m_p_config);
     APP_ERROR_CHECK(err_code);
 
-    return drv_presence_disable();
+    err_code = config_apply(m_p_config);
+    APP_ERROR_CHECK(err_code);
 }
 
-/**@brief Function for stopping pressure sampling.
+/**@brief Function for handling the calibration timer timeout event.
+ *
+ * @details Samples the idle IR1-IR3 and IR2-IR4 differentials over the calibration window.
  */
-static uint32_t range_stop(void)
+static void calib_timeout_handler(void * p_context)
 {
-    uint32_t err_code;
-
-    // reset start flag
-    range_start_flag = 0;
+    uint32_t           err_code;
+    ble_dds_presence_t presence;
 
-    err_code = app_timer_stop(range_timer_id);
-    APP_ERROR_CHECK(err_code);
+    if (!m_calib.active)
+    {
+        return;
+    }
 
-    err_code = app_timer_stop(range_timestamp_timer_id);
+    err_code = drv_presence_get(&presence);
     APP_ERROR_CHECK(err_code);
 
-    return drv_range_disable();
-}
+    m_calib.samples++;
 
-uint32_t m_detection_stop(void)
-{
-    uint32_t err_code;
+    m_calib.ir_sum[0] += presence.ir1;
+    m_calib.ir_sum[1] += presence.ir2;
+    m_calib.ir_sum[2] += presence.ir3;
+    m_calib.ir_sum[3] += presence.ir4;
 
-    err_code = presence_stop();
-    APP_ERROR_CHECK(err_code);
+    calib_stats_add(&m_calib.ir13, m_calib.samples, presence.ir1 - presence.ir3);
+    calib_stats_add(&m_calib.ir24, m_calib.samples, presence.ir2 - presence.ir4);
 
-    return NRF_SUCCESS;
+    if (m_calib.samples >= m_calib.samples_total)
+    {
+        calib_finish();
+    }
 }
 
-/**@brief Function for starting pressure sampling.
+/**@brief Function for starting the threshold calibration.
+ *
+ * @details The room must be empty for the calibration window. Sampling runs continuously and
+ *          nothing is notified. Once done the configuration is stored in motion mode with the
+ *          derived thresholds and applied.
  */
-static uint32_t presence_start(void)
+static uint32_t calib_start(ble_dds_config_t const * p_config)
 {
     uint32_t err_code;
 
-    err_code = drv_presence_enable(m_p_config);
-    APP_ERROR_CHECK(err_code);
-
-    // Start the timestamp timer
-    app_timer_start(presence_timestamp_timer_id,
-                        APP_TIMER_TICKS(1),
-                        NULL);
+    (void)presence_stop();
+    (void)range_stop();
 
-    // Reset the timestamp counter
-    reset_presence_timestamp();
+    sample_sched_stop(&aggregate_action);
 
-    if(m_p_config->sample_mode == SAMPLE_MODE_CONTINUOUS)
-    {     
-        return app_timer_start(presence_timer_id,
-                        APP_TIMER_TICKS(m_p_config->presence_interval_ms),
-                        NULL);    
+    if (m_calib.active)
+    {
+        (void)calib_stop();
     }
 
-    //NRF_LOG_RAW_INFO("\r########## presence_intervale_ms: %d  \n", m_default_config.presence_interval_ms);
-          
-    return NRF_SUCCESS;  
+    memset(&m_calib, 0, sizeof(m_calib));
+
+    m_calib.config               = *p_config;
+    m_calib.config.sample_mode   = SAMPLE_MODE_CONTINUOUS;
+    m_calib.samples_total        = MAX(2, (uint32_t)p_config->calibration.window_s * 1000 /
+                                          p_config->presence_interval_ms);
+
+    NRF_LOG_INFO("Calibrating thresholds for %d s\r\n", p_config->calibration.window_s);
+
+    err_code = drv_presence_enable(&m_calib.config);
+    APP_ERROR_CHECK(err_code);
+
+    // The calibrated configuration is stored in motion mode
+    m_calib.config.sample_mode = SAMPLE_MODE_MOTION;
+    m_calib.active             = true;
+
+    return sample_sched_start(&calib_action,
+                              SAMPLE_SCHED_TICKS(p_config->presence_interval_ms),
+                              SAMPLE_SCHED_TICKS(p_config->presence_interval_ms),
+                              NULL);
 }
 
-/**@brief Function for starting pressure sampling.
+/**@brief Function for starting or stopping presence sampling after a capture started or ended.
  */
-static uint32_t range_start(void)
+static void bulk_presence_update(void)
 {
     uint32_t err_code;
 
-    err_code = drv_range_enable();
-    APP_ERROR_CHECK(err_code);
+    if ((m_p_config->sample_mode == SAMPLE_MODE_AGGREGATE) ||
+        (presence_wanted() == presence_active))
+    {
+        return;
+    }
+
+    if (presence_wanted())
+    {
+        err_code = presence_start();
+        APP_ERROR_CHECK(err_code);
+    }
+    else
+    {
+        err_code = presence_stop();
+        APP_ERROR_CHECK(err_code);
+    }
+}
 
-    // Start the timestamp timer
-    app_timer_start(range_timestamp_timer_id,
-                        APP_TIMER_TICKS(1),
-                        NULL);
+static void bulk_cmd_scheduled(void * p_event_data, uint16_t event_size)
+{
+    uint8_t cmd = *(uint8_t const *)p_event_data;
 
-    // Reset the timestamp counter
-    reset_range_timestamp();
+    NRF_LOG_INFO("Bulk command: %d\r\n", cmd);
 
-    if(m_p_config->sample_mode == SAMPLE_MODE_CONTINUOUS)
+    switch (cmd)
     {
-        range_read = true;
+        case BULK_CMD_LOG:
+            m_bulk.log = true;
+            bulk_log_flush();
+            break;
 
-        err_code = drv_range_sample();
-        APP_ERROR_CHECK(err_code);
+        case BULK_CMD_CAPTURE_START:
+            m_bulk.capture_buf[0]  = BULK_SDU_SAMPLES;
+            m_bulk.capture_len     = 1;
+            m_bulk.capture_dropped = 0;
+            m_bulk.capture         = true;
+            bulk_presence_update();
+            break;
+
+        case BULK_CMD_CAPTURE_STOP:
+            NRF_LOG_INFO("Capture stopped, %d samples dropped\r\n", m_bulk.capture_dropped);
+
+            // What is left goes out now or once a TX buffer is free
+            m_bulk.capture = false;
+            (void)bulk_capture_send();
+            bulk_presence_update();
+            break;
 
-        app_timer_start(range_timer_id,
-                            APP_TIMER_TICKS(1),
-                            NULL);  
+        default:
+            break;
     }
-    else if(m_p_config->sample_mode == SAMPLE_MODE_MOTION)
+}
+
+static void bulk_tx_done_scheduled(void * p_event_data, uint16_t event_size)
+{
+    if (!m_bulk.capture || (m_bulk.capture_len + sizeof(ble_dds_presence_t) > m_l2cap_sdu_max()))
     {
-        range_read = true;
+        (void)bulk_capture_send();
     }
-    
-
-    //NRF_LOG_RAW_INFO("\r########## range_intervale_ms: %d  \n", m_default_config.range_interval_ms);  
 
-    return NRF_SUCCESS;              
+    bulk_log_flush();
 }
 
-static uint32_t config_verify(ble_dds_config_t * p_config)
+static void bulk_closed_scheduled(void * p_event_data, uint16_t event_size)
 {
-    uint32_t err_code;
-
-    if ( (p_config->presence_interval_ms < BLE_DDS_CONFIG_PRESENCE_INT_MIN)            ||
-         (p_config->presence_interval_ms > BLE_DDS_CONFIG_PRESENCE_INT_MAX)            ||
-         (p_config->range_interval_ms < BLE_DDS_CONFIG_RANGE_INT_MIN)                  ||
-         (p_config->range_interval_ms > BLE_DDS_CONFIG_RANGE_INT_MAX)                  ||
-         (p_config->threshold_config.eth13h < BLE_DDS_CONFIG_THRESHOLD_MIN)            ||
-         (p_config->threshold_config.eth13l > BLE_DDS_CONFIG_THRESHOLD_MAX)            ||
-         (p_config->threshold_config.eth24h < BLE_DDS_CONFIG_THRESHOLD_MIN)            ||
-         ((int)p_config->threshold_config.eth24l > (int)BLE_DDS_CONFIG_THRESHOLD_MAX))
-    {
-        err_code = m_det_flash_config_store((ble_dds_config_t *)&m_default_config);
-        APP_ERROR_CHECK(err_code);
-    }   
+    m_bulk.log         = false;
+    m_bulk.capture     = false;
+    m_bulk.capture_len = 0;
 
-    return NRF_SUCCESS;
+    bulk_presence_update();
 }
 
-/**@brief Function for applying the configuration.
- *
+/**@brief Function for handling the bulk channel events, in the SoftDevice event interrupt.
  */
-static uint32_t config_apply(ble_dds_config_t * p_config)
+static void bulk_l2cap_evt_handler(m_l2cap_evt_t const * p_evt)
 {
-    uint32_t err_code;
-
-    VERIFY_PARAM_NOT_NULL(p_config);
+    switch (p_evt->type)
+    {
+        case M_L2CAP_EVT_RX:
+            if (p_evt->length > 0)
+            {
+                // The first byte is the command, the buffer goes back to the SoftDevice
+                (void)prio_sched_event_put(p_evt->p_data, 1, bulk_cmd_scheduled, PRIO_SCHED_LOW);
+            }
+            break;
 
-    (void)presence_stop();
-    (void)range_stop();
+        case M_L2CAP_EVT_TX_DONE:
+            (void)prio_sched_event_put(NULL, 0, bulk_tx_done_scheduled, PRIO_SCHED_LOW);
+            break;
 
-     if ((p_config->presence_interval_ms > 0) &&
-        (m_dds.is_presence_notif_enabled) )
-    {
-        err_code = presence_start();
-        APP_ERROR_CHECK(err_code);
-    }
+        case M_L2CAP_EVT_CLOSED:
+            (void)prio_sched_event_put(NULL, 0, bulk_closed_scheduled, PRIO_SCHED_LOW);
+            break;
 
-    if ((p_config->range_interval_ms > 0) &&
-        (m_dds.is_presence_notif_enabled) )
-    {
-        err_code = range_start();
-        APP_ERROR_CHECK(err_code);
+        default:
+            break;
     }
-
-    return NRF_SUCCESS;
 }
 
-
 /**@brief Function for passing the BLE event to the Thingy Environment service.
  *
  * @details This callback function will be called from the BLE handling module.
@@ -374,8 +1662,15 @@ static void detection_on_ble_evt(ble_evt_t const * p_ble_evt)
 
     ble_dds_on_ble_evt(&m_dds, p_ble_evt);
 
-    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    if ((p_ble_evt->header.evt_id == BLE_GATTS_EVT_HVN_TX_COMPLETE) && (m_agg.tx_count > 0))
+    {
+        // Aggregation windows were waiting for a TX buffer
+        (void)prio_sched_event_put(NULL, 0, aggregate_flush_scheduled, PRIO_SCHED_LOW);
+    }
+
+    if ((p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED) && !ble_dds_connected(&m_dds))
     {
+        // Calibration is aborted once no central is left to finish it
         //NRF_LOG_INFO("DETECTION ON BLE EVT \r\n");
         uint32_t err_code;
         err_code = m_detection_stop();
@@ -403,8 +1698,31 @@ static void ble_dds_evt_handler( ble_dds_t        * p_dds,
     switch (evt_type)
     {
         case BLE_DDS_EVT_NOTIF_PRESENCE:
-            NRF_LOG_INFO("tes_evt_handler: BLE_TES_EVT_NOTIF_PRESENCE: %d\r\n", p_dds->is_presence_notif_enabled);
-            if (p_dds->is_presence_notif_enabled)
+        case BLE_DDS_EVT_NOTIF_PRESENCE_STREAM:
+        case BLE_DDS_EVT_NOTIF_COUNT:
+        {
+            NRF_LOG_INFO("tes_evt_handler: BLE_TES_EVT_NOTIF_PRESENCE: %d stream: %d count: %d\r\n",
+                         p_dds->is_presence_notif_enabled,
+                         p_dds->is_presence_stream_notif_enabled,
+                         p_dds->is_count_notif_enabled);
+
+            if ((evt_type == BLE_DDS_EVT_NOTIF_PRESENCE_STREAM) && p_dds->is_presence_stream_notif_enabled)
+            {
+                // The stream has to start with a keyframe, also for a central joining the others.
+                // What they have not received yet goes out first.
+                (void)stream_send();
+                ir_codec_reset(&m_stream);
+            }
+
+            // One sampling session feeds every enabled characteristic, samples go to the stream first.
+            // Aggregation samples whether or not anything is notified.
+            if ((m_p_config->sample_mode == SAMPLE_MODE_AGGREGATE) ||
+                (presence_wanted() == presence_active))
+            {
+                break;
+            }
+
+            if (presence_wanted())
             {
                 err_code = presence_start();
                 APP_ERROR_CHECK(err_code);
@@ -414,10 +1732,16 @@ static void ble_dds_evt_handler( ble_dds_t        * p_dds,
                 err_code = presence_stop();
                 APP_ERROR_CHECK(err_code);
             }
-            break;
+        }
+        break;
 
         case BLE_DDS_EVT_NOTIF_RANGE:
             NRF_LOG_INFO("tes_evt_handler: BLE_TES_EVT_NOTIF_RANGE: %d\r\n", p_dds->is_range_notif_enabled);
+            if (m_p_config->sample_mode == SAMPLE_MODE_AGGREGATE)
+            {
+                break;
+            }
+
             if (p_dds->is_range_notif_enabled)
             {
                 err_code = range_start();
@@ -434,7 +1758,14 @@ static void ble_dds_evt_handler( ble_dds_t        * p_dds,
             NRF_LOG_RAW_INFO("dds_evt_handler: BLE_DDS_EVT_CONFIG_RECEIVED: %d\r\n", length);
             APP_ERROR_CHECK_BOOL(length == sizeof(ble_dds_config_t));
 
-            err_code = m_det_flash_config_store((ble_dds_config_t *)p_data);
+            if (((ble_dds_config_t *)p_data)->sample_mode == SAMPLE_MODE_CALIBRATE)
+            {
+                err_code = calib_start((ble_dds_config_t *)p_data);
+                APP_ERROR_CHECK(err_code);
+                break;
+            }
+
+            err_code = config_store((ble_dds_config_t *)p_data);
             APP_ERROR_CHECK(err_code);
 
             err_code = config_apply((ble_dds_config_t *)p_data);
@@ -442,6 +1773,101 @@ static void ble_dds_evt_handler( ble_dds_t        * p_dds,
         }
         break;
 
+        case BLE_DDS_EVT_NOTIF_AGGREGATE:
+            NRF_LOG_INFO("dds_evt_handler: BLE_DDS_EVT_NOTIF_AGGREGATE: %d\r\n", p_dds->is_aggregate_notif_enabled);
+
+            // Send what was logged while nobody listened
+            aggregate_flush();
+            break;
+
+        case BLE_DDS_EVT_AGGREGATE_WINDOW_RECEIVED:
+        {
+            m_agg.window_s = uint16_decode(p_data);
+
+            NRF_LOG_INFO("dds_evt_handler: BLE_DDS_EVT_AGGREGATE_WINDOW_RECEIVED: %d\r\n", m_agg.window_s);
+
+            err_code = m_config_store_set(M_CONFIG_STORE_TAG_AGG_WINDOW, &m_agg.window_s, sizeof(m_agg.window_s));
+            APP_ERROR_CHECK(err_code);
+
+            // The window being aggregated is dropped, the next one has the new length
+            aggregate_window_reset();
+        }
+        break;
+
+        case BLE_DDS_EVT_RANGE_BG_RECEIVED:
+        {
+            ble_dds_range_bg_t const * p_value = (ble_dds_range_bg_t const *)p_data;
+
+            NRF_LOG_INFO("dds_evt_handler: BLE_DDS_EVT_RANGE_BG_RECEIVED: flags 0x%x margin %d\r\n",
+                         p_value->flags, p_value->margin_mm);
+
+            m_range_bg.flags     = p_value->flags & ~BLE_DDS_RANGE_BG_RELEARN;
+            m_range_bg.margin_mm = p_value->margin_mm;
+
+            if (p_value->flags & BLE_DDS_RANGE_BG_RELEARN)
+            {
+                range_bg_reset(&m_range_bg.model);
+            }
+
+            if (m_gate_waiting && !(m_range_bg.flags & BLE_DDS_RANGE_BG_GATE_MOTION))
+            {
+                m_gate_waiting = false;
+                session_start();
+            }
+
+            range_bg_save();
+        }
+        break;
+
+        case BLE_DDS_EVT_BROADCAST_RECEIVED:
+        {
+            APP_ERROR_CHECK_BOOL(length == sizeof(ble_dds_broadcast_t));
+
+            memcpy(&m_broadcast, p_data, sizeof(ble_dds_broadcast_t));
+
+            NRF_LOG_INFO("dds_evt_handler: BLE_DDS_EVT_BROADCAST_RECEIVED: mode %d, %d ms\r\n",
+                         m_broadcast.mode, m_broadcast.interval_ms);
+
+            err_code = m_config_store_set(M_CONFIG_STORE_TAG_BROADCAST, &m_broadcast, sizeof(m_broadcast));
+            APP_ERROR_CHECK(err_code);
+
+            err_code = m_ble_broadcast_config_set(&m_broadcast);
+            APP_ERROR_CHECK(err_code);
+
+            if ((m_p_config->sample_mode == SAMPLE_MODE_AGGREGATE) ||
+                (m_p_config->presence_interval_ms == 0)             ||
+                (presence_wanted() == presence_active))
+            {
+                break;
+            }
+
+            if (presence_wanted())
+            {
+                err_code = presence_start();
+                APP_ERROR_CHECK(err_code);
+            }
+            else
+            {
+                err_code = presence_stop();
+                APP_ERROR_CHECK(err_code);
+            }
+        }
+        break;
+
+        case BLE_DDS_EVT_TIME_RECEIVED:
+        {
+            uint64_t time_ms;
+
+            APP_ERROR_CHECK_BOOL(length == sizeof(uint64_t));
+
+            memcpy(&time_ms, p_data, sizeof(uint64_t));
+
+            wall_clock_sync(time_ms);
+
+            time_update();
+        }
+        break;
+
         default:
             break;
 
@@ -458,14 +1884,20 @@ static uint32_t detection_service_init(bool major_minor_fw_ver_changed)
     uint32_t err_code;
     ret_code_t rc;
     ble_dds_init_t       dds_init;
+    ble_dds_range_bg_t   range_bg;
 
-    /**@brief Load configuration from flash. */
-    rc = m_det_flash_init(&m_default_config, &m_p_config);
+    rc = m_agg_log_init(aggregate_log_ready);
     APP_ERROR_CHECK(rc);
 
+    /**@brief Load configuration from flash. */
+    if (m_config_store_load(M_CONFIG_STORE_TAG_DETECTION, m_p_config, sizeof(ble_dds_config_t)) != NRF_SUCCESS)
+    {
+        *m_p_config = m_default_config;
+    }
+
     if (major_minor_fw_ver_changed)
     {
-        err_code = m_det_flash_config_store(&m_default_config);
+        err_code = config_store(&m_default_config);
         APP_ERROR_CHECK(err_code);
     }
 
@@ -480,8 +1912,54 @@ static uint32_t detection_service_init(bool major_minor_fw_ver_changed)
     NRF_LOG_RAW_INFO("threshold_config.eth24h: %d  \n", (m_p_config)->threshold_config.eth24h);
     NRF_LOG_RAW_INFO("threshold_config.eth24l: %d  \n", (m_p_config)->threshold_config.eth24l);
     NRF_LOG_RAW_INFO("sample_mode: %d  \n", (m_p_config)->sample_mode);
+    NRF_LOG_RAW_INFO("calibration.window_s: %d  \n", (m_p_config)->calibration.window_s);
+    NRF_LOG_RAW_INFO("calibration.false_wakes_per_day: %d  \n", (m_p_config)->calibration.false_wakes_per_day);
+    NRF_LOG_RAW_INFO("session.timeout: %d  \n", (m_p_config)->session.timeout);
+    NRF_LOG_RAW_INFO("session.min_length: %d  \n", (m_p_config)->session.min_length);
+    NRF_LOG_RAW_INFO("session.holdoff: %d  \n", (m_p_config)->session.holdoff);
+    NRF_LOG_RAW_INFO("range_report.deadband_mm: %d  \n", (m_p_config)->range_report.deadband_mm);
+    NRF_LOG_RAW_INFO("range_report.heartbeat_s: %d  \n", (m_p_config)->range_report.heartbeat_s);
+
+    m_agg.window_s = 0;
+    (void)m_config_store_load(M_CONFIG_STORE_TAG_AGG_WINDOW, &m_agg.window_s, sizeof(m_agg.window_s));
+    if ((m_agg.window_s < BLE_DDS_AGGREGATE_WINDOW_MIN) || (m_agg.window_s > BLE_DDS_AGGREGATE_WINDOW_MAX))
+    {
+        m_agg.window_s = AGGREGATE_WINDOW_DEFAULT_S;
+    }
+
+    NRF_LOG_RAW_INFO("aggregate window_s: %d  \n", m_agg.window_s);
+
+    if (m_config_store_load(M_CONFIG_STORE_TAG_RANGE_BG, &m_range_bg, sizeof(m_range_bg)) != NRF_SUCCESS)
+    {
+        memset(&m_range_bg, 0, sizeof(m_range_bg));
+        m_range_bg.margin_mm = RANGE_BG_MARGIN_DEFAULT_MM;
+    }
+
+    m_range_bg_saved_mm = m_range_bg.model.mean;
+    range_bg_value_get(&range_bg);
+
+    NRF_LOG_RAW_INFO("range background: flags 0x%x, %d mm  \n", range_bg.flags, range_bg.background_mm);
+
+    memset(&m_broadcast, 0, sizeof(m_broadcast));
+    (void)m_config_store_load(M_CONFIG_STORE_TAG_BROADCAST, &m_broadcast, sizeof(m_broadcast));
+    if ((m_broadcast.mode > BLE_DDS_BROADCAST_EXTENDED)               ||
+        (m_broadcast.interval_ms < BLE_DDS_BROADCAST_INTERVAL_MIN)    ||
+        (m_broadcast.interval_ms > BLE_DDS_BROADCAST_INTERVAL_MAX))
+    {
+        m_broadcast.mode        = BLE_DDS_BROADCAST_OFF;
+        m_broadcast.interval_ms = BROADCAST_INTERVAL_DEFAULT_MS;
+    }
+
+    err_code = m_ble_broadcast_config_set(&m_broadcast);
+    APP_ERROR_CHECK(err_code);
+
+    NRF_LOG_RAW_INFO("broadcast: mode %d, %d ms  \n", m_broadcast.mode, m_broadcast.interval_ms);
 
     dds_init.p_init_config = m_p_config;
+    dds_init.init_aggregate_window_s = m_agg.window_s;
+    dds_init.p_init_range_bg = &range_bg;
+    dds_init.p_init_broadcast = &m_broadcast;
+    dds_init.p_init_time      = &m_time;
     dds_init.evt_handler = ble_dds_evt_handler;
 
     NRF_LOG_INFO("Init: ble_dds_init \r\n");
@@ -547,6 +2025,12 @@ uint32_t m_detection_init(m_ble_service_handle_t * p_handle, m_detection_init_t
 
     NRF_LOG_INFO("**** Detection Init ****\r\n");
 
+    err_code = hw_timestamp_init();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = wall_clock_init();
+    APP_ERROR_CHECK(err_code);
+
     p_handle->ble_evt_cb = detection_on_ble_evt;
     p_handle->init_cb    = detection_service_init;
 
@@ -558,22 +2042,24 @@ uint32_t m_detection_init(m_ble_service_handle_t * p_handle, m_detection_init_t
     err_code = range_sensor_init(p_params->p_twi_instance);
     APP_ERROR_CHECK(err_code);
 
-    /**@brief Init application timers */
-    err_code = app_timer_create(&presence_timer_id, APP_TIMER_MODE_REPEATED, presence_timeout_handler);
+    /**@brief Init sampling actions */
+    err_code = sample_sched_create(&presence_action, presence_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sample_sched_create(&range_action, range_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
-    /**@brief Init application timers */
-    err_code = app_timer_create(&range_timer_id, APP_TIMER_MODE_REPEATED, range_timeout_handler);
+    err_code = sample_sched_create(&calib_action, calib_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
-    /**@brief Init application timers */
-    err_code = app_timer_create(&presence_timestamp_timer_id, APP_TIMER_MODE_REPEATED, presence_timestamp_timeout_handler);
+    err_code = sample_sched_create(&preroll_action, preroll_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
-    /**@brief Init application timers */
-    err_code = app_timer_create(&range_timestamp_timer_id, APP_TIMER_MODE_REPEATED, range_timestamp_timeout_handler);
+    err_code = sample_sched_create(&aggregate_action, aggregate_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
+    m_l2cap_init(bulk_l2cap_evt_handler);
+
 
     return NRF_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "m_l2cap.h"
+#include <string.h>
+#include "sdk_common.h"
+#include "app_error.h"
+#include "nrf_log.h"
+
+static m_l2cap_evt_handler_t m_evt_handler = NULL;
+static uint16_t              m_conn_handle = BLE_CONN_HANDLE_INVALID;   ///< Connection of the open channel.
+static uint16_t              m_cid         = BLE_L2CAP_CID_INVALID;     ///< Local channel ID, invalid while closed.
+static uint16_t              m_tx_mtu      = 0;                         ///< Largest SDU the peer takes.
+static uint8_t               m_rx_buf[M_L2CAP_RX_MTU];
+static uint8_t               m_tx_buf[M_L2CAP_TX_QUEUE_SIZE][M_L2CAP_SDU_MAX];
+static volatile bool         m_tx_busy[M_L2CAP_TX_QUEUE_SIZE];          ///< Buffer handed to the SoftDevice.
+
+static void evt_send(m_l2cap_evt_type_t type, uint8_t const * p_data, uint16_t length)
+{
+    m_l2cap_evt_t evt;
+
+    if (m_evt_handler == NULL)
+    {
+        return;
+    }
+
+    evt.type   = type;
+    evt.p_data = p_data;
+    evt.length = length;
+
+    m_evt_handler(&evt);
+}
+
+static void tx_buf_release(uint8_t const * p_data)
+{
+    uint8_t i;
+
+    for (i = 0; i < M_L2CAP_TX_QUEUE_SIZE; i++)
+    {
+        if (p_data == m_tx_buf[i])
+        {
+            m_tx_busy[i] = false;
+        }
+    }
+}
+
+static void channel_closed(void)
+{
+    uint8_t i;
+
+    if (m_cid == BLE_L2CAP_CID_INVALID)
+    {
+        return;
+    }
+
+    m_conn_handle = BLE_CONN_HANDLE_INVALID;
+    m_cid         = BLE_L2CAP_CID_INVALID;
+
+    // The SoftDevice gives up every buffer with the channel
+    for (i = 0; i < M_L2CAP_TX_QUEUE_SIZE; i++)
+    {
+        m_tx_busy[i] = false;
+    }
+
+    NRF_LOG_INFO("Bulk channel closed\r\n");
+
+    evt_send(M_L2CAP_EVT_CLOSED, NULL, 0);
+}
+
+/**@brief Function for answering a central that opens a channel, one channel at a time.
+ */
+static void on_setup_request(ble_l2cap_evt_t const * p_evt)
+{
+    uint32_t                    err_code;
+    uint16_t                    cid = p_evt->local_cid;
+    ble_l2cap_ch_setup_params_t params;
+
+    memset(&params, 0, sizeof(params));
+
+    if (p_evt->params.ch_setup_request.le_psm != M_L2CAP_PSM)
+    {
+        params.status = BLE_L2CAP_CH_STATUS_CODE_LE_PSM_NOT_SUPPORTED;
+    }
+    else if (m_cid != BLE_L2CAP_CID_INVALID)
+    {
+        params.status = BLE_L2CAP_CH_STATUS_CODE_NO_RESOURCES;
+    }
+    else
+    {
+        params.status                   = BLE_L2CAP_CH_STATUS_CODE_SUCCESS;
+        params.rx_params.rx_mtu         = M_L2CAP_RX_MTU;
+        params.rx_params.rx_mps         = BLE_L2CAP_MPS_MIN;
+        params.rx_params.sdu_buf.p_data = m_rx_buf;
+        params.rx_params.sdu_buf.len    = sizeof(m_rx_buf);
+    }
+
+    err_code = sd_ble_l2cap_ch_setup(p_evt->conn_handle, &cid, &params);
+    if (err_code != NRF_ERROR_INVALID_STATE)
+    {
+        // Invalid state if the central gave up meanwhile
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+uint32_t m_l2cap_cfg_set(uint8_t conn_cfg_tag, uint32_t ram_start)
+{
+    ble_cfg_t ble_cfg;
+
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+
+    ble_cfg.conn_cfg.conn_cfg_tag                        = conn_cfg_tag;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.rx_mps        = BLE_L2CAP_MPS_MIN;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.tx_mps        = M_L2CAP_TX_MPS;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.rx_queue_size = 1;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.tx_queue_size = M_L2CAP_TX_QUEUE_SIZE;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.ch_count      = 1;
+
+    return sd_ble_cfg_set(BLE_CONN_CFG_L2CAP, &ble_cfg, ram_start);
+}
+
+void m_l2cap_init(m_l2cap_evt_handler_t evt_handler)
+{
+    m_evt_handler = evt_handler;
+}
+
+void m_l2cap_on_ble_evt(ble_evt_t const * p_ble_evt)
+{
+    uint32_t                err_code;
+    ble_l2cap_evt_t const * p_evt = &p_ble_evt->evt.l2cap_evt;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_L2CAP_EVT_CH_SETUP_REQUEST:
+            on_setup_request(p_evt);
+            break;
+
+        case BLE_L2CAP_EVT_CH_SETUP:
+            m_conn_handle = p_evt->conn_handle;
+            m_cid         = p_evt->local_cid;
+            m_tx_mtu      = p_evt->params.ch_setup.tx_params.tx_mtu;
+
+            NRF_LOG_INFO("Bulk channel open, MTU %d, MPS %d, credits %d\r\n",
+                         m_tx_mtu,
+                         p_evt->params.ch_setup.tx_params.tx_mps,
+                         p_evt->params.ch_setup.tx_params.credits);
+
+            evt_send(M_L2CAP_EVT_OPENED, NULL, 0);
+            break;
+
+        case BLE_L2CAP_EVT_CH_RX:
+            if (p_evt->local_cid != m_cid)
+            {
+                break;
+            }
+
+            evt_send(M_L2CAP_EVT_RX, p_evt->params.rx.sdu_buf.p_data, p_evt->params.rx.sdu_len);
+
+            // The buffer goes back to the SoftDevice for the next command
+            err_code = sd_ble_l2cap_ch_rx(m_conn_handle, m_cid, &p_evt->params.rx.sdu_buf);
+            if (err_code != NRF_ERROR_INVALID_STATE)
+            {
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case BLE_L2CAP_EVT_CH_TX:
+            tx_buf_release(p_evt->params.tx.sdu_buf.p_data);
+
+            evt_send(M_L2CAP_EVT_TX_DONE, NULL, 0);
+            break;
+
+        case BLE_L2CAP_EVT_CH_SDU_BUF_RELEASED:
+            tx_buf_release(p_evt->params.ch_sdu_buf_released.sdu_buf.p_data);
+            break;
+
+        case BLE_L2CAP_EVT_CH_RELEASED:
+            if (p_evt->local_cid == m_cid)
+            {
+                channel_closed();
+            }
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_ble_evt->evt.gap_evt.conn_handle == m_conn_handle)
+            {
+                channel_closed();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool m_l2cap_is_open(void)
+{
+    return (m_cid != BLE_L2CAP_CID_INVALID);
+}
+
+uint16_t m_l2cap_sdu_max(void)
+{
+    return MIN(m_tx_mtu, M_L2CAP_SDU_MAX);
+}
+
+uint32_t m_l2cap_send(uint8_t const * p_data, uint16_t length)
+{
+    uint32_t   err_code;
+    ble_data_t sdu;
+    uint8_t    i;
+
+    VERIFY_PARAM_NOT_NULL(p_data);
+
+    if (m_cid == BLE_L2CAP_CID_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (length > m_l2cap_sdu_max())
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    for (i = 0; i < M_L2CAP_TX_QUEUE_SIZE; i++)
+    {
+        if (!m_tx_busy[i])
+        {
+            break;
+        }
+    }
+
+    if (i == M_L2CAP_TX_QUEUE_SIZE)
+    {
+        return NRF_ERROR_RESOURCES;
+    }
+
+    memcpy(m_tx_buf[i], p_data, length);
+
+    sdu.p_data = m_tx_buf[i];
+    sdu.len    = length;
+
+    // Taken before the call, the TX event may come before it returns
+    m_tx_busy[i] = true;
+
+    err_code = sd_ble_l2cap_ch_tx(m_conn_handle, m_cid, &sdu);
+    if (err_code != NRF_SUCCESS)
+    {
+        m_tx_busy[i] = false;
+    }
+
+    return err_code;
+}
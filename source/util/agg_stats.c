@@ -0,0 +1,38 @@
+#include "agg_stats.h"
+#include <math.h>
+#include <string.h>
+
+void agg_stats_reset(agg_stats_t * p_stats)
+{
+    p_stats->count = 0;
+    p_stats->mean  = 0.0f;
+    p_stats->m2    = 0.0f;
+    p_stats->min   = INT16_MAX;
+    p_stats->max   = INT16_MIN;
+}
+
+void agg_stats_add(agg_stats_t * p_stats, int16_t value)
+{
+    float delta = (float)value - p_stats->mean;
+
+    p_stats->count++;
+    p_stats->mean += delta / p_stats->count;
+    p_stats->m2   += delta * ((float)value - p_stats->mean);
+
+    p_stats->min = MIN(p_stats->min, value);
+    p_stats->max = MAX(p_stats->max, value);
+}
+
+void agg_stats_summary_get(agg_stats_t const * p_stats, ble_dds_aggregate_summary_t * p_summary)
+{
+    if (p_stats->count == 0)
+    {
+        memset(p_summary, 0, sizeof(ble_dds_aggregate_summary_t));
+        return;
+    }
+
+    p_summary->min    = p_stats->min;
+    p_summary->max    = p_stats->max;
+    p_summary->mean   = (int16_t)lroundf(p_stats->mean);
+    p_summary->stddev = (p_stats->count > 1) ? (uint16_t)lroundf(sqrtf(p_stats->m2 / (p_stats->count - 1))) : 0;
+}
@@ -0,0 +1,51 @@
+#include "det_config.h"
+
+bool det_config_verify(ble_dds_config_t * p_config, ble_dds_config_t const * p_default)
+{
+    bool replaced = false;
+
+    if ((p_config->presence_interval_ms < BLE_DDS_CONFIG_PRESENCE_INT_MIN) ||
+        (p_config->presence_interval_ms > BLE_DDS_CONFIG_PRESENCE_INT_MAX))
+    {
+        p_config->presence_interval_ms = p_default->presence_interval_ms;
+        replaced = true;
+    }
+
+    if ((p_config->range_interval_ms < BLE_DDS_CONFIG_RANGE_INT_MIN) ||
+        (p_config->range_interval_ms > BLE_DDS_CONFIG_RANGE_INT_MAX))
+    {
+        p_config->range_interval_ms = p_default->range_interval_ms;
+        replaced = true;
+    }
+
+    if ((p_config->threshold_config.eth13h < BLE_DDS_CONFIG_THRESHOLD_MIN)            ||
+        (p_config->threshold_config.eth13l > BLE_DDS_CONFIG_THRESHOLD_MAX)            ||
+        (p_config->threshold_config.eth24h < BLE_DDS_CONFIG_THRESHOLD_MIN)            ||
+        ((int)p_config->threshold_config.eth24l > (int)BLE_DDS_CONFIG_THRESHOLD_MAX))
+    {
+        p_config->threshold_config = p_default->threshold_config;
+        replaced = true;
+    }
+
+    if ((p_config->sample_mode == SAMPLE_MODE_CALIBRATE) ||
+        (p_config->sample_mode > SAMPLE_MODE_AGGREGATE))
+    {
+        p_config->sample_mode = p_default->sample_mode;
+        replaced = true;
+    }
+
+    if ((p_config->calibration.window_s < BLE_DDS_CONFIG_CALIB_WINDOW_MIN) ||
+        (p_config->calibration.false_wakes_per_day < BLE_DDS_CONFIG_CALIB_WAKES_MIN))
+    {
+        p_config->calibration = p_default->calibration;
+        replaced = true;
+    }
+
+    if (p_config->session.timeout < BLE_DDS_CONFIG_SESSION_TIMEOUT_MIN)
+    {
+        p_config->session = p_default->session;
+        replaced = true;
+    }
+
+    return replaced;
+}
@@ -0,0 +1,120 @@
+#include "hw_timestamp.h"
+#include "wall_clock.h"
+#include "nrf_timer.h"
+#include "nrf_soc.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "macros.h"
+
+#define TIMESTAMP_TIMER             NRF_TIMER1                  // TIMER0 belongs to the SoftDevice.
+#define TIMESTAMP_PPI_CH_FIRST      0                           // First PPI channel, one per source.
+#define TIMESTAMP_CC_NOW            NRF_TIMER_CC_CHANNEL3       // Capture register for hw_timestamp_now.
+#define TIMESTAMP_RTC_FREQ          (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+
+STATIC_ASSERT((int)HW_TIMESTAMP_SRC_COUNT <= (int)TIMESTAMP_CC_NOW);
+
+static bool     m_precise;          ///< TIMER1 is running.
+static uint32_t m_timer_base;       ///< Timestamp when TIMER1 was started from 0.
+static uint32_t m_rtc_offset;       ///< Added to the RTC time, so the time base goes on where TIMER1 stopped.
+
+/**@brief Function for getting the timestamp from the RTC, from any context.
+ */
+static uint32_t rtc_now(void)
+{
+    return (uint32_t)((wall_clock_ticks() * HW_TIMESTAMP_FREQ) / TIMESTAMP_RTC_FREQ) + m_rtc_offset;
+}
+
+static uint32_t timer_now(void)
+{
+    nrf_timer_task_trigger(TIMESTAMP_TIMER, nrf_timer_capture_task_get(TIMESTAMP_CC_NOW));
+
+    return m_timer_base + nrf_timer_cc_read(TIMESTAMP_TIMER, TIMESTAMP_CC_NOW);
+}
+
+uint32_t hw_timestamp_init(void)
+{
+    nrf_timer_task_trigger(TIMESTAMP_TIMER, NRF_TIMER_TASK_STOP);
+    nrf_timer_task_trigger(TIMESTAMP_TIMER, NRF_TIMER_TASK_CLEAR);
+
+    nrf_timer_mode_set(TIMESTAMP_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(TIMESTAMP_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(TIMESTAMP_TIMER, NRF_TIMER_FREQ_31250Hz);
+
+    m_precise    = false;
+    m_timer_base = 0;
+    m_rtc_offset = 0;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t hw_timestamp_attach(hw_timestamp_src_t src, uint32_t event_addr)
+{
+    uint32_t   err_code;
+    uint8_t    channel = TIMESTAMP_PPI_CH_FIRST + src;
+    uint32_t * p_task  = nrf_timer_task_address_get(TIMESTAMP_TIMER,
+                                                    nrf_timer_capture_task_get((nrf_timer_cc_channel_t)src));
+
+    // PPI is shared with the SoftDevice, go through it
+    err_code = sd_ppi_channel_assign(channel, (const volatile void *)event_addr, p_task);
+    RETURN_IF_ERROR(err_code);
+
+    return sd_ppi_channel_enable_set(1UL << channel);
+}
+
+void hw_timestamp_detach(hw_timestamp_src_t src)
+{
+    (void)sd_ppi_channel_enable_clr(1UL << (TIMESTAMP_PPI_CH_FIRST + src));
+}
+
+uint32_t hw_timestamp_get(hw_timestamp_src_t src)
+{
+    if (!m_precise)
+    {
+        return rtc_now();
+    }
+
+    return m_timer_base + nrf_timer_cc_read(TIMESTAMP_TIMER, (nrf_timer_cc_channel_t)src);
+}
+
+uint32_t hw_timestamp_now(void)
+{
+    return m_precise ? timer_now() : rtc_now();
+}
+
+void hw_timestamp_precise_set(bool precise)
+{
+    if (precise == m_precise)
+    {
+        return;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    if (precise)
+    {
+        m_timer_base = rtc_now();
+
+        nrf_timer_task_trigger(TIMESTAMP_TIMER, NRF_TIMER_TASK_CLEAR);
+
+        // Edges captured before the start read as the start
+        for (uint32_t i = 0; i < HW_TIMESTAMP_SRC_COUNT; i++)
+        {
+            nrf_timer_cc_write(TIMESTAMP_TIMER, (nrf_timer_cc_channel_t)i, 0);
+        }
+
+        nrf_timer_task_trigger(TIMESTAMP_TIMER, NRF_TIMER_TASK_START);
+    }
+    else
+    {
+        uint32_t now = timer_now();
+
+        nrf_timer_task_trigger(TIMESTAMP_TIMER, NRF_TIMER_TASK_STOP);
+
+        // The two clocks drift apart a little over a session, the RTC takes over from here
+        m_rtc_offset += now - rtc_now();
+    }
+
+    m_precise = precise;
+
+    CRITICAL_REGION_EXIT();
+}
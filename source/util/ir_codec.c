@@ -0,0 +1,226 @@
+#include "ir_codec.h"
+#include <string.h>
+
+#define RICE_K_MAX              15              // Largest Rice parameter.
+#define RICE_Q_ESCAPE           12              // Quotients this large are sent raw after an escape.
+#define RICE_COUNT_MAX          16              // Statistics are halved at this count.
+#define RICE_SUM_INIT           4               // Statistics after a keyframe.
+#define RAW_BITS_IR             17              // Zigzag of an int16 difference.
+#define RAW_BITS_DT             32              // Zigzag of a timestamp step difference.
+
+/**@brief Bit writer over the packet buffer, fails once the buffer is full.
+ */
+static bool bits_put(ir_codec_t * p_codec, uint32_t value, uint8_t count)
+{
+    if (p_codec->bits + count > IR_CODEC_PACKET_MAX * 8)
+    {
+        return false;
+    }
+
+    while (count > 0)
+    {
+        uint16_t byte = p_codec->bits / 8;
+        uint8_t  bit  = 7 - (p_codec->bits % 8);
+
+        count--;
+        if ((value >> count) & 1)
+        {
+            p_codec->buf[byte] |= (1 << bit);
+        }
+        p_codec->bits++;
+    }
+
+    return true;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static void rice_reset(ir_codec_rice_t * p_rice)
+{
+    p_rice->sum   = RICE_SUM_INIT;
+    p_rice->count = 1;
+}
+
+/**@brief Smallest parameter for which the mean residual fits in the remainder bits.
+ */
+static uint8_t rice_k(ir_codec_rice_t const * p_rice)
+{
+    uint8_t k = 0;
+
+    while (((uint32_t)p_rice->count << k) < p_rice->sum && (k < RICE_K_MAX))
+    {
+        k++;
+    }
+
+    return k;
+}
+
+static void rice_update(ir_codec_rice_t * p_rice, uint32_t mapped)
+{
+    p_rice->sum += mapped;
+    p_rice->count++;
+
+    if (p_rice->count >= RICE_COUNT_MAX)
+    {
+        p_rice->sum   >>= 1;
+        p_rice->count >>= 1;
+    }
+}
+
+/**@brief Rice code a residual: quotient in unary, then k remainder bits.
+ */
+static bool rice_put(ir_codec_t * p_codec, ir_codec_rice_t * p_rice, int32_t residual, uint8_t raw_bits)
+{
+    uint32_t mapped = zigzag(residual);
+    uint8_t  k      = rice_k(p_rice);
+    uint32_t q      = mapped >> k;
+    bool     fits;
+
+    rice_update(p_rice, mapped);
+
+    if (q >= RICE_Q_ESCAPE)
+    {
+        // Escape: RICE_Q_ESCAPE ones, then the mapped value as is
+        return bits_put(p_codec, (1UL << RICE_Q_ESCAPE) - 1, RICE_Q_ESCAPE) &&
+               bits_put(p_codec, mapped, raw_bits);
+    }
+
+    fits = bits_put(p_codec, ((1UL << q) - 1) << 1, q + 1);
+
+    return fits && ((k == 0) || bits_put(p_codec, mapped & ((1UL << k) - 1), k));
+}
+
+static bool keyframe_put(ir_codec_t * p_codec, ble_dds_presence_t const * p_sample)
+{
+    uint8_t i;
+
+    p_codec->state.since_key = 0;
+    p_codec->state.prev_dt   = 0;
+    p_codec->state.keyed     = true;
+
+    for (i = 0; i < ARRAY_SIZE(p_codec->state.rice); i++)
+    {
+        rice_reset(&p_codec->state.rice[i]);
+    }
+
+    return bits_put(p_codec, 1, 1)                              &&
+           bits_put(p_codec, p_sample->marker, 2)               &&
+           bits_put(p_codec, p_sample->timestamp, 32)           &&
+           bits_put(p_codec, (uint16_t)p_sample->ir1, 16)       &&
+           bits_put(p_codec, (uint16_t)p_sample->ir2, 16)       &&
+           bits_put(p_codec, (uint16_t)p_sample->ir3, 16)       &&
+           bits_put(p_codec, (uint16_t)p_sample->ir4, 16);
+}
+
+static bool delta_put(ir_codec_t * p_codec, ble_dds_presence_t const * p_sample)
+{
+    ir_codec_state_t         * p_state = &p_codec->state;
+    ble_dds_presence_t const * p_prev  = &p_state->prev;
+    int32_t                    dt      = (int32_t)(p_sample->timestamp - p_prev->timestamp);
+    bool                       fits;
+
+    // Samples are periodic, predict the same step as last time
+    fits = bits_put(p_codec, 0, 1)                                                          &&
+           bits_put(p_codec, p_sample->marker, 2)                                           &&
+           rice_put(p_codec, &p_state->rice[0], dt - p_state->prev_dt, RAW_BITS_DT)          &&
+           rice_put(p_codec, &p_state->rice[1], p_sample->ir1 - p_prev->ir1, RAW_BITS_IR)    &&
+           rice_put(p_codec, &p_state->rice[2], p_sample->ir2 - p_prev->ir2, RAW_BITS_IR)    &&
+           rice_put(p_codec, &p_state->rice[3], p_sample->ir3 - p_prev->ir3, RAW_BITS_IR)    &&
+           rice_put(p_codec, &p_state->rice[4], p_sample->ir4 - p_prev->ir4, RAW_BITS_IR);
+
+    p_state->prev_dt = dt;
+    p_state->since_key++;
+
+    return fits;
+}
+
+void ir_codec_reset(ir_codec_t * p_codec)
+{
+    memset(p_codec, 0, sizeof(ir_codec_t));
+
+    p_codec->bits = IR_CODEC_PACKET_HEADER * 8;
+}
+
+/**@brief Drop the bits of a frame that did not fit.
+ */
+static void frame_undo(ir_codec_t * p_codec, ir_codec_state_t const * p_state, uint16_t bits)
+{
+    p_codec->state = *p_state;
+    p_codec->bits  = bits;
+
+    memset(&p_codec->buf[(bits + 7) / 8], 0, IR_CODEC_PACKET_MAX - (bits + 7) / 8);
+    if (bits % 8)
+    {
+        p_codec->buf[bits / 8] &= (uint8_t)(0xFF << (8 - (bits % 8)));
+    }
+}
+
+bool ir_codec_put(ir_codec_t * p_codec, ble_dds_presence_t const * p_sample)
+{
+    ir_codec_state_t state = p_codec->state;
+    uint16_t         bits  = p_codec->bits;
+    bool             fits  = false;
+
+    if (p_codec->state.keyed && (p_codec->state.since_key < IR_CODEC_KEYFRAME_INTERVAL - 1))
+    {
+        fits = delta_put(p_codec, p_sample);
+        if (!fits)
+        {
+            frame_undo(p_codec, &state, bits);
+        }
+    }
+
+    // A delta frame full of escapes is larger than a keyframe, which always fits an empty packet
+    if (!fits && (!p_codec->state.keyed || (p_codec->state.since_key >= IR_CODEC_KEYFRAME_INTERVAL - 1) ||
+                  (p_codec->frames == 0)))
+    {
+        fits = keyframe_put(p_codec, p_sample);
+        if (!fits)
+        {
+            frame_undo(p_codec, &state, bits);
+        }
+    }
+
+    if (!fits)
+    {
+        // It goes first in the next packet
+        return false;
+    }
+
+    if (p_codec->frames == 0)
+    {
+        p_codec->first_timestamp = p_sample->timestamp;
+    }
+
+    p_codec->state.prev = *p_sample;
+    p_codec->frames++;
+
+    return true;
+}
+
+uint16_t ir_codec_packet_get(ir_codec_t * p_codec, uint8_t const ** pp_data)
+{
+    if (p_codec->frames == 0)
+    {
+        return 0;
+    }
+
+    p_codec->buf[0] = p_codec->seq;
+    p_codec->buf[1] = p_codec->frames;
+
+    *pp_data = p_codec->buf;
+
+    return (p_codec->bits + 7) / 8;
+}
+
+void ir_codec_packet_release(ir_codec_t * p_codec)
+{
+    memset(p_codec->buf, 0, sizeof(p_codec->buf));
+
+    p_codec->bits   = IR_CODEC_PACKET_HEADER * 8;
+    p_codec->frames = 0;
+    p_codec->seq++;
+}
@@ -0,0 +1,152 @@
+#include "people_count.h"
+#include <math.h>
+#include <string.h>
+
+#define BASELINE_WEIGHT         0.25f       // Weight of a new idle sample in the baseline.
+
+/**@brief Best lag of one element pair.
+ */
+typedef struct
+{
+    int8_t lag;         ///< Samples the second element follows the first.
+    float  corr;        ///< Normalized correlation at that lag.
+} pair_t;
+
+static pair_t pair_estimate(float const * p_corr, float energy_a, float energy_b)
+{
+    pair_t   pair = {0, 0.0f};
+    float    norm = sqrtf(energy_a * energy_b);
+    uint8_t  i;
+
+    if (norm <= 0.0f)
+    {
+        return pair;
+    }
+
+    for (i = 0; i < 2 * PEOPLE_COUNT_LAG_MAX + 1; i++)
+    {
+        if (p_corr[i] / norm > pair.corr)
+        {
+            pair.corr = p_corr[i] / norm;
+            pair.lag  = (int8_t)i - PEOPLE_COUNT_LAG_MAX;
+        }
+    }
+
+    return pair;
+}
+
+void people_count_idle(people_count_t * p_count, ble_dds_presence_t const * p_sample)
+{
+    float   ir[4] = {p_sample->ir1, p_sample->ir2, p_sample->ir3, p_sample->ir4};
+    uint8_t i;
+
+    for (i = 0; i < 4; i++)
+    {
+        p_count->baseline[i] = p_count->baseline_valid ?
+                               p_count->baseline[i] + BASELINE_WEIGHT * (ir[i] - p_count->baseline[i]) :
+                               ir[i];
+    }
+
+    p_count->baseline_valid = true;
+}
+
+void people_count_session_start(people_count_t * p_count)
+{
+    memset(p_count->hist, 0, sizeof(p_count->hist));
+    memset(p_count->energy, 0, sizeof(p_count->energy));
+    memset(p_count->corr13, 0, sizeof(p_count->corr13));
+    memset(p_count->corr24, 0, sizeof(p_count->corr24));
+
+    p_count->hist_pos   = 0;
+    p_count->count      = 0;
+    p_count->range_min  = UINT16_MAX;
+    p_count->range_seen = false;
+}
+
+void people_count_sample(people_count_t * p_count, ble_dds_presence_t const * p_sample)
+{
+    float   x[4];
+    uint8_t lag;
+    uint8_t i;
+
+    if (!p_count->baseline_valid)
+    {
+        // No idle sample yet, the session start is the best guess
+        people_count_idle(p_count, p_sample);
+    }
+
+    x[0] = p_sample->ir1 - p_count->baseline[0];
+    x[1] = p_sample->ir2 - p_count->baseline[1];
+    x[2] = p_sample->ir3 - p_count->baseline[2];
+    x[3] = p_sample->ir4 - p_count->baseline[3];
+
+    for (i = 0; i < 4; i++)
+    {
+        p_count->energy[i] += x[i] * x[i];
+    }
+
+    // Zero lag, then each past sample still in the window on both sides
+    p_count->corr13[PEOPLE_COUNT_LAG_MAX] += x[2] * x[0];
+    p_count->corr24[PEOPLE_COUNT_LAG_MAX] += x[3] * x[1];
+
+    for (lag = 1; (lag <= PEOPLE_COUNT_LAG_MAX) && (lag <= p_count->count); lag++)
+    {
+        float const * p_past = p_count->hist[(p_count->hist_pos + PEOPLE_COUNT_LAG_MAX - lag) % PEOPLE_COUNT_LAG_MAX];
+
+        p_count->corr13[PEOPLE_COUNT_LAG_MAX + lag] += x[2] * p_past[0];
+        p_count->corr13[PEOPLE_COUNT_LAG_MAX - lag] += x[0] * p_past[2];
+        p_count->corr24[PEOPLE_COUNT_LAG_MAX + lag] += x[3] * p_past[1];
+        p_count->corr24[PEOPLE_COUNT_LAG_MAX - lag] += x[1] * p_past[3];
+    }
+
+    memcpy(p_count->hist[p_count->hist_pos], x, sizeof(x));
+    p_count->hist_pos = (p_count->hist_pos + 1) % PEOPLE_COUNT_LAG_MAX;
+
+    if (p_count->count < UINT16_MAX)
+    {
+        p_count->count++;
+    }
+}
+
+void people_count_range(people_count_t * p_count, uint16_t range_mm)
+{
+    p_count->range_min  = MIN(p_count->range_min, range_mm);
+    p_count->range_seen = true;
+}
+
+people_count_dir_t people_count_session_end(people_count_t * p_count)
+{
+    pair_t pair13;
+    pair_t pair24;
+    pair_t best;
+
+    if (p_count->count < PEOPLE_COUNT_SAMPLES_MIN)
+    {
+        return PEOPLE_COUNT_NONE;
+    }
+
+    pair13 = pair_estimate(p_count->corr13, p_count->energy[0], p_count->energy[2]);
+    pair24 = pair_estimate(p_count->corr24, p_count->energy[1], p_count->energy[3]);
+
+    // Walking along one pair crosses the other pair's elements together, at zero lag
+    if ((pair13.lag != 0) && ((pair24.lag == 0) || (pair13.corr >= pair24.corr)))
+    {
+        best = pair13;
+    }
+    else
+    {
+        best = pair24;
+    }
+
+    if ((best.lag == 0) || (best.corr < PEOPLE_COUNT_CORR_MIN))
+    {
+        return PEOPLE_COUNT_NONE;
+    }
+
+    if (p_count->range_seen && (p_count->range_min > PEOPLE_COUNT_RANGE_MAX_MM))
+    {
+        return PEOPLE_COUNT_PASSER_BY;
+    }
+
+    return (best.lag > 0) ? PEOPLE_COUNT_ENTER : PEOPLE_COUNT_EXIT;
+}
@@ -0,0 +1,184 @@
+#include "prio_sched.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf_log.h"
+#include <string.h>
+
+typedef struct
+{
+    uint8_t          * p_buf;
+    uint16_t           slot_size;           ///< Header plus the largest event, word aligned.
+    uint16_t           event_size;
+    uint16_t           size;                ///< Number of slots.
+    uint16_t           first;               ///< Oldest event.
+    uint16_t           count;
+    prio_sched_stats_t stats;
+} queue_t;
+
+static queue_t  m_queues[PRIO_SCHED_COUNT];
+static uint32_t m_overflows_logged[PRIO_SCHED_COUNT];
+
+/**@brief Histogram bucket of a latency, bucket n holds latencies below 2^n ticks.
+ */
+static uint8_t latency_bucket(uint32_t ticks)
+{
+    uint8_t bucket = 0;
+
+    while ((ticks > 0) && (bucket < PRIO_SCHED_LATENCY_BUCKETS - 1))
+    {
+        ticks >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/**@brief Execute the oldest event of a queue, executed in main-context.
+ */
+static void queue_execute(queue_t * p_queue)
+{
+    prio_sched_event_header_t * p_header;
+    uint32_t                    latency;
+
+    p_header = (prio_sched_event_header_t *)&p_queue->p_buf[p_queue->first * p_queue->slot_size];
+    latency  = app_timer_cnt_diff_compute(app_timer_cnt_get(), p_header->tick);
+
+    p_queue->stats.executed++;
+    p_queue->stats.latency[latency_bucket(latency)]++;
+    p_queue->stats.latency_max = MAX(p_queue->stats.latency_max, latency);
+
+    // Producers never touch the head slot, it is released after the handler returns
+    p_header->handler((p_header->size > 0) ? (void *)(p_header + 1) : NULL, p_header->size);
+
+    CRITICAL_REGION_ENTER();
+    p_queue->first = (p_queue->first + 1 == p_queue->size) ? 0 : p_queue->first + 1;
+    p_queue->count--;
+    CRITICAL_REGION_EXIT();
+}
+
+uint32_t prio_sched_queue_init(prio_sched_prio_t prio, uint16_t event_size, uint16_t queue_size, uint32_t * p_buf)
+{
+    queue_t * p_queue;
+
+    if ((prio >= PRIO_SCHED_COUNT) || (queue_size == 0) || (p_buf == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_queue = &m_queues[prio];
+
+    memset(p_queue, 0, sizeof(queue_t));
+    p_queue->p_buf      = (uint8_t *)p_buf;
+    p_queue->slot_size  = PRIO_SCHED_SLOT_SIZE(event_size);
+    p_queue->event_size = event_size;
+    p_queue->size       = queue_size;
+
+    m_overflows_logged[prio] = 0;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t prio_sched_event_put(void const              * p_event_data,
+                              uint16_t                  event_size,
+                              app_sched_event_handler_t handler,
+                              prio_sched_prio_t         prio)
+{
+    uint32_t                    err_code = NRF_SUCCESS;
+    queue_t                   * p_queue  = &m_queues[prio];
+    prio_sched_event_header_t * p_header;
+    uint16_t                    slot;
+
+    if (event_size > p_queue->event_size)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    if (p_queue->count < p_queue->size)
+    {
+        slot = p_queue->first + p_queue->count;
+        if (slot >= p_queue->size)
+        {
+            slot -= p_queue->size;
+        }
+
+        p_header          = (prio_sched_event_header_t *)&p_queue->p_buf[slot * p_queue->slot_size];
+        p_header->handler = handler;
+        p_header->tick    = app_timer_cnt_get();
+        p_header->size    = event_size;
+        if (event_size > 0)
+        {
+            memcpy(p_header + 1, p_event_data, event_size);
+        }
+
+        p_queue->count++;
+        p_queue->stats.high_water = MAX(p_queue->stats.high_water, p_queue->count);
+    }
+    else
+    {
+        p_queue->stats.overflows++;
+        err_code = NRF_ERROR_NO_MEM;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+void prio_sched_execute(void)
+{
+    uint8_t prio = 0;
+
+    while (prio < PRIO_SCHED_COUNT)
+    {
+        if (m_queues[prio].count > 0)
+        {
+            queue_execute(&m_queues[prio]);
+
+            // A handler may have queued higher class work
+            prio = 0;
+        }
+        else
+        {
+            prio++;
+        }
+    }
+
+    for (prio = 0; prio < PRIO_SCHED_COUNT; prio++)
+    {
+        uint32_t overflows = m_queues[prio].stats.overflows;
+
+        if (overflows != m_overflows_logged[prio])
+        {
+            NRF_LOG_WARNING("Scheduler class %d dropped %d events\r\n", prio, overflows - m_overflows_logged[prio]);
+            m_overflows_logged[prio] = overflows;
+        }
+    }
+}
+
+void prio_sched_stats_get(prio_sched_prio_t prio, prio_sched_stats_t * p_stats)
+{
+    CRITICAL_REGION_ENTER();
+    *p_stats = m_queues[prio].stats;
+    CRITICAL_REGION_EXIT();
+}
+
+/**@brief app_scheduler API, existing users and SDK libraries queue in the high class.
+ */
+uint32_t app_sched_event_put(void const              * p_event_data,
+                             uint16_t                  event_size,
+                             app_sched_event_handler_t handler)
+{
+    return prio_sched_event_put(p_event_data, event_size, handler, PRIO_SCHED_HIGH);
+}
+
+void app_sched_execute(void)
+{
+    prio_sched_execute();
+}
+
+uint16_t app_sched_queue_space_get(void)
+{
+    return m_queues[PRIO_SCHED_HIGH].size - m_queues[PRIO_SCHED_HIGH].count;
+}
@@ -0,0 +1,79 @@
+#include "range_bg.h"
+#include <math.h>
+#include <string.h>
+
+#define ADAPT_WEIGHT            (1.0f / 256)    // Weight of a new background reading once learned.
+
+void range_bg_reset(range_bg_t * p_bg)
+{
+    memset(p_bg, 0, sizeof(range_bg_t));
+}
+
+bool range_bg_learned(range_bg_t const * p_bg)
+{
+    return (p_bg->count >= RANGE_BG_LEARN_READINGS);
+}
+
+static float threshold(range_bg_t const * p_bg, uint16_t margin_mm)
+{
+    float sigmas = RANGE_BG_SIGMAS * sqrtf(p_bg->var);
+
+    return (sigmas > margin_mm) ? sigmas : (float)margin_mm;
+}
+
+/**@brief Average a reading into the background being learned (Welford, population variance).
+ */
+static void learn(range_bg_t * p_bg, float range)
+{
+    float delta = range - p_bg->mean;
+
+    p_bg->count++;
+    p_bg->mean += delta / p_bg->count;
+    p_bg->var  += (delta * (range - p_bg->mean) - p_bg->var) / p_bg->count;
+}
+
+bool range_bg_update(range_bg_t * p_bg, uint16_t range_mm, uint16_t margin_mm)
+{
+    float range = range_mm;
+    float delta;
+
+    if (range_mm >= RANGE_BG_NO_TARGET_MM)
+    {
+        // Nothing in range, neither foreground nor a background distance
+        p_bg->fg_run = 0;
+        return false;
+    }
+
+    if (!range_bg_learned(p_bg))
+    {
+        if ((p_bg->count > 0) && (range > p_bg->mean + threshold(p_bg, margin_mm)))
+        {
+            // What was averaged so far stood in front of the background
+            range_bg_reset(p_bg);
+        }
+
+        learn(p_bg, range);
+        return false;
+    }
+
+    if (range < p_bg->mean - threshold(p_bg, margin_mm))
+    {
+        if (++p_bg->fg_run >= RANGE_BG_ABSORB_READINGS)
+        {
+            // Something was put in front of the background and stays there
+            range_bg_reset(p_bg);
+            learn(p_bg, range);
+            return false;
+        }
+
+        return true;
+    }
+
+    p_bg->fg_run = 0;
+
+    delta       = range - p_bg->mean;
+    p_bg->mean += ADAPT_WEIGHT * delta;
+    p_bg->var   = (1.0f - ADAPT_WEIGHT) * (p_bg->var + ADAPT_WEIGHT * delta * delta);
+
+    return false;
+}
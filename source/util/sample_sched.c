@@ -0,0 +1,226 @@
+#include "sample_sched.h"
+#include "sdk_macros.h"
+#include "app_util_platform.h"
+#include "prio_sched.h"
+
+static sample_sched_action_t * mp_head;         ///< Earliest due action.
+static bool                    m_run_pending;   ///< A run is queued in the scheduler.
+
+APP_TIMER_DEF(sched_timer_id);
+
+/**@brief Ticks from now until an RTC tick, zero if it has passed.
+ */
+static uint32_t ticks_until(uint32_t tick, uint32_t now)
+{
+    uint32_t ticks = app_timer_cnt_diff_compute(tick, now);
+
+    return (ticks <= SAMPLE_SCHED_MAX_TICKS) ? ticks : 0;
+}
+
+static void list_remove(sample_sched_action_t * p_action)
+{
+    sample_sched_action_t ** pp = &mp_head;
+
+    while (*pp != NULL)
+    {
+        if (*pp == p_action)
+        {
+            *pp = p_action->p_next;
+            break;
+        }
+        pp = &(*pp)->p_next;
+    }
+
+    p_action->queued = false;
+}
+
+static void list_insert(sample_sched_action_t * p_action, uint32_t now)
+{
+    sample_sched_action_t ** pp    = &mp_head;
+    uint32_t                 ticks = ticks_until(p_action->due, now);
+
+    // Actions due at the same tick keep the order they were started in
+    while ((*pp != NULL) && (ticks_until((*pp)->due, now) <= ticks))
+    {
+        pp = &(*pp)->p_next;
+    }
+
+    p_action->p_next = *pp;
+    *pp              = p_action;
+    p_action->queued = true;
+}
+
+/**@brief Arm the timer for the head of the list.
+ */
+static void timer_arm(uint32_t now)
+{
+    uint32_t err_code;
+
+    (void)app_timer_stop(sched_timer_id);
+
+    if (mp_head == NULL)
+    {
+        return;
+    }
+
+    err_code = app_timer_start(sched_timer_id,
+                               MAX(ticks_until(mp_head->due, now), APP_TIMER_MIN_TIMEOUT_TICKS),
+                               NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Run every action that is due, executed in main-context.
+ */
+static void sched_run(void * p_event_data, uint16_t event_size)
+{
+    uint32_t now = app_timer_cnt_get();
+
+    m_run_pending = false;
+
+    while ((mp_head != NULL) && (ticks_until(mp_head->due, now) == 0))
+    {
+        sample_sched_action_t * p_action = mp_head;
+
+        list_remove(p_action);
+
+        if (p_action->period > 0)
+        {
+            // Stay on the grid, skip runs that were missed
+            do
+            {
+                p_action->due = (p_action->due + p_action->period) & APP_TIMER_MAX_CNT_VAL;
+            } while (ticks_until(p_action->due, now) == 0);
+
+            list_insert(p_action, now);
+        }
+
+        // The handler may stop or restart any action, itself included
+        p_action->handler(p_action->p_context);
+
+        now = app_timer_cnt_get();
+    }
+
+    timer_arm(now);
+}
+
+/**@brief Hand the due actions over to the low scheduler class, BLE work queued meanwhile runs first.
+ */
+static void sched_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+
+    if (m_run_pending)
+    {
+        return;
+    }
+
+    err_code = prio_sched_event_put(NULL, 0, sched_run, PRIO_SCHED_LOW);
+    APP_ERROR_CHECK(err_code);
+
+    m_run_pending = true;
+}
+
+static uint32_t action_queue(sample_sched_action_t * p_action, uint32_t due, uint32_t period, void * p_context)
+{
+    uint32_t now = app_timer_cnt_get();
+
+    if (p_action->queued)
+    {
+        list_remove(p_action);
+    }
+
+    p_action->due       = due;
+    p_action->period    = period;
+    p_action->p_context = p_context;
+
+    list_insert(p_action, now);
+
+    if (mp_head == p_action)
+    {
+        timer_arm(now);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sample_sched_init(void)
+{
+    mp_head       = NULL;
+    m_run_pending = false;
+
+    return app_timer_create(&sched_timer_id, APP_TIMER_MODE_SINGLE_SHOT, sched_timeout_handler);
+}
+
+uint32_t sample_sched_create(sample_sched_action_t * p_action, sample_sched_handler_t handler)
+{
+    VERIFY_PARAM_NOT_NULL(p_action);
+    VERIFY_PARAM_NOT_NULL(handler);
+
+    p_action->handler = handler;
+    p_action->queued  = false;
+    p_action->p_next  = NULL;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sample_sched_start(sample_sched_action_t * p_action, uint32_t delay, uint32_t period, void * p_context)
+{
+    if ((delay > SAMPLE_SCHED_MAX_TICKS) || (period > SAMPLE_SCHED_MAX_TICKS))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    return action_queue(p_action, (app_timer_cnt_get() + delay) & APP_TIMER_MAX_CNT_VAL, period, p_context);
+}
+
+uint32_t sample_sched_start_aligned(sample_sched_action_t       * p_action,
+                                    sample_sched_action_t const * p_ref,
+                                    uint32_t                      offset,
+                                    uint32_t                      period,
+                                    void                        * p_context)
+{
+    uint32_t now = app_timer_cnt_get();
+    uint32_t due;
+
+    if ((offset > SAMPLE_SCHED_MAX_TICKS) || (period > SAMPLE_SCHED_MAX_TICKS))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (!p_ref->queued)
+    {
+        return sample_sched_start(p_action, offset, period, p_context);
+    }
+
+    due = (p_ref->due + offset) & APP_TIMER_MAX_CNT_VAL;
+
+    // Keep the phase but do not wait longer than one period for the first run
+    if ((period > 0) && (ticks_until(due, now) > period))
+    {
+        due = (due - (ticks_until(due, now) / period) * period) & APP_TIMER_MAX_CNT_VAL;
+    }
+
+    return action_queue(p_action, due, period, p_context);
+}
+
+void sample_sched_stop(sample_sched_action_t * p_action)
+{
+    bool was_head = (mp_head == p_action);
+
+    if (!p_action->queued)
+    {
+        return;
+    }
+
+    list_remove(p_action);
+
+    if (was_head)
+    {
+        timer_arm(app_timer_cnt_get());
+    }
+}
+
+bool sample_sched_is_running(sample_sched_action_t const * p_action)
+{
+    return p_action->queued;
+}
@@ -0,0 +1,54 @@
+#include <string.h>
+#include "spsc_ring.h"
+#include "nrf.h"
+
+bool spsc_ring_put(spsc_ring_t * p_ring, void const * p_elem)
+{
+    uint32_t wr = p_ring->wr;
+
+    if ((wr - p_ring->rd) > p_ring->mask)
+    {
+        return false;
+    }
+
+    memcpy(&p_ring->p_buf[(wr & p_ring->mask) * p_ring->elem_size], p_elem, p_ring->elem_size);
+
+    // The element must be in memory before the consumer can see the new index
+    __DMB();
+
+    (void)nrf_atomic_u32_store(&p_ring->wr, wr + 1);
+
+    return true;
+}
+
+bool spsc_ring_get(spsc_ring_t * p_ring, void * p_elem)
+{
+    uint32_t rd = p_ring->rd;
+
+    if (p_ring->wr == rd)
+    {
+        return false;
+    }
+
+    // Do not read the element ahead of the index that published it
+    __DMB();
+
+    memcpy(p_elem, &p_ring->p_buf[(rd & p_ring->mask) * p_ring->elem_size], p_ring->elem_size);
+
+    // The element must be copied out before the producer can reuse the slot
+    __DMB();
+
+    (void)nrf_atomic_u32_store(&p_ring->rd, rd + 1);
+
+    return true;
+}
+
+uint32_t spsc_ring_count(spsc_ring_t const * p_ring)
+{
+    return p_ring->wr - p_ring->rd;
+}
+
+void spsc_ring_flush(spsc_ring_t * p_ring)
+{
+    (void)nrf_atomic_u32_store(&p_ring->rd, p_ring->wr);
+}
@@ -0,0 +1,164 @@
+#include "tlog.h"
+#include <string.h>
+#include <stdlib.h>
+#include "sdk_common.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "SEGGER_RTT.h"
+
+static uint8_t m_buf[TLOG_BUF_SIZE];
+static uint8_t m_seq;                               ///< Sequence number of the next record.
+static uint8_t m_cmd_buf[TLOG_CMD_BUF_SIZE];
+static char    m_cmd[TLOG_CMD_LEN_MAX + 1];         ///< Command line read so far.
+static uint8_t m_cmd_len;
+static uint8_t m_every[TLOG_MODULE_COUNT];          ///< Filter of each module.
+static uint8_t m_count[TLOG_MODULE_COUNT];          ///< Calls of each module since the last one logged.
+
+static char const * const m_module_names[TLOG_MODULE_COUNT] = TLOG_MODULE_NAMES;
+
+uint32_t tlog_init(void)
+{
+    int ret;
+
+    m_seq     = 0;
+    m_cmd_len = 0;
+
+    tlog_filter_set(TLOG_MODULE_COUNT, 1);
+
+    ret = SEGGER_RTT_ConfigUpBuffer(TLOG_RTT_CHANNEL, "tlog", m_buf, sizeof(m_buf), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    if (ret < 0)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    ret = SEGGER_RTT_ConfigDownBuffer(TLOG_RTT_CHANNEL, "tlog", m_cmd_buf, sizeof(m_cmd_buf), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+
+    return (ret < 0) ? NRF_ERROR_INTERNAL : NRF_SUCCESS;
+}
+
+void tlog_write(uint16_t token, uint8_t nargs, uint32_t const * p_args)
+{
+    uint32_t record[2 + TLOG_ARGS_MAX];
+
+    nargs = MIN(nargs, TLOG_ARGS_MAX);
+
+    memcpy(&record[2], p_args, nargs * sizeof(uint32_t));
+
+    CRITICAL_REGION_ENTER();
+
+    // The sequence number moves on for dropped records too
+    record[0] = token | ((uint32_t)nargs << 16) | ((uint32_t)m_seq++ << 24);
+    record[1] = app_timer_cnt_get();
+
+    (void)SEGGER_RTT_WriteSkipNoLock(TLOG_RTT_CHANNEL, record, (2 + nargs) * sizeof(uint32_t));
+
+    CRITICAL_REGION_EXIT();
+}
+
+bool tlog_pass(tlog_module_t module)
+{
+    // Not atomic, a call from an interrupt in between only moves the count by one
+    if ((module >= TLOG_MODULE_COUNT) || (m_every[module] == 0))
+    {
+        return false;
+    }
+
+    if (++m_count[module] < m_every[module])
+    {
+        return false;
+    }
+
+    m_count[module] = 0;
+
+    return true;
+}
+
+void tlog_filter_set(tlog_module_t module, uint8_t every)
+{
+    for (uint8_t i = 0; i < TLOG_MODULE_COUNT; i++)
+    {
+        if ((module == TLOG_MODULE_COUNT) || (module == i))
+        {
+            m_every[i] = every;
+            // The next call is logged, so a change shows at once
+            m_count[i] = (every > 0) ? (every - 1) : 0;
+        }
+    }
+}
+
+uint8_t tlog_filter_get(tlog_module_t module)
+{
+    return (module < TLOG_MODULE_COUNT) ? m_every[module] : 0;
+}
+
+/**@brief Function for applying a filter command line.
+ */
+static void cmd_execute(char * p_cmd)
+{
+    char *        p_arg = strchr(p_cmd, ' ');
+    char *        p_end;
+    unsigned long every;
+    tlog_module_t module;
+
+    if (p_arg == NULL)
+    {
+        NRF_LOG_WARNING("tlog: <module> <every> expected\r\n");
+        return;
+    }
+
+    *p_arg++ = '\0';
+
+    every = strtoul(p_arg, &p_end, 10);
+    if ((p_end == p_arg) || (*p_end != '\0') || (every > UINT8_MAX))
+    {
+        NRF_LOG_WARNING("tlog: bad rate %s\r\n", nrf_log_push(p_arg));
+        return;
+    }
+
+    if (strcmp(p_cmd, "all") == 0)
+    {
+        module = TLOG_MODULE_COUNT;
+    }
+    else
+    {
+        for (module = (tlog_module_t)0; module < TLOG_MODULE_COUNT; module++)
+        {
+            if (strcmp(p_cmd, m_module_names[module]) == 0)
+            {
+                break;
+            }
+        }
+
+        if (module == TLOG_MODULE_COUNT)
+        {
+            NRF_LOG_WARNING("tlog: unknown module %s\r\n", nrf_log_push(p_cmd));
+            return;
+        }
+    }
+
+    tlog_filter_set(module, (uint8_t)every);
+
+    NRF_LOG_INFO("tlog: %s every %d\r\n", nrf_log_push(p_cmd), (uint32_t)every);
+}
+
+void tlog_process(void)
+{
+    char c;
+
+    while (SEGGER_RTT_Read(TLOG_RTT_CHANNEL, &c, 1) == 1)
+    {
+        if ((c == '\r') || (c == '\n'))
+        {
+            if (m_cmd_len > 0)
+            {
+                m_cmd[m_cmd_len] = '\0';
+                cmd_execute(m_cmd);
+            }
+            m_cmd_len = 0;
+        }
+        else if (m_cmd_len < TLOG_CMD_LEN_MAX)
+        {
+            m_cmd[m_cmd_len++] = c;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#include "wall_clock.h"
+#include "sdk_macros.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf_log.h"
+
+#define WALL_CLOCK_REFRESH_MS       (128 * 1000)        // Well inside the 512 s wrap of the 24 bit RTC counter at 32768 Hz.
+#define TICKS_TO_MS(ticks)          (((ticks) * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1)) / APP_TIMER_CLOCK_FREQ)
+
+static uint64_t m_ticks;            ///< RTC ticks since init.
+static uint32_t m_last_cnt;         ///< RTC counter when m_ticks was last brought up to date.
+static bool     m_synced;
+static uint64_t m_sync_unix_ms;     ///< Time written at the last sync.
+static uint64_t m_sync_uptime_ms;   ///< Uptime at the last sync.
+static uint64_t m_ref_unix_ms;      ///< Time written at the sync the drift is measured from.
+static uint64_t m_ref_uptime_ms;
+static int32_t  m_drift_ppm;
+static bool     m_drift_valid;
+
+APP_TIMER_DEF(wall_clock_timer_id);
+
+uint64_t wall_clock_ticks(void)
+{
+    uint64_t ticks;
+    uint32_t now;
+
+    CRITICAL_REGION_ENTER();
+
+    now         = app_timer_cnt_get();
+    m_ticks    += app_timer_cnt_diff_compute(now, m_last_cnt);
+    m_last_cnt  = now;
+    ticks       = m_ticks;
+
+    CRITICAL_REGION_EXIT();
+
+    return ticks;
+}
+
+uint64_t wall_clock_uptime_ms(void)
+{
+    return TICKS_TO_MS(wall_clock_ticks());
+}
+
+static void wall_clock_timeout_handler(void * p_context)
+{
+    (void)wall_clock_ticks();
+}
+
+uint32_t wall_clock_init(void)
+{
+    uint32_t err_code;
+
+    m_ticks       = 0;
+    m_last_cnt    = app_timer_cnt_get();
+    m_synced      = false;
+    m_drift_ppm   = 0;
+    m_drift_valid = false;
+
+    err_code = app_timer_create(&wall_clock_timer_id, APP_TIMER_MODE_REPEATED, wall_clock_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    return app_timer_start(wall_clock_timer_id, APP_TIMER_TICKS(WALL_CLOCK_REFRESH_MS), NULL);
+}
+
+void wall_clock_sync(uint64_t unix_ms)
+{
+    uint64_t now_ms = wall_clock_uptime_ms();
+
+    if (!m_synced)
+    {
+        m_ref_unix_ms   = unix_ms;
+        m_ref_uptime_ms = now_ms;
+    }
+    else if (now_ms - m_ref_uptime_ms >= WALL_CLOCK_DRIFT_SPAN_MIN_MS)
+    {
+        // Syncs in between only set the time, the drift is measured over a long enough span
+        int64_t local_ms  = (int64_t)(now_ms - m_ref_uptime_ms);
+        int64_t remote_ms = (int64_t)(unix_ms - m_ref_unix_ms);
+        int64_t drift_ppm = ((remote_ms - local_ms) * 1000000) / local_ms;
+
+        if ((drift_ppm >= -WALL_CLOCK_DRIFT_MAX_PPM) && (drift_ppm <= WALL_CLOCK_DRIFT_MAX_PPM))
+        {
+            m_drift_ppm   = m_drift_valid ? (m_drift_ppm + (int32_t)drift_ppm) / 2 : (int32_t)drift_ppm;
+            m_drift_valid = true;
+        }
+        else
+        {
+            NRF_LOG_WARNING("Clock set, %d ppm off\r\n", (int32_t)drift_ppm);
+        }
+
+        m_ref_unix_ms   = unix_ms;
+        m_ref_uptime_ms = now_ms;
+    }
+
+    m_sync_unix_ms   = unix_ms;
+    m_sync_uptime_ms = now_ms;
+    m_synced         = true;
+
+    NRF_LOG_INFO("Clock synced, drift %d ppm\r\n", m_drift_ppm);
+}
+
+bool wall_clock_synced(void)
+{
+    return m_synced;
+}
+
+uint64_t wall_clock_now_ms(void)
+{
+    int64_t elapsed_ms;
+
+    if (!m_synced)
+    {
+        return 0;
+    }
+
+    elapsed_ms = (int64_t)(wall_clock_uptime_ms() - m_sync_uptime_ms);
+
+    return m_sync_unix_ms + elapsed_ms + (elapsed_ms * m_drift_ppm) / 1000000;
+}
+
+int16_t wall_clock_drift_ppm(void)
+{
+    return (int16_t)m_drift_ppm;
+}
@@ -0,0 +1,324 @@
+/* Host test of m_config_store importing the records of the firmware before it: the detection
+ * configuration record of that firmware, in its own layout, must come through the import and
+ * det_config_verify with its intervals, thresholds and sample mode, and the settings added since
+ * with their defaults. fds, the timers and the scheduler are stand-ins that keep records in RAM
+ * and deliver events when run.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "m_config_store.h"
+#include "det_config.h"
+#include "prio_sched.h"
+#include "app_timer.h"
+#include "fds.h"
+
+#define FAKE_RECORDS        8
+#define FAKE_RECORD_WORDS   64
+#define FAKE_EVENTS         8
+
+#define LEGACY_DET_FILE_ID  0x1001
+#define LEGACY_DET_REC_KEY  0x1002
+#define CONFIG_FILE_ID      0x3000
+
+typedef struct
+{
+    fds_header_t header;
+    uint32_t     data[FAKE_RECORD_WORDS];
+    bool         live;
+} fake_record_t;
+
+static fake_record_t             m_records[FAKE_RECORDS];
+static uint32_t                  m_record_id;
+static fds_cb_t                  m_fds_cb;
+static fds_evt_t                 m_events[FAKE_EVENTS];
+static uint8_t                   m_event_count;
+static app_sched_event_handler_t m_sched[FAKE_EVENTS];
+static uint8_t                   m_sched_count;
+static int                       m_failures;
+
+static void check(bool ok, char const * p_what)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "FAIL: %s\n", p_what);
+        m_failures++;
+    }
+}
+
+static void event_put(fds_evt_t const * p_evt)
+{
+    check(m_event_count < FAKE_EVENTS, "fds event queue overflow");
+    m_events[m_event_count++] = *p_evt;
+}
+
+/* Legacy record as the firmware before the store wrote it, the first word is its valid mark. */
+static void legacy_record_put(uint16_t file_id, uint16_t key, void const * p_data, uint16_t size)
+{
+    fake_record_t * p_rec = &m_records[m_record_id];
+
+    p_rec->header.file_id      = file_id;
+    p_rec->header.record_key   = key;
+    p_rec->header.record_id    = ++m_record_id;
+    p_rec->header.length_words = CEIL_DIV(size, 4);
+    p_rec->live                = true;
+    memcpy(p_rec->data, p_data, size);
+}
+
+static uint16_t records_in_file(uint16_t file_id)
+{
+    uint16_t count = 0;
+
+    for (uint16_t i = 0; i < FAKE_RECORDS; i++)
+    {
+        count += (m_records[i].live && (m_records[i].header.file_id == file_id));
+    }
+
+    return count;
+}
+
+ret_code_t fds_register(fds_cb_t cb)
+{
+    m_fds_cb = cb;
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_init(void)
+{
+    fds_evt_t evt = { .id = FDS_EVT_INIT, .result = FDS_SUCCESS };
+
+    event_put(&evt);
+    return FDS_SUCCESS;
+}
+
+static ret_code_t record_find(uint16_t file_id, uint16_t const * p_key, fds_record_desc_t * p_desc, fds_find_token_t * p_token)
+{
+    // The token keeps the index of the next record to look at
+    for (uint16_t i = p_token->page; i < FAKE_RECORDS; i++)
+    {
+        fake_record_t * p_rec = &m_records[i];
+
+        if (p_rec->live && (p_rec->header.file_id == file_id) &&
+            ((p_key == NULL) || (p_rec->header.record_key == *p_key)))
+        {
+            memset(p_desc, 0, sizeof(fds_record_desc_t));
+            p_desc->record_id = p_rec->header.record_id;
+            p_desc->p_record  = (uint32_t const *)&p_rec->header;
+            p_token->page     = i + 1;
+            return FDS_SUCCESS;
+        }
+    }
+
+    return FDS_ERR_NOT_FOUND;
+}
+
+ret_code_t fds_record_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t * p_desc, fds_find_token_t * p_token)
+{
+    return record_find(file_id, &record_key, p_desc, p_token);
+}
+
+ret_code_t fds_record_find_in_file(uint16_t file_id, fds_record_desc_t * p_desc, fds_find_token_t * p_token)
+{
+    return record_find(file_id, NULL, p_desc, p_token);
+}
+
+ret_code_t fds_record_open(fds_record_desc_t * p_desc, fds_flash_record_t * p_flash_record)
+{
+    fake_record_t const * p_rec = (fake_record_t const *)p_desc->p_record;
+
+    p_flash_record->p_header = &p_rec->header;
+    p_flash_record->p_data   = p_rec->data;
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_record_close(fds_record_desc_t * p_desc)
+{
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_record_write(fds_record_desc_t * p_desc, fds_record_t const * p_record)
+{
+    fds_evt_t evt = { .id = FDS_EVT_WRITE, .result = FDS_SUCCESS };
+
+    check(m_record_id < FAKE_RECORDS, "fake flash full");
+    check(p_record->data.length_words <= FAKE_RECORD_WORDS, "record too long");
+
+    legacy_record_put(p_record->file_id, p_record->key, p_record->data.p_data, p_record->data.length_words * 4);
+
+    if (p_desc != NULL)
+    {
+        memset(p_desc, 0, sizeof(fds_record_desc_t));
+        p_desc->record_id = m_record_id;
+        p_desc->p_record  = (uint32_t const *)&m_records[m_record_id - 1].header;
+    }
+
+    evt.write.record_id  = m_record_id;
+    evt.write.file_id    = p_record->file_id;
+    evt.write.record_key = p_record->key;
+    event_put(&evt);
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_record_update(fds_record_desc_t * p_desc, fds_record_t const * p_record)
+{
+    ((fake_record_t *)p_desc->p_record)->live = false;
+    return fds_record_write(p_desc, p_record);
+}
+
+ret_code_t fds_record_delete(fds_record_desc_t * p_desc)
+{
+    fds_evt_t evt = { .id = FDS_EVT_DEL_RECORD, .result = FDS_SUCCESS };
+
+    ((fake_record_t *)p_desc->p_record)->live = false;
+    event_put(&evt);
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_file_delete(uint16_t file_id)
+{
+    fds_evt_t evt = { .id = FDS_EVT_DEL_FILE, .result = FDS_SUCCESS };
+
+    for (uint16_t i = 0; i < FAKE_RECORDS; i++)
+    {
+        if (m_records[i].header.file_id == file_id)
+        {
+            m_records[i].live = false;
+        }
+    }
+
+    evt.del.file_id = file_id;
+    event_put(&evt);
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_gc(void)
+{
+    fds_evt_t evt = { .id = FDS_EVT_GC, .result = FDS_SUCCESS };
+
+    event_put(&evt);
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_stat(fds_stat_t * p_stat)
+{
+    memset(p_stat, 0, sizeof(fds_stat_t));
+    p_stat->largest_contig = 0xFFFF;
+    return FDS_SUCCESS;
+}
+
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler)
+{
+    return NRF_SUCCESS;
+}
+
+/* The debounce timer never expires, the writes checked here are the ones made at once. */
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t prio_sched_event_put(void const * p_event_data, uint16_t event_size, app_sched_event_handler_t handler, prio_sched_prio_t prio)
+{
+    check(m_sched_count < FAKE_EVENTS, "scheduler queue overflow");
+    m_sched[m_sched_count++] = handler;
+    return NRF_SUCCESS;
+}
+
+/* Delivers the fds events and runs what they scheduled, until nothing is left. */
+void app_sched_execute(void)
+{
+    while ((m_event_count > 0) || (m_sched_count > 0))
+    {
+        if (m_event_count > 0)
+        {
+            fds_evt_t evt = m_events[0];
+
+            memmove(&m_events[0], &m_events[1], --m_event_count * sizeof(fds_evt_t));
+            m_fds_cb(&evt);
+        }
+        else
+        {
+            app_sched_event_handler_t handler = m_sched[0];
+
+            memmove(&m_sched[0], &m_sched[1], --m_sched_count * sizeof(app_sched_event_handler_t));
+            handler(NULL, 0);
+        }
+    }
+}
+
+int main(void)
+{
+    // Differs from every setting in the record, one replaced by mistake shows
+    static ble_dds_config_t const default_config =
+    {
+        .presence_interval_ms = 33,
+        .range_interval_ms    = 33,
+        .threshold_config     = { .eth13h = 200, .eth13l = -200, .eth24h = 200, .eth24l = -200 },
+        .sample_mode          = SAMPLE_MODE_MOTION,
+        .calibration          = { .window_s = 60, .false_wakes_per_day = 4 },
+        .session              = { .timeout = 30, .min_length = 2, .holdoff = 5 },
+        .range_report         = { .deadband_mm = 0, .heartbeat_s = 0 },
+    };
+    ble_dds_config_t              config;
+
+    /* Detection record of the firmware before the store: the valid mark, then the configuration as
+     * it was, the intervals, the thresholds and a one byte sample mode, 13 bytes packed. */
+    static uint8_t const legacy_det[] =
+    {
+        0x42, 0x00, 0x00, 0x00,
+        0x50, 0x00,                 // range_interval_ms 80
+        0x64, 0x00,                 // presence_interval_ms 100
+        0x2C, 0x01,                 // eth13h 300
+        0xCA, 0xFE,                 // eth13l -310
+        0x40, 0x01,                 // eth24h 320
+        0xB6, 0xFE,                 // eth24l -330
+        SAMPLE_MODE_CONTINUOUS,
+    };
+
+    legacy_record_put(LEGACY_DET_FILE_ID, LEGACY_DET_REC_KEY, legacy_det, sizeof(legacy_det));
+
+    check(m_config_store_init() == NRF_SUCCESS, "init");
+
+    memset(&config, 0xFF, sizeof(config));
+    check(m_config_store_load(M_CONFIG_STORE_TAG_DETECTION, &config, sizeof(config)) == NRF_SUCCESS,
+          "detection configuration imported");
+    check(det_config_verify(&config, &default_config), "settings added since replaced");
+
+    check(config.range_interval_ms == 80, "range interval");
+    check(config.presence_interval_ms == 100, "presence interval");
+    check(config.threshold_config.eth13h == 300, "eth13h");
+    check(config.threshold_config.eth13l == -310, "eth13l");
+    check(config.threshold_config.eth24h == 320, "eth24h");
+    check(config.threshold_config.eth24l == -330, "eth24l");
+    check(config.sample_mode == SAMPLE_MODE_CONTINUOUS, "sample mode");
+
+    // Not in the legacy record, they load as zero, a valid range report but not a valid calibration or session
+    check(memcmp(&config.calibration, &default_config.calibration, sizeof(config.calibration)) == 0,
+          "calibration default");
+    check(memcmp(&config.session, &default_config.session, sizeof(config.session)) == 0,
+          "session default");
+    check(memcmp(&config.range_report, &default_config.range_report, sizeof(config.range_report)) == 0,
+          "range report default");
+
+    // The import is written at once, the legacy file goes only after that
+    check(records_in_file(CONFIG_FILE_ID) == 1, "configuration record written");
+    check(records_in_file(LEGACY_DET_FILE_ID) == 1, "legacy record kept until the write is done");
+
+    app_sched_execute();
+
+    check(records_in_file(LEGACY_DET_FILE_ID) == 0, "legacy record deleted after the write");
+
+    if (m_failures > 0)
+    {
+        return 1;
+    }
+
+    printf("config_store: legacy detection configuration imported\n");
+
+    return 0;
+}
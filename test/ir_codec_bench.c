@@ -0,0 +1,280 @@
+/* Host benchmark of ir_codec: encodes a presence trace into packets and reports the compression
+ * ratio against the uncompressed presence characteristic and the encoding time per sample.
+ *
+ * ir_codec_bench <trace.csv> <packets.txt>   encode a trace, one packet per line in hex
+ * ir_codec_bench -s <trace.csv>              write the built in trace
+ *
+ * A trace holds one sample per line as: timestamp,marker,ir1,ir2,ir3,ir4, which is what
+ * tools/ir_codec_decode.py prints for a captured stream. The built in trace is modelled on the
+ * sensor: 20 ms sampling at the timestamp frequency with capture jitter and now and then a missed
+ * sample, idle noise on every channel and people walking past the channel pairs.
+ */
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES()        __rdtsc()
+#endif
+#include "ir_codec.h"
+
+#define TS_FREQ             31250       // HW_TIMESTAMP_FREQ.
+#define SYNTH_SAMPLES       90000       // 30 min at 20 ms.
+#define SYNTH_INTERVAL_MS   20
+#define ENCODE_RUNS         20          // Runs timed, the fastest counts.
+
+static ble_dds_presence_t * m_samples;
+static size_t               m_count;
+
+static uint32_t m_rand = 1;
+
+static uint32_t rand_next(void)
+{
+    m_rand = m_rand * 1103515245 + 12345;
+
+    return (m_rand >> 16) & 0x7FFF;
+}
+
+/**@brief Roughly normal noise from the sum of uniform values. */
+static double noise(double sigma)
+{
+    int32_t sum = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        sum += (int32_t)rand_next() - 0x4000;
+    }
+
+    return sigma * sum / (0x4000 * 1.1547);
+}
+
+static void synthesize(void)
+{
+    static const double offset[IR_CODEC_CHANNELS] = { 42, -17, 8, -31 };
+    double   pass_t  = -1;          // Time into a person passing, s, negative while nobody is.
+    double   pass_dir = 1;
+    double   drift   = 0;
+    uint32_t tick    = 0;
+
+    m_count   = SYNTH_SAMPLES;
+    m_samples = calloc(m_count, sizeof(ble_dds_presence_t));
+
+    for (size_t i = 0; i < m_count; i++)
+    {
+        ble_dds_presence_t * p_s = &m_samples[i];
+        int16_t              ir[IR_CODEC_CHANNELS];
+
+        tick += (SYNTH_INTERVAL_MS * TS_FREQ) / 1000;
+        if (rand_next() % 500 == 0)
+        {
+            tick += (SYNTH_INTERVAL_MS * TS_FREQ) / 1000;
+        }
+
+        if ((pass_t < 0) && (rand_next() % 3000 == 0))
+        {
+            pass_t   = 0;
+            pass_dir = (rand_next() & 1) ? 1 : -1;
+        }
+
+        drift += noise(0.05);
+        for (int c = 0; c < IR_CODEC_CHANNELS; c++)
+        {
+            double v = offset[c] + drift + noise(6);
+
+            if (pass_t >= 0)
+            {
+                // Pairs 1/3 and 2/4 see the person 0.4 s apart, in the walking direction
+                double lag = ((c < 2) ? -0.2 : 0.2) * pass_dir;
+                double t   = pass_t - 1.5 - lag;
+
+                v += 900 * exp(-t * t / 0.3);
+            }
+            ir[c] = (int16_t)lrint(v);
+        }
+
+        if (pass_t >= 0)
+        {
+            pass_t += SYNTH_INTERVAL_MS / 1000.0;
+            if (pass_t > 3)
+            {
+                pass_t = -1;
+            }
+        }
+
+        p_s->timestamp = tick + (rand_next() % 3);
+        p_s->marker    = (pass_t >= 0) ? 0 : 1;
+        p_s->ir1       = ir[0];
+        p_s->ir2       = ir[1];
+        p_s->ir3       = ir[2];
+        p_s->ir4       = ir[3];
+    }
+}
+
+static int trace_write(char const * p_path)
+{
+    FILE * f = fopen(p_path, "w");
+
+    if (f == NULL)
+    {
+        perror(p_path);
+        return 1;
+    }
+
+    for (size_t i = 0; i < m_count; i++)
+    {
+        ble_dds_presence_t const * p_s = &m_samples[i];
+
+        fprintf(f, "%" PRIu32 ",%u,%d,%d,%d,%d\n",
+                p_s->timestamp, p_s->marker, p_s->ir1, p_s->ir2, p_s->ir3, p_s->ir4);
+    }
+
+    return fclose(f) ? 1 : 0;
+}
+
+static int trace_read(char const * p_path)
+{
+    FILE *   f = fopen(p_path, "r");
+    size_t   size = 1024;
+    uint32_t ts;
+    unsigned marker;
+    int      ir[IR_CODEC_CHANNELS];
+
+    if (f == NULL)
+    {
+        perror(p_path);
+        return 1;
+    }
+
+    m_samples = malloc(size * sizeof(ble_dds_presence_t));
+    m_count   = 0;
+
+    while (fscanf(f, "%" SCNu32 ",%u,%d,%d,%d,%d", &ts, &marker, &ir[0], &ir[1], &ir[2], &ir[3]) == 6)
+    {
+        if (m_count == size)
+        {
+            size     *= 2;
+            m_samples = realloc(m_samples, size * sizeof(ble_dds_presence_t));
+        }
+        m_samples[m_count++] = (ble_dds_presence_t){ ts, (uint8_t)marker, ir[0], ir[1], ir[2], ir[3] };
+    }
+
+    fclose(f);
+
+    return (m_count == 0) ? 1 : 0;
+}
+
+/**@brief Encode the whole trace, as m_detection does, writing the packets if f is not NULL.
+ */
+static size_t encode(FILE * f, size_t * p_packets)
+{
+    static ir_codec_t codec;
+    uint8_t const *   p_data;
+    size_t            bytes = 0;
+    uint16_t          len;
+
+    *p_packets = 0;
+    ir_codec_reset(&codec);
+
+    for (size_t i = 0; i <= m_count; i++)
+    {
+        if ((i < m_count) && ir_codec_put(&codec, &m_samples[i]))
+        {
+            continue;
+        }
+
+        len = ir_codec_packet_get(&codec, &p_data);
+        if (len > 0)
+        {
+            if (f != NULL)
+            {
+                for (uint16_t j = 0; j < len; j++)
+                {
+                    fprintf(f, "%02x", p_data[j]);
+                }
+                fputc('\n', f);
+            }
+            bytes += len;
+            (*p_packets)++;
+        }
+        ir_codec_packet_release(&codec);
+
+        if ((i < m_count) && !ir_codec_put(&codec, &m_samples[i]))
+        {
+            fprintf(stderr, "sample %zu does not fit an empty packet\n", i);
+            exit(1);
+        }
+    }
+
+    return bytes;
+}
+
+int main(int argc, char ** argv)
+{
+    FILE *          f;
+    size_t          bytes;
+    size_t          packets;
+    double          best_ns = 1e30;
+    struct timespec t0;
+    struct timespec t1;
+
+    if ((argc == 3) && (strcmp(argv[1], "-s") == 0))
+    {
+        synthesize();
+        return trace_write(argv[2]);
+    }
+
+    if ((argc != 3) || trace_read(argv[1]))
+    {
+        fprintf(stderr, "usage: %s <trace.csv> <packets.txt> | -s <trace.csv>\n", argv[0]);
+        return 1;
+    }
+
+    f = fopen(argv[2], "w");
+    if (f == NULL)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+    bytes = encode(f, &packets);
+    fclose(f);
+
+#ifdef CYCLES
+    uint64_t best_cycles = UINT64_MAX;
+#endif
+
+    for (int run = 0; run < ENCODE_RUNS; run++)
+    {
+        size_t dummy;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+#ifdef CYCLES
+        uint64_t c0 = CYCLES();
+#endif
+        (void)encode(NULL, &dummy);
+#ifdef CYCLES
+        uint64_t cycles = CYCLES() - c0;
+
+        best_cycles = (cycles < best_cycles) ? cycles : best_cycles;
+#endif
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+        best_ns = (ns < best_ns) ? ns : best_ns;
+    }
+
+    printf("ir_codec: %zu samples in %zu packets, %zu bytes against %zu uncompressed, ratio %.2f, "
+           "%.1f samples per packet\n",
+           m_count, packets, bytes, m_count * sizeof(ble_dds_presence_t),
+           (double)(m_count * sizeof(ble_dds_presence_t)) / bytes, (double)m_count / packets);
+    printf("ir_codec: %.0f ns per sample on this host", best_ns / m_count);
+#ifdef CYCLES
+    printf(", %.0f TSC cycles", (double)best_cycles / m_count);
+#endif
+    printf("\n");
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/* Host stress test of spsc_ring: one thread puts numbered elements, another takes them and checks
+ * that every element arrives once, in order and whole. A small ring keeps it full and empty often.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "spsc_ring.h"
+
+#define ELEMENTS        2000000UL
+
+typedef struct
+{
+    uint32_t seq;
+    uint32_t check[3];      ///< Derived from seq, a torn element fails the check.
+} elem_t;
+
+SPSC_RING_DEF(m_ring, elem_t, 16);
+
+static unsigned long m_full;
+static unsigned long m_empty;
+
+static void * producer(void * p_arg)
+{
+    elem_t elem;
+
+    for (uint32_t seq = 0; seq < ELEMENTS; seq++)
+    {
+        elem.seq      = seq;
+        elem.check[0] = ~seq;
+        elem.check[1] = seq * 2654435761u;
+        elem.check[2] = seq ^ 0xA5A5A5A5u;
+
+        while (!spsc_ring_put(&m_ring, &elem))
+        {
+            // Let the consumer run on a single core host
+            m_full++;
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void * consumer(void * p_arg)
+{
+    elem_t elem;
+
+    for (uint32_t seq = 0; seq < ELEMENTS; seq++)
+    {
+        while (!spsc_ring_get(&m_ring, &elem))
+        {
+            m_empty++;
+            sched_yield();
+        }
+
+        if ((elem.seq != seq)                       ||
+            (elem.check[0] != ~seq)                 ||
+            (elem.check[1] != seq * 2654435761u)    ||
+            (elem.check[2] != (seq ^ 0xA5A5A5A5u)))
+        {
+            fprintf(stderr, "FAIL: expected %u, got %u %08x %08x %08x\n",
+                    seq, elem.seq, elem.check[0], elem.check[1], elem.check[2]);
+            exit(1);
+        }
+
+        if (spsc_ring_count(&m_ring) > 16)
+        {
+            fprintf(stderr, "FAIL: count %u over the size\n", spsc_ring_count(&m_ring));
+            exit(1);
+        }
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t prod;
+    pthread_t cons;
+
+    pthread_create(&cons, NULL, consumer, NULL);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+
+    if (spsc_ring_count(&m_ring) != 0)
+    {
+        fprintf(stderr, "FAIL: %u elements left\n", spsc_ring_count(&m_ring));
+        return 1;
+    }
+
+    printf("spsc_ring: %lu elements passed, producer found it full %lu times, consumer empty %lu times\n",
+           ELEMENTS, m_full, m_empty);
+
+    return 0;
+}
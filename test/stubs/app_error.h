@@ -0,0 +1,18 @@
+#ifndef __HOST_APP_ERROR_H__
+#define __HOST_APP_ERROR_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sdk_errors.h"
+
+#define APP_ERROR_CHECK(err_code)                                                        \
+    do                                                                                   \
+    {                                                                                    \
+        if ((err_code) != NRF_SUCCESS)                                                   \
+        {                                                                                \
+            fprintf(stderr, "FAIL: error %u at %s:%d\n", (unsigned)(err_code), __FILE__, __LINE__); \
+            exit(1);                                                                     \
+        }                                                                                \
+    } while (0)
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __HOST_APP_SCHEDULER_H__
+#define __HOST_APP_SCHEDULER_H__
+
+#include <stdint.h>
+
+typedef void (*app_sched_event_handler_t)(void * p_event_data, uint16_t event_size);
+
+/* Provided by the test, runs what its stand-ins queued. */
+void app_sched_execute(void);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef __HOST_APP_TIMER_H__
+#define __HOST_APP_TIMER_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+typedef void (*app_timer_timeout_handler_t)(void * p_context);
+typedef uint32_t const * app_timer_id_t;
+
+typedef enum
+{
+    APP_TIMER_MODE_SINGLE_SHOT,
+    APP_TIMER_MODE_REPEATED
+} app_timer_mode_t;
+
+#define APP_TIMER_DEF(timer_id)     static uint32_t timer_id##_data; static app_timer_id_t timer_id = &timer_id##_data
+#define APP_TIMER_TICKS(ms)         (ms)
+
+/* Provided by the test. */
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler);
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context);
+ret_code_t app_timer_stop(app_timer_id_t timer_id);
+
+#endif
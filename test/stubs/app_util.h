@@ -0,0 +1,11 @@
+#ifndef __HOST_APP_UTIL_H__
+#define __HOST_APP_UTIL_H__
+
+#define STATIC_ASSERT(EXPR)         _Static_assert((EXPR), #EXPR)
+#define IS_POWER_OF_TWO(A)          (((A) != 0) && ((((A) - 1) & (A)) == 0))
+#define CONCAT_2(p1, p2)            CONCAT_2_(p1, p2)
+#define CONCAT_2_(p1, p2)           p1##p2
+#define ARRAY_SIZE(arr)             (sizeof(arr) / sizeof((arr)[0]))
+#define CEIL_DIV(A, B)              (((A) + (B) - 1) / (B))
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef __HOST_APP_UTIL_PLATFORM_H__
+#define __HOST_APP_UTIL_PLATFORM_H__
+
+#include "app_util.h"
+
+/* Single threaded on the host, nothing to mask. */
+#define CRITICAL_REGION_ENTER()
+#define CRITICAL_REGION_EXIT()
+
+#define ANON_UNIONS_ENABLE
+#define ANON_UNIONS_DISABLE
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef __HOST_BLE_DDS_H__
+#define __HOST_BLE_DDS_H__
+
+#include <stdint.h>
+#include "app_util.h"
+
+#define BLE_DDS_MAX_DATA_LEN        20          ///< Default ATT MTU less the notification header, as on target.
+
+typedef struct __attribute__((packed))
+{
+    uint32_t timestamp;
+    uint8_t marker;
+    int16_t ir1;
+    int16_t ir2;
+    int16_t ir3;
+    int16_t ir4;
+} ble_dds_presence_t;
+
+#endif
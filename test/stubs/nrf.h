@@ -0,0 +1,8 @@
+#ifndef __HOST_NRF_H__
+#define __HOST_NRF_H__
+
+/* Host stand-ins for the CMSIS barriers, a full fence is at least as strong as a DMB. */
+#define __DMB()     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DSB()     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef __HOST_NRF_ATOMIC_H__
+#define __HOST_NRF_ATOMIC_H__
+
+#include <stdint.h>
+
+typedef volatile uint32_t nrf_atomic_u32_t;
+
+/* Relaxed, the ring orders its accesses with its own barriers. */
+static inline uint32_t nrf_atomic_u32_store(nrf_atomic_u32_t * p_data, uint32_t value)
+{
+    __atomic_store_n(p_data, value, __ATOMIC_RELAXED);
+    return value;
+}
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __HOST_NRF_LOG_H__
+#define __HOST_NRF_LOG_H__
+
+#define NRF_LOG_ERROR(...)
+#define NRF_LOG_WARNING(...)
+#define NRF_LOG_INFO(...)
+#define NRF_LOG_DEBUG(...)
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef __HOST_SDK_COMMON_H__
+#define __HOST_SDK_COMMON_H__
+
+#include <stddef.h>
+#include "sdk_errors.h"
+#include "app_util.h"
+
+#define MIN(a, b)                   ((a) < (b) ? (a) : (b))
+
+#define VERIFY_SUCCESS(err_code)    do { if ((err_code) != NRF_SUCCESS) { return (err_code); } } while (0)
+#define VERIFY_PARAM_NOT_NULL(p)    do { if ((p) == NULL) { return NRF_ERROR_NULL; } } while (0)
+
+#endif
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Decode the compressed presence stream of characteristic 0204 into samples.
+
+Usage: ir_codec_decode.py <packets>
+
+The input holds one notification per line in hex, as logged by a BLE client. Bytes may be
+separated by spaces, '-' or ':' and the line may start with '0x'. Samples are printed one per
+line as: timestamp,marker,ir1,ir2,ir3,ir4. The format is described in the README and in
+include/util/ir_codec.h, this decoder is the reference for it.
+
+A lost packet takes the prediction state with it, samples are skipped until a packet starts
+with a keyframe.
+"""
+
+import re
+import sys
+
+CHANNELS = 4
+RICE_K_MAX = 15
+RICE_Q_ESCAPE = 12
+RICE_COUNT_MAX = 16
+RICE_SUM_INIT = 4
+RAW_BITS_IR = 17
+RAW_BITS_DT = 32
+HEADER = 2
+
+
+class Bits:
+    """MSB first bit reader over one packet."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def get(self, count):
+        value = 0
+        for _ in range(count):
+            byte = self.data[self.pos // 8]
+            value = (value << 1) | ((byte >> (7 - self.pos % 8)) & 1)
+            self.pos += 1
+        return value
+
+
+class Rice:
+    """Adaptive Rice parameter, kept exactly as the encoder keeps it."""
+
+    def __init__(self):
+        self.sum = RICE_SUM_INIT
+        self.count = 1
+
+    def k(self):
+        k = 0
+        while (self.count << k) < self.sum and k < RICE_K_MAX:
+            k += 1
+        return k
+
+    def update(self, mapped):
+        self.sum = (self.sum + mapped) & 0xFFFFFFFF
+        self.count += 1
+        if self.count >= RICE_COUNT_MAX:
+            self.sum >>= 1
+            self.count >>= 1
+
+    def get(self, bits, raw_bits):
+        k = self.k()
+        q = 0
+        while q < RICE_Q_ESCAPE and bits.get(1):
+            q += 1
+        if q == RICE_Q_ESCAPE:
+            mapped = bits.get(raw_bits)
+        else:
+            mapped = (q << k) | bits.get(k)
+        self.update(mapped)
+        return (mapped >> 1) ^ -(mapped & 1)
+
+
+def int16(value):
+    value &= 0xFFFF
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def int32(value):
+    value &= 0xFFFFFFFF
+    return value - 0x100000000 if value & 0x80000000 else value
+
+
+class Decoder:
+    def __init__(self):
+        self.prev = None
+        self.prev_dt = 0
+        self.rice = []
+        self.seq = None
+
+    def keyframe(self, bits):
+        marker = bits.get(2)
+        timestamp = bits.get(32)
+        ir = [int16(bits.get(16)) for _ in range(CHANNELS)]
+        self.prev_dt = 0
+        self.rice = [Rice() for _ in range(CHANNELS + 1)]
+        return [timestamp, marker] + ir
+
+    def delta(self, bits):
+        marker = bits.get(2)
+        dt = int32(self.prev_dt + self.rice[0].get(bits, RAW_BITS_DT))
+        timestamp = (self.prev[0] + dt) & 0xFFFFFFFF
+        ir = [self.prev[2 + i] + self.rice[1 + i].get(bits, RAW_BITS_IR) for i in range(CHANNELS)]
+        self.prev_dt = dt
+        return [timestamp, marker] + ir
+
+    def packet(self, data):
+        if len(data) < HEADER:
+            return []
+
+        seq, frames = data[0], data[1]
+        bits = Bits(data)
+        bits.pos = HEADER * 8
+
+        # A restarted stream starts over at 0 with a keyframe, any other jump is a loss
+        if (self.seq is not None) and (seq != self.seq):
+            if (seq != 0) or (frames == 0) or not (data[HEADER] & 0x80):
+                sys.stderr.write('--- %d packets dropped\n' % ((seq - self.seq) & 0xFF))
+            self.prev = None
+        self.seq = (seq + 1) & 0xFF
+
+        samples = []
+        for i in range(frames):
+            key = bits.get(1)
+            if key:
+                sample = self.keyframe(bits)
+            elif self.prev is None:
+                if i == 0:
+                    sys.stderr.write('--- packet %d skipped, waiting for a keyframe\n' % seq)
+                return samples
+            else:
+                sample = self.delta(bits)
+            self.prev = sample
+            samples.append(sample)
+
+        return samples
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+
+    decoder = Decoder()
+
+    with open(sys.argv[1]) as f:
+        for line in f:
+            line = re.sub(r'^\s*0x', '', line.strip(), flags=re.IGNORECASE)
+            line = re.sub(r'[\s:-]', '', line)
+            if not line:
+                continue
+            for sample in decoder.packet(bytes.fromhex(line)):
+                print(','.join(str(v) for v in sample))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Render the tokenized log read from RTT channel 1 with the format strings of the ELF file.
+
+Usage: tlog_decode.py <firmware.out> <rtt channel 1 capture>
+
+The format strings are taken out of the .tlog_fmt section with arm-none-eabi-objcopy, set
+OBJCOPY to use another one. Records are described in include/util/tlog.h.
+"""
+
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+
+RTC_FREQ = 32768
+CONVERSION = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l)?([diouxXc%])')
+
+
+def dictionary_load(elf):
+    objcopy = os.environ.get('OBJCOPY', 'arm-none-eabi-objcopy')
+
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'tlog_fmt.bin')
+        subprocess.check_call([objcopy, '--dump-section', '.tlog_fmt=' + path, elf])
+        with open(path, 'rb') as f:
+            return f.read()
+
+
+def render(fmt, args):
+    values = iter(args)
+
+    def conversion(m):
+        flags, conv = m.group(1), m.group(2)
+        if conv == '%':
+            return '%'
+        value = next(values, 0)
+        if conv in 'di':
+            value = struct.unpack('<i', struct.pack('<I', value))[0]
+            conv = 'd'
+        return ('%' + flags + conv) % value
+
+    return CONVERSION.sub(conversion, fmt)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+
+    strings = dictionary_load(sys.argv[1])
+
+    with open(sys.argv[2], 'rb') as f:
+        data = f.read()
+
+    pos = 0
+    seq = None
+
+    while pos + 8 <= len(data):
+        token, nargs, rec_seq, tick = struct.unpack_from('<HBBI', data, pos)
+        pos += 8
+
+        args = struct.unpack_from('<%dI' % nargs, data, pos)
+        pos += 4 * nargs
+
+        if (seq is not None) and (rec_seq != seq):
+            print('--- %d records dropped' % ((rec_seq - seq) & 0xFF))
+        seq = (rec_seq + 1) & 0xFF
+
+        end = strings.find(b'\0', token)
+        fmt = strings[token:end].decode('ascii', 'replace') if end >= 0 else '<unknown token 0x%04x>' % token
+
+        print('[%10.3f] %s' % (tick / RTC_FREQ, render(fmt, args).rstrip()))
+
+
+if __name__ == '__main__':
+    main()